@@ -0,0 +1,187 @@
+#include "account_index.h"
+
+using namespace std;
+
+namespace
+{
+constexpr size_t MIN_CAPACITY = 16;
+constexpr size_t NO_ENTRY = static_cast<size_t>(-1);
+
+// Smallest power-of-two table that keeps count entries under a 3/4 load factor
+size_t capacityFor(size_t count)
+{
+    size_t capacity = MIN_CAPACITY;
+    while (count * 4 > capacity * 3)
+    {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+unsigned log2Of(size_t capacity)
+{
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < capacity)
+    {
+        ++bits;
+    }
+    return bits;
+}
+} // namespace
+
+AccountIndex::AccountIndex() : mask(0), shift(0), num_entries(0), num_tombstones(0)
+{
+    rehash(MIN_CAPACITY);
+}
+
+size_t AccountIndex::home(int account_number) const
+{
+    // Fibonacci hashing spreads sequential account numbers across the whole table
+    uint64_t key = static_cast<uint32_t>(account_number);
+    return static_cast<size_t>((key * 11400714819323198485ull) >> shift);
+}
+
+size_t AccountIndex::probe(int account_number) const
+{
+    for (size_t i = home(account_number);; i = (i + 1) & mask)
+    {
+        const Entry &entry = entries[i];
+        if (entry.slot == EMPTY)
+        {
+            return NO_ENTRY;
+        }
+        if (entry.slot != TOMBSTONE && entry.account_number == account_number)
+        {
+            return i;
+        }
+    }
+}
+
+int32_t AccountIndex::find(int account_number) const
+{
+    size_t i = probe(account_number);
+    return i == NO_ENTRY ? NOT_FOUND : entries[i].slot;
+}
+
+bool AccountIndex::insert(int account_number, int32_t slot)
+{
+    if ((num_entries + num_tombstones + 1) * 4 > entries.size() * 3)
+    {
+        // Grow when live entries fill half the table, otherwise rebuild in place to drop tombstones
+        rehash((num_entries + 1) * 2 > entries.size() ? entries.size() * 2 : entries.size());
+    }
+
+    size_t reuse = NO_ENTRY;
+    for (size_t i = home(account_number);; i = (i + 1) & mask)
+    {
+        Entry &entry = entries[i];
+        if (entry.slot == EMPTY)
+        {
+            if (reuse == NO_ENTRY)
+            {
+                reuse = i;
+            }
+            else
+            {
+                num_tombstones--;
+            }
+            break;
+        }
+        if (entry.slot == TOMBSTONE)
+        {
+            if (reuse == NO_ENTRY)
+            {
+                reuse = i;
+            }
+        }
+        else if (entry.account_number == account_number)
+        {
+            return false;
+        }
+    }
+
+    entries[reuse].account_number = account_number;
+    entries[reuse].slot = slot;
+    num_entries++;
+    return true;
+}
+
+bool AccountIndex::update(int account_number, int32_t slot)
+{
+    size_t i = probe(account_number);
+    if (i == NO_ENTRY)
+    {
+        return false;
+    }
+    entries[i].slot = slot;
+    return true;
+}
+
+bool AccountIndex::erase(int account_number)
+{
+    size_t i = probe(account_number);
+    if (i == NO_ENTRY)
+    {
+        return false;
+    }
+    num_entries--;
+
+    if (entries[(i + 1) & mask].slot != EMPTY)
+    {
+        // Later entries in this probe run may depend on this one, so leave a tombstone
+        entries[i].slot = TOMBSTONE;
+        num_tombstones++;
+        return true;
+    }
+
+    // End of a probe run: the entry and any tombstones directly before it can become empty
+    entries[i].slot = EMPTY;
+    for (size_t j = (i - 1) & mask; entries[j].slot == TOMBSTONE; j = (j - 1) & mask)
+    {
+        entries[j].slot = EMPTY;
+        num_tombstones--;
+    }
+    return true;
+}
+
+void AccountIndex::reserve(size_t count)
+{
+    size_t capacity = capacityFor(count);
+    if (capacity > entries.size())
+    {
+        rehash(capacity);
+    }
+}
+
+void AccountIndex::clear()
+{
+    entries.assign(MIN_CAPACITY, Entry{0, EMPTY});
+    mask = MIN_CAPACITY - 1;
+    shift = 64 - log2Of(MIN_CAPACITY);
+    num_entries = 0;
+    num_tombstones = 0;
+}
+
+void AccountIndex::rehash(size_t new_capacity)
+{
+    vector<Entry> old_entries(new_capacity, Entry{0, EMPTY});
+    old_entries.swap(entries);
+    mask = new_capacity - 1;
+    shift = 64 - log2Of(new_capacity);
+    num_tombstones = 0;
+
+    for (const Entry &entry : old_entries)
+    {
+        if (entry.slot >= 0)
+        {
+            for (size_t i = home(entry.account_number);; i = (i + 1) & mask)
+            {
+                if (entries[i].slot == EMPTY)
+                {
+                    entries[i] = entry;
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef ACCOUNT_INDEX_H
+#define ACCOUNT_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Open-addressing hash index mapping an account number to the slot that holds the account.
+// Entries are 8 bytes and stored inline (linear probing), so a lookup usually touches a
+// single cache line. Deleted entries leave tombstones that are reused by later inserts
+// and purged whenever the table is rebuilt.
+class AccountIndex
+{
+public:
+    static constexpr int32_t NOT_FOUND = -1;
+
+    AccountIndex();
+
+    // Returns the slot stored for account_number, or NOT_FOUND.
+    int32_t find(int account_number) const;
+    // Adds account_number -> slot. Returns false if the account number is already present.
+    bool insert(int account_number, int32_t slot);
+    // Points an existing entry at a new slot. Returns false if the account number is absent.
+    bool update(int account_number, int32_t slot);
+    // Removes account_number. Returns false if it was not present.
+    bool erase(int account_number);
+    // Sizes the table so that count entries fit without rehashing.
+    void reserve(std::size_t count);
+    void clear();
+
+    std::size_t size() const { return num_entries; }
+    std::size_t capacity() const { return entries.size(); }
+
+    // Calls f(account_number, slot) for every entry, in no particular order
+    template <typename F>
+    void forEach(F &&f) const
+    {
+        for (const Entry &entry : entries)
+        {
+            if (entry.slot >= 0)
+            {
+                f(entry.account_number, entry.slot);
+            }
+        }
+    }
+
+private:
+    static constexpr int32_t EMPTY = -1;
+    static constexpr int32_t TOMBSTONE = -2;
+
+    struct Entry
+    {
+        int32_t account_number;
+        int32_t slot; // EMPTY, TOMBSTONE or the slot of the account
+    };
+
+    std::size_t home(int account_number) const;
+    std::size_t probe(int account_number) const;
+    void rehash(std::size_t new_capacity);
+
+    std::vector<Entry> entries;
+    std::size_t mask;
+    unsigned shift;
+    std::size_t num_entries;
+    std::size_t num_tombstones;
+};
+
+#endif /* ACCOUNT_INDEX_H */
@@ -0,0 +1,130 @@
+#include "async_bank.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+// Times an idle worker yields before going to sleep
+constexpr int SPIN_ROUNDS = 64;
+} // namespace
+
+thread_local AsyncBank::Worker *AsyncBank::current_worker = nullptr;
+
+AsyncBank::AsyncBank(BankingSystem &bank, size_t num_threads, ResumeFunction resume, size_t queue_capacity)
+    : bank(bank), resume(move(resume))
+{
+    if (num_threads == 0)
+    {
+        num_threads = max(thread::hardware_concurrency(), 1u);
+    }
+    workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        workers.push_back(make_unique<Worker>(queue_capacity));
+    }
+    for (unique_ptr<Worker> &worker : workers)
+    {
+        worker->thread = thread(&AsyncBank::run, this, ref(*worker));
+    }
+}
+
+AsyncBank::~AsyncBank()
+{
+    stopping.store(true, memory_order_release);
+    for (unique_ptr<Worker> &worker : workers)
+    {
+        worker->wake_signal.fetch_add(1, memory_order_release);
+        worker->wake_signal.notify_one();
+    }
+    for (unique_ptr<Worker> &worker : workers)
+    {
+        worker->thread.join();
+    }
+}
+
+void AsyncBank::submit(Work &work)
+{
+    Worker &worker = *workers[next_worker.fetch_add(1, memory_order_relaxed) % workers.size()];
+    Work *entry = &work;
+    while (!worker.inbox.tryPush(entry))
+    {
+        if (current_worker != nullptr &&
+            any_of(workers.begin(), workers.end(),
+                   [](const unique_ptr<Worker> &candidate) { return candidate.get() == current_worker; }))
+        {
+            current_worker->overflow.push_back(entry);
+            return;
+        }
+        this_thread::yield();
+    }
+    // Pairs with the fence in run: either the worker sees this work before sleeping, or
+    // this sees it asleep and wakes it
+    atomic_thread_fence(memory_order_seq_cst);
+    if (worker.sleeping.load(memory_order_relaxed))
+    {
+        worker.wake_signal.fetch_add(1, memory_order_release);
+        worker.wake_signal.notify_one();
+    }
+}
+
+void AsyncBank::run(Worker &worker)
+{
+    current_worker = &worker;
+    Work *work;
+    int idle_rounds = 0;
+    while (true)
+    {
+        bool found = worker.inbox.tryPop(work);
+        if (!found && !worker.overflow.empty())
+        {
+            work = worker.overflow.front();
+            worker.overflow.pop_front();
+            found = true;
+        }
+        if (found)
+        {
+            idle_rounds = 0;
+            // The first visit runs the operation; a second one, after the journal caught
+            // up, only resumes
+            if (!work->executed)
+            {
+                work->executed = true;
+                if (!work->execute(*work))
+                {
+                    continue;
+                }
+            }
+            // The coroutine may destroy work, so nothing touches it after this
+            if (resume)
+            {
+                resume(work->continuation);
+            }
+            else
+            {
+                work->continuation.resume();
+            }
+            continue;
+        }
+        if (++idle_rounds < SPIN_ROUNDS)
+        {
+            this_thread::yield();
+            continue;
+        }
+        if (stopping.load(memory_order_acquire))
+        {
+            break;
+        }
+
+        uint32_t signal = worker.wake_signal.load(memory_order_acquire);
+        worker.sleeping.store(true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (worker.inbox.empty() && !stopping.load(memory_order_acquire))
+        {
+            worker.wake_signal.wait(signal, memory_order_acquire);
+        }
+        worker.sleeping.store(false, memory_order_relaxed);
+        idle_rounds = 0;
+    }
+}
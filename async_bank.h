@@ -0,0 +1,195 @@
+#ifndef ASYNC_BANK_H
+#define ASYNC_BANK_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "banking_system.h"
+#include "mpsc_queue.h"
+
+// A page of history from AsyncBank::queryHistory, with its records copied out
+struct AsyncHistoryPage
+{
+    HistoryPage page;
+    std::vector<Transaction> records;
+};
+
+// Coroutine front end to a BankingSystem. Every operation returns an awaitable, and
+// co_await hands the operation to one of a few worker threads, which runs it and resumes
+// the awaiting coroutine, so any number of requests can be in flight on a fixed set of
+// threads. The awaitable lives in the coroutine frame; queuing it allocates nothing.
+//
+// With a journal attached in Synchronous mode, workers never block on the disk: each
+// operation runs under a DeferredCommit, and its coroutine is only resumed once
+// Journal::whenDurable reports its record on disk, by which time the worker has moved on
+// to other requests. Operations still return JournalFailed if writing fails.
+//
+// Coroutines resume on a worker thread, or wherever the resume function given to the
+// constructor sends them, e.g. back onto the event loop they came from.
+class AsyncBank
+{
+    // Intrusive queue entry, embedded in each Operation
+    struct Work
+    {
+        bool (*execute)(Work &work);
+        std::coroutine_handle<> continuation;
+        bool executed = false;
+        // Cleared by whichever of the worker, once it has registered with the journal, and
+        // the durability callback finishes first; the other one resumes the coroutine
+        std::atomic<bool> pending{true};
+    };
+
+public:
+    using ResumeFunction = std::function<void(std::coroutine_handle<>)>;
+
+    // num_threads of 0 starts one worker per hardware thread; capacity is per worker queue.
+    // The bank is not owned and must outlive this.
+    explicit AsyncBank(BankingSystem &bank, std::size_t num_threads = 0, ResumeFunction resume = nullptr,
+                       std::size_t queue_capacity = 4096);
+    // Call only once every awaited operation has resumed
+    ~AsyncBank();
+    AsyncBank(const AsyncBank &) = delete;
+    AsyncBank &operator=(const AsyncBank &) = delete;
+
+    // Awaitable for one operation; co_await gives its Result
+    template <typename Result, typename F>
+    class Operation : private Work
+    {
+    public:
+        Operation(AsyncBank &async_bank, F function) : async_bank(async_bank), function(std::move(function))
+        {
+            this->execute = &Operation::executeOperation;
+        }
+        Operation(const Operation &) = delete;
+        Operation &operator=(const Operation &) = delete;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            this->continuation = handle;
+            async_bank.submit(*this);
+        }
+        Result await_resume() { return std::move(result); }
+
+    private:
+        // On a worker: runs the operation, and returns whether the coroutine can resume now
+        static bool executeOperation(Work &work)
+        {
+            Operation &operation = static_cast<Operation &>(work);
+            DeferredCommit deferred;
+            operation.result = operation.function();
+            if (deferred.journal() == nullptr)
+            {
+                return true;
+            }
+            // Whichever of the worker and the durability callback gets here second resumes
+            deferred.journal()->whenDurable(deferred.position(), [&operation](bool durable) {
+                if constexpr (std::is_same_v<Result, Status>)
+                {
+                    if (!durable)
+                    {
+                        operation.result = Status::JournalFailed;
+                    }
+                }
+                if (!operation.pending.exchange(false, std::memory_order_acq_rel))
+                {
+                    operation.async_bank.submit(operation);
+                }
+            });
+            return !operation.pending.exchange(false, std::memory_order_acq_rel);
+        }
+
+        AsyncBank &async_bank;
+        F function;
+        Result result{};
+    };
+
+    auto createAccount(int account_number, std::string owner, Money initial_balance)
+    {
+        return operation<Status>([this, account_number, owner = std::move(owner), initial_balance] {
+            return bank.createAccount(account_number, owner, initial_balance);
+        });
+    }
+    auto deposit(int account_number, Money amount)
+    {
+        return operation<Status>([this, account_number, amount] { return bank.deposit(account_number, amount); });
+    }
+    auto withdraw(int account_number, Money amount)
+    {
+        return operation<Status>([this, account_number, amount] { return bank.withdraw(account_number, amount); });
+    }
+    auto transfer(int from_account_number, int to_account_number, Money amount)
+    {
+        return operation<Status>([this, from_account_number, to_account_number, amount] {
+            return bank.transfer(from_account_number, to_account_number, amount);
+        });
+    }
+    auto deleteAccount(int account_number)
+    {
+        return operation<Status>([this, account_number] { return bank.deleteAccount(account_number); });
+    }
+    // See BankingSystem::runTransaction; body runs on a worker
+    auto runTransaction(std::function<Status(BankTransaction &)> body, int max_attempts = 16)
+    {
+        return operation<Status>([this, body = std::move(body), max_attempts] {
+            return bank.runTransaction(body, max_attempts);
+        });
+    }
+    // See BankingSystem::queryHistory
+    auto queryHistory(int account_number, HistoryQuery query)
+    {
+        return operation<AsyncHistoryPage>([this, account_number, query] {
+            AsyncHistoryPage result;
+            result.page = bank.queryHistory(account_number, query, [&result](std::span<const Transaction> run) {
+                result.records.insert(result.records.end(), run.begin(), run.end());
+            });
+            return result;
+        });
+    }
+
+    std::size_t numThreads() const { return workers.size(); }
+
+private:
+    struct Worker
+    {
+        explicit Worker(std::size_t queue_capacity) : inbox(queue_capacity) {}
+
+        MpscQueue<Work *> inbox;
+        std::thread thread;
+        // Work this worker submitted while the target queue was full; only it touches this
+        std::deque<Work *> overflow;
+        // Set while the worker sleeps waiting for work; bumping wake_signal wakes it
+        alignas(64) std::atomic<bool> sleeping{false};
+        std::atomic<uint32_t> wake_signal{0};
+    };
+
+    template <typename Result, typename F>
+    Operation<Result, F> operation(F function)
+    {
+        return Operation<Result, F>(*this, std::move(function));
+    }
+    // Queues work on the next worker in turn. A full queue makes other threads wait, but a
+    // worker keeps the work itself, since waiting could deadlock the workers.
+    void submit(Work &work);
+    void run(Worker &worker);
+
+    static thread_local Worker *current_worker; // the worker running on this thread, if any
+
+    BankingSystem &bank;
+    ResumeFunction resume;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<std::size_t> next_worker{0};
+    std::atomic<bool> stopping{false};
+};
+
+#endif /* ASYNC_BANK_H */
@@ -0,0 +1,108 @@
+#ifndef ATOMIC_MONEY_H
+#define ATOMIC_MONEY_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+#include "money.h"
+
+// Money that several threads can update without a lock. The minor-unit count lives in
+// a plain int64_t cell owned elsewhere (an account's slot in a BalanceColumn) and every
+// access goes through a std::atomic_ref, so code that has excluded all other access can
+// also process the cells directly. Every update is a CAS loop, so checks such as
+// "enough funds" are made against the exact value being replaced.
+//
+// A version number advances after every change, so an optimistic reader can record
+// (version, value) and later tell whether anything changed since. The version is read
+// before the value and bumped after it, so a reader never pairs a stale value with a
+// current version.
+class AtomicMoney
+{
+public:
+    AtomicMoney() : minor_units(nullptr), version_counter(0) {}
+    AtomicMoney(const AtomicMoney &) = delete;
+    AtomicMoney &operator=(const AtomicMoney &) = delete;
+
+    // Points this at the cell that holds the value; must be done before any other use.
+    // first_version keeps versions from repeating when a cell is reused.
+    void bind(int64_t &cell, uint64_t first_version = 0)
+    {
+        minor_units = &cell;
+        version_counter.store(first_version, std::memory_order_relaxed);
+    }
+
+    Money load() const { return Money::fromMinorUnits(cell().load(std::memory_order_acquire)); }
+    operator Money() const { return load(); }
+    void store(Money amount)
+    {
+        cell().store(amount.minorUnits(), std::memory_order_release);
+        markChanged();
+    }
+
+    uint64_t version() const { return version_counter.load(std::memory_order_acquire); }
+    // Advances the version after the cell was changed directly
+    void markChanged() { version_counter.fetch_add(1, std::memory_order_release); }
+
+    // Adds amount unless the result would overflow; returns the new value
+    std::optional<Money> tryAdd(Money amount)
+    {
+        return update([amount](Money current) { return current.checkedAdd(amount); });
+    }
+
+    // Subtracts amount unless it is more than the current value; returns the new value
+    std::optional<Money> trySubtract(Money amount)
+    {
+        return update([amount](Money current) -> std::optional<Money> {
+            if (amount > current)
+            {
+                return std::nullopt;
+            }
+            return current.checkedSubtract(amount);
+        });
+    }
+
+    // Multiplies by numerator / denominator unless the result would overflow; returns the new
+    // value and, if previous is given, stores the value it replaced there
+    std::optional<Money> tryScale(int64_t numerator, int64_t denominator, RoundingMode mode = RoundingMode::HalfEven,
+                                  Money *previous = nullptr)
+    {
+        return update([=](Money current) {
+            if (previous != nullptr)
+            {
+                *previous = current;
+            }
+            return current.checkedScale(numerator, denominator, mode);
+        });
+    }
+
+private:
+    // Replaces the value with f(value) until no other thread intervenes, or gives up when f declines
+    template <typename F>
+    std::optional<Money> update(F f)
+    {
+        std::atomic_ref<int64_t> value = cell();
+        int64_t current = value.load(std::memory_order_relaxed);
+        while (true)
+        {
+            std::optional<Money> next = f(Money::fromMinorUnits(current));
+            if (!next)
+            {
+                return std::nullopt;
+            }
+            if (value.compare_exchange_weak(current, next->minorUnits(), std::memory_order_acq_rel,
+                                            std::memory_order_relaxed))
+            {
+                markChanged();
+                return next;
+            }
+        }
+    }
+
+    std::atomic_ref<int64_t> cell() const { return std::atomic_ref<int64_t>(*minor_units); }
+
+    int64_t *minor_units;
+    std::atomic<uint64_t> version_counter;
+};
+
+#endif /* ATOMIC_MONEY_H */
@@ -0,0 +1,78 @@
+#ifndef BALANCE_COLUMN_H
+#define BALANCE_COLUMN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Struct-of-arrays storage for the per-account fields that bulk operations sweep, indexed
+// by the account's SlabStore handle. Balances sit in contiguous arrays, so interest
+// accrual streams through 8 bytes per account instead of pulling in each Account.
+// Chunks are allocated as handles reach them and never move, so a cell's address is
+// stable for the life of the column.
+//
+// ensure may be called from several threads; the cells themselves are synchronized by
+// their users. Slots of released accounts must be zeroed so sweeps can treat every
+// slot alike.
+class BalanceColumn
+{
+public:
+    static constexpr std::size_t CHUNK_SIZE = 16384;
+    static constexpr std::size_t MAX_CHUNKS = (std::size_t(1) << 31) / CHUNK_SIZE;
+
+    BalanceColumn() : chunks(new std::atomic<Chunk *>[MAX_CHUNKS]()), num_chunks(0) {}
+    BalanceColumn(const BalanceColumn &) = delete;
+    BalanceColumn &operator=(const BalanceColumn &) = delete;
+
+    ~BalanceColumn()
+    {
+        for (std::size_t i = 0; i < num_chunks.load(std::memory_order_relaxed); ++i)
+        {
+            delete chunks[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    // Allocates every chunk up to the one holding handle
+    void ensure(int32_t handle)
+    {
+        std::size_t needed = static_cast<std::size_t>(handle) / CHUNK_SIZE + 1;
+        if (num_chunks.load(std::memory_order_acquire) >= needed)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(growth_mutex);
+        for (std::size_t i = num_chunks.load(std::memory_order_relaxed); i < needed; ++i)
+        {
+            chunks[i].store(new Chunk(), std::memory_order_release);
+            num_chunks.store(i + 1, std::memory_order_release);
+        }
+    }
+
+    int64_t &balance(int32_t handle) { return chunkOf(handle).balances[handle % CHUNK_SIZE]; }
+    uint8_t &rateTier(int32_t handle) { return chunkOf(handle).rate_tiers[handle % CHUNK_SIZE]; }
+
+    std::size_t numChunks() const { return num_chunks.load(std::memory_order_acquire); }
+    // Cells of chunk i, covering handles i * CHUNK_SIZE up to the next chunk
+    int64_t *balanceChunk(std::size_t i) { return chunks[i].load(std::memory_order_acquire)->balances; }
+    uint8_t *rateTierChunk(std::size_t i) { return chunks[i].load(std::memory_order_acquire)->rate_tiers; }
+
+private:
+    struct Chunk
+    {
+        alignas(64) int64_t balances[CHUNK_SIZE] = {};
+        uint8_t rate_tiers[CHUNK_SIZE] = {};
+    };
+
+    Chunk &chunkOf(int32_t handle)
+    {
+        return *chunks[static_cast<std::size_t>(handle) / CHUNK_SIZE].load(std::memory_order_acquire);
+    }
+
+    std::unique_ptr<std::atomic<Chunk *>[]> chunks;
+    std::atomic<std::size_t> num_chunks;
+    std::mutex growth_mutex;
+};
+
+#endif /* BALANCE_COLUMN_H */
@@ -0,0 +1,124 @@
+#include "bank_client.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+constexpr size_t READ_SIZE = 64 * 1024;
+} // namespace
+
+unique_ptr<BankClient> BankClient::connect(const string &address)
+{
+    optional<SocketAddress> socket_address = SocketAddress::parse(address);
+    if (!socket_address)
+    {
+        return nullptr;
+    }
+    int fd = ::socket(socket_address->storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&socket_address->storage), socket_address->length) != 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+    if (!socket_address->isUnix())
+    {
+        int enable = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    return unique_ptr<BankClient>(new BankClient(fd));
+}
+
+BankClient::~BankClient()
+{
+    ::close(fd);
+}
+
+void BankClient::send(const Request &request)
+{
+    encodeRequest(request, output);
+    opcodes.push_back(request.opcode);
+}
+
+bool BankClient::flush()
+{
+    size_t start = 0;
+    while (start < output.size())
+    {
+        ssize_t sent = ::send(fd, output.data() + start, output.size() - start, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        start += static_cast<size_t>(sent);
+    }
+    output.clear();
+    return true;
+}
+
+optional<Response> BankClient::receive()
+{
+    if (opcodes.empty() || (!output.empty() && !flush()))
+    {
+        return nullopt;
+    }
+    while (true)
+    {
+        Response response;
+        size_t consumed = 0;
+        DecodeResult result =
+            decodeResponse(opcodes.front(), input.data() + input_start, input_end - input_start, response, consumed);
+        if (result == DecodeResult::Complete)
+        {
+            input_start += consumed;
+            opcodes.pop_front();
+            return response;
+        }
+        if (result == DecodeResult::Malformed)
+        {
+            return nullopt;
+        }
+
+        // Move the unread part to the front, then read whatever has arrived after it
+        if (input_start != 0)
+        {
+            memmove(input.data(), input.data() + input_start, input_end - input_start);
+            input_end -= input_start;
+            input_start = 0;
+        }
+        if (input.size() - input_end < READ_SIZE)
+        {
+            input.resize(input_end + READ_SIZE);
+        }
+        ssize_t received = ::recv(fd, input.data() + input_end, input.size() - input_end, 0);
+        if (received > 0)
+        {
+            input_end += static_cast<size_t>(received);
+        }
+        else if (received == 0 || errno != EINTR)
+        {
+            return nullopt;
+        }
+    }
+}
+
+optional<Response> BankClient::call(const Request &request)
+{
+    send(request);
+    return receive();
+}
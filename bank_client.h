@@ -0,0 +1,48 @@
+#ifndef BANK_CLIENT_H
+#define BANK_CLIENT_H
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "bank_protocol.h"
+
+// Blocking client for BankServer. Requests are queued with send and go out together on
+// flush, so any number can be in flight; receive returns their responses in order.
+// Not thread-safe: use one client per thread.
+class BankClient
+{
+public:
+    // Connects to address (see SocketAddress); returns null if it cannot
+    static std::unique_ptr<BankClient> connect(const std::string &address);
+    ~BankClient();
+    BankClient(const BankClient &) = delete;
+    BankClient &operator=(const BankClient &) = delete;
+
+    void send(const Request &request);
+    // Writes every queued request; false if the connection failed
+    bool flush();
+    // Waits for the response to the oldest request still in flight, flushing first if it
+    // has not been sent; nullopt if the connection failed or nothing is in flight
+    std::optional<Response> receive();
+    // Sends one request and waits for its response
+    std::optional<Response> call(const Request &request);
+
+    std::size_t inFlight() const { return opcodes.size(); }
+
+private:
+    explicit BankClient(int fd) : fd(fd) {}
+
+    int fd;
+    std::vector<char> output;
+    // Responses received but not yet returned are input[input_start, input_end)
+    std::vector<char> input;
+    std::size_t input_start = 0;
+    std::size_t input_end = 0;
+    std::deque<RequestOpcode> opcodes; // of the requests awaiting a response, oldest first
+};
+
+#endif /* BANK_CLIENT_H */
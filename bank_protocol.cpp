@@ -0,0 +1,254 @@
+#include "bank_protocol.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+#include <cstring>
+
+#include "interest_kernel.h"
+
+using namespace std;
+
+namespace
+{
+// Body length of each opcode's request, not counting a CreateAccount owner
+constexpr size_t fixedRequestLength(RequestOpcode opcode)
+{
+    switch (opcode)
+    {
+    case RequestOpcode::CreateAccount:
+        return 15;
+    case RequestOpcode::DeleteAccount:
+    case RequestOpcode::Balance:
+        return 5;
+    case RequestOpcode::Deposit:
+    case RequestOpcode::Withdraw:
+        return 13;
+    case RequestOpcode::Transfer:
+        return 17;
+    case RequestOpcode::Interest:
+        return 9;
+    }
+    return 0;
+}
+
+template <typename T>
+void put(vector<char> &out, T value)
+{
+    char bytes[sizeof(value)];
+    memcpy(bytes, &value, sizeof(value));
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+template <typename T>
+T get(const char *&in)
+{
+    T value;
+    memcpy(&value, in, sizeof(value));
+    in += sizeof(value);
+    return value;
+}
+
+// Reads the length prefix of the message at data, if all of it has arrived
+DecodeResult messageBody(const char *data, size_t length, size_t max_length, const char *&body,
+                         size_t &body_length)
+{
+    if (length < MESSAGE_HEADER_SIZE)
+    {
+        return DecodeResult::Incomplete;
+    }
+    const char *in = data;
+    body_length = get<uint32_t>(in);
+    if (body_length == 0 || body_length > max_length)
+    {
+        return DecodeResult::Malformed;
+    }
+    if (length - MESSAGE_HEADER_SIZE < body_length)
+    {
+        return DecodeResult::Incomplete;
+    }
+    body = in;
+    return DecodeResult::Complete;
+}
+} // namespace
+
+void encodeRequest(const Request &request, vector<char> &out)
+{
+    size_t length = fixedRequestLength(request.opcode);
+    if (request.opcode == RequestOpcode::CreateAccount)
+    {
+        length += request.owner.size();
+    }
+    out.reserve(out.size() + MESSAGE_HEADER_SIZE + length);
+    put<uint32_t>(out, static_cast<uint32_t>(length));
+    put<uint8_t>(out, static_cast<uint8_t>(request.opcode));
+    switch (request.opcode)
+    {
+    case RequestOpcode::CreateAccount:
+        put<int32_t>(out, request.account_number);
+        put<int64_t>(out, request.amount.minorUnits());
+        put<uint16_t>(out, static_cast<uint16_t>(request.owner.size()));
+        out.insert(out.end(), request.owner.begin(), request.owner.end());
+        break;
+    case RequestOpcode::DeleteAccount:
+    case RequestOpcode::Balance:
+        put<int32_t>(out, request.account_number);
+        break;
+    case RequestOpcode::Deposit:
+    case RequestOpcode::Withdraw:
+        put<int32_t>(out, request.account_number);
+        put<int64_t>(out, request.amount.minorUnits());
+        break;
+    case RequestOpcode::Transfer:
+        put<int32_t>(out, request.account_number);
+        put<int32_t>(out, request.to_account_number);
+        put<int64_t>(out, request.amount.minorUnits());
+        break;
+    case RequestOpcode::Interest:
+        put<double>(out, request.rate);
+        break;
+    }
+}
+
+DecodeResult decodeRequest(const char *data, size_t length, Request &request, size_t &consumed)
+{
+    const char *in;
+    size_t body_length;
+    DecodeResult result = messageBody(data, length, MAX_REQUEST_LENGTH, in, body_length);
+    if (result != DecodeResult::Complete)
+    {
+        return result;
+    }
+    request = Request{};
+    request.opcode = static_cast<RequestOpcode>(get<uint8_t>(in));
+    size_t fixed_length = fixedRequestLength(request.opcode);
+    if (fixed_length == 0 || body_length < fixed_length ||
+        (request.opcode != RequestOpcode::CreateAccount && body_length != fixed_length))
+    {
+        return DecodeResult::Malformed;
+    }
+    switch (request.opcode)
+    {
+    case RequestOpcode::CreateAccount:
+    {
+        request.account_number = get<int32_t>(in);
+        request.amount = Money::fromMinorUnits(get<int64_t>(in));
+        uint16_t owner_length = get<uint16_t>(in);
+        if (body_length != fixed_length + owner_length)
+        {
+            return DecodeResult::Malformed;
+        }
+        request.owner = string_view(in, owner_length);
+        break;
+    }
+    case RequestOpcode::DeleteAccount:
+    case RequestOpcode::Balance:
+        request.account_number = get<int32_t>(in);
+        break;
+    case RequestOpcode::Deposit:
+    case RequestOpcode::Withdraw:
+        request.account_number = get<int32_t>(in);
+        request.amount = Money::fromMinorUnits(get<int64_t>(in));
+        break;
+    case RequestOpcode::Transfer:
+        request.account_number = get<int32_t>(in);
+        request.to_account_number = get<int32_t>(in);
+        request.amount = Money::fromMinorUnits(get<int64_t>(in));
+        break;
+    case RequestOpcode::Interest:
+        request.rate = get<double>(in);
+        if (!validInterestRate(request.rate))
+        {
+            return DecodeResult::Malformed;
+        }
+        break;
+    }
+    consumed = MESSAGE_HEADER_SIZE + body_length;
+    return DecodeResult::Complete;
+}
+
+void encodeResponse(RequestOpcode opcode, const Response &response, vector<char> &out)
+{
+    bool has_balance = opcode == RequestOpcode::Balance && response.status == Status::Ok;
+    put<uint32_t>(out, has_balance ? 9 : 1);
+    put<uint8_t>(out, static_cast<uint8_t>(response.status));
+    if (has_balance)
+    {
+        put<int64_t>(out, response.balance.minorUnits());
+    }
+}
+
+DecodeResult decodeResponse(RequestOpcode opcode, const char *data, size_t length, Response &response,
+                            size_t &consumed)
+{
+    const char *in;
+    size_t body_length;
+    DecodeResult result = messageBody(data, length, 9, in, body_length);
+    if (result != DecodeResult::Complete)
+    {
+        return result;
+    }
+    uint8_t status = get<uint8_t>(in);
+    if (status >= NUM_STATUSES)
+    {
+        return DecodeResult::Malformed;
+    }
+    response = Response{};
+    response.status = static_cast<Status>(status);
+    bool has_balance = opcode == RequestOpcode::Balance && response.status == Status::Ok;
+    if (body_length != (has_balance ? 9u : 1u))
+    {
+        return DecodeResult::Malformed;
+    }
+    if (has_balance)
+    {
+        response.balance = Money::fromMinorUnits(get<int64_t>(in));
+    }
+    consumed = MESSAGE_HEADER_SIZE + body_length;
+    return DecodeResult::Complete;
+}
+
+optional<SocketAddress> SocketAddress::parse(const string &address)
+{
+    SocketAddress result{};
+    if (address.starts_with("unix:"))
+    {
+        string path = address.substr(5);
+        sockaddr_un &unix_address = reinterpret_cast<sockaddr_un &>(result.storage);
+        if (path.empty() || path.size() >= sizeof(unix_address.sun_path))
+        {
+            return nullopt;
+        }
+        unix_address.sun_family = AF_UNIX;
+        memcpy(unix_address.sun_path, path.c_str(), path.size() + 1);
+        result.length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+        return result;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == string::npos)
+    {
+        return nullopt;
+    }
+    string host = address.substr(0, colon);
+    string port = address.substr(colon + 1);
+    // Brackets around an IPv6 literal, as in [::1]:7878
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+    {
+        host = host.substr(1, host.size() - 2);
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    addrinfo *found = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found) != 0)
+    {
+        return nullopt;
+    }
+    memcpy(&result.storage, found->ai_addr, found->ai_addrlen);
+    result.length = found->ai_addrlen;
+    freeaddrinfo(found);
+    return result;
+}
@@ -0,0 +1,92 @@
+#ifndef BANK_PROTOCOL_H
+#define BANK_PROTOCOL_H
+
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "money.h"
+#include "status.h"
+
+// Binary protocol spoken by BankServer and BankClient. Every message is a 4-byte body
+// length followed by the body, all integers little-endian. A request body is an opcode
+// byte and a fixed layout for that opcode:
+//   CreateAccount  account (i32), initial balance (i64 minor units), owner length (u16), owner
+//   DeleteAccount  account (i32)
+//   Deposit        account (i32), amount (i64)
+//   Withdraw       account (i32), amount (i64)
+//   Transfer       from account (i32), to account (i32), amount (i64)
+//   Balance        account (i32)
+//   Interest       rate (f64), finite and in [MIN_INTEREST_RATE, MAX_INTEREST_RATE]
+// A response body is a Status byte, followed for an Ok Balance by the balance (i64).
+//
+// Clients may pipeline: send any number of requests without waiting, and read the
+// responses, which come back in request order on the same connection.
+
+enum class RequestOpcode : uint8_t
+{
+    CreateAccount = 1,
+    DeleteAccount,
+    Deposit,
+    Withdraw,
+    Transfer,
+    Balance,
+    Interest,
+};
+
+constexpr std::size_t MESSAGE_HEADER_SIZE = 4;
+// Longest request body; anything longer is a protocol error
+constexpr std::size_t MAX_REQUEST_LENGTH = 15 + 1024;
+
+// One decoded request; fields the opcode does not use are zero. owner points into the
+// buffer the request was decoded from.
+struct Request
+{
+    RequestOpcode opcode;
+    int32_t account_number = 0;
+    int32_t to_account_number = 0;
+    Money amount;
+    double rate = 0.0;
+    std::string_view owner;
+};
+
+struct Response
+{
+    Status status = Status::Ok;
+    Money balance; // Balance requests only
+};
+
+enum class DecodeResult
+{
+    Complete,   // one message decoded
+    Incomplete, // the buffer ends before the message does; read more and try again
+    Malformed,  // not a valid message; the connection cannot be resynchronised
+};
+
+// Appends the message for request to out
+void encodeRequest(const Request &request, std::vector<char> &out);
+// Decodes the message at the start of data, setting consumed to its length
+DecodeResult decodeRequest(const char *data, std::size_t length, Request &request, std::size_t &consumed);
+// Appends the response to a request with the given opcode
+void encodeResponse(RequestOpcode opcode, const Response &response, std::vector<char> &out);
+// Decodes a response to a request with the given opcode
+DecodeResult decodeResponse(RequestOpcode opcode, const char *data, std::size_t length, Response &response,
+                            std::size_t &consumed);
+
+// Address of a server: "host:port" for TCP (numeric or resolvable host, port may be 0 to
+// let the system pick when listening) or "unix:path" for a Unix domain socket
+struct SocketAddress
+{
+    sockaddr_storage storage;
+    socklen_t length;
+
+    bool isUnix() const { return storage.ss_family == AF_UNIX; }
+    static std::optional<SocketAddress> parse(const std::string &address);
+};
+
+#endif /* BANK_PROTOCOL_H */
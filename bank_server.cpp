@@ -0,0 +1,439 @@
+#include "bank_server.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+constexpr size_t READ_SIZE = 64 * 1024;
+// A connection stops reading while this much input is waiting to be executed, so one
+// client cannot make the server buffer without bound
+constexpr size_t MAX_BUFFERED_INPUT = 4 * 1024 * 1024;
+constexpr int MAX_EVENTS = 64;
+
+// epoll data for the two descriptors every loop watches besides its connections
+char listen_tag;
+char wake_tag;
+} // namespace
+
+struct BankServer::Connection
+{
+    int fd;
+    size_t slot; // index in its loop's connections
+    // Input is kept in input[input_start, input_end); the rest of the vector is free space
+    vector<char> input;
+    size_t input_start = 0;
+    size_t input_end = 0;
+    vector<char> output;
+    size_t output_start = 0;
+    bool writing = false;   // waiting for the socket to drain rather than reading
+    bool peer_done = false; // the client shut down its side
+    // Postings waiting to go to the bank as one batch, and where each one's response
+    // status byte is in output
+    vector<Operation> batch;
+    vector<size_t> batch_status_offsets;
+};
+
+struct BankServer::EventLoop
+{
+    int epoll_fd = -1;
+    vector<unique_ptr<Connection>> connections;
+
+    ~EventLoop()
+    {
+        for (unique_ptr<Connection> &connection : connections)
+        {
+            ::close(connection->fd);
+        }
+        if (epoll_fd >= 0)
+        {
+            ::close(epoll_fd);
+        }
+    }
+};
+
+unique_ptr<BankServer> BankServer::start(BankingSystem &bank, const string &address, size_t num_threads)
+{
+    optional<SocketAddress> socket_address = SocketAddress::parse(address);
+    if (!socket_address)
+    {
+        return nullptr;
+    }
+    int fd = ::socket(socket_address->storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    string unix_path;
+    if (socket_address->isUnix())
+    {
+        // Replace a socket left behind by an earlier run, but nothing else
+        unix_path = reinterpret_cast<const sockaddr_un &>(socket_address->storage).sun_path;
+        struct stat info;
+        if (::stat(unix_path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+        {
+            ::unlink(unix_path.c_str());
+        }
+    }
+    else
+    {
+        int enable = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    }
+    if (::bind(fd, reinterpret_cast<const sockaddr *>(&socket_address->storage), socket_address->length) != 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+    int wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    // From here on the destructor cleans up
+    unique_ptr<BankServer> server(new BankServer(bank, fd, wake_fd, unix_path));
+    if (wake_fd < 0 || ::listen(fd, SOMAXCONN) != 0)
+    {
+        return nullptr;
+    }
+    if (!socket_address->isUnix())
+    {
+        sockaddr_storage bound;
+        socklen_t length = sizeof(bound);
+        ::getsockname(fd, reinterpret_cast<sockaddr *>(&bound), &length);
+        server->bound_port = ntohs(bound.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6 &>(bound).sin6_port
+                                                               : reinterpret_cast<sockaddr_in &>(bound).sin_port);
+    }
+
+    if (num_threads == 0)
+    {
+        num_threads = max(thread::hardware_concurrency(), 1u);
+    }
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        unique_ptr<EventLoop> loop = make_unique<EventLoop>();
+        loop->epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epoll_fd < 0)
+        {
+            return nullptr;
+        }
+        // Exclusive, so a new connection wakes one loop rather than all of them
+        epoll_event listen_event{};
+        listen_event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        listen_event.data.ptr = &listen_tag;
+        epoll_event wake_event{};
+        wake_event.events = EPOLLIN;
+        wake_event.data.ptr = &wake_tag;
+        if (::epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &listen_event) != 0 ||
+            ::epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, wake_fd, &wake_event) != 0)
+        {
+            return nullptr;
+        }
+        server->loops.push_back(move(loop));
+    }
+    for (unique_ptr<EventLoop> &loop : server->loops)
+    {
+        server->threads.emplace_back(&BankServer::run, server.get(), ref(*loop));
+    }
+    return server;
+}
+
+BankServer::BankServer(BankingSystem &bank, int listen_fd, int wake_fd, string unix_path)
+    : bank(bank), listen_fd(listen_fd), wake_fd(wake_fd), unix_path(move(unix_path))
+{
+}
+
+BankServer::~BankServer()
+{
+    if (wake_fd >= 0)
+    {
+        // Never read, so it stays readable and wakes every loop
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = ::write(wake_fd, &one, sizeof(one));
+    }
+    for (thread &loop_thread : threads)
+    {
+        loop_thread.join();
+    }
+    loops.clear();
+    ::close(listen_fd);
+    if (wake_fd >= 0)
+    {
+        ::close(wake_fd);
+    }
+    if (!unix_path.empty())
+    {
+        ::unlink(unix_path.c_str());
+    }
+}
+
+void BankServer::run(EventLoop &loop)
+{
+    epoll_event events[MAX_EVENTS];
+    while (true)
+    {
+        int num_events = ::epoll_wait(loop.epoll_fd, events, MAX_EVENTS, -1);
+        if (num_events < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        for (int i = 0; i < num_events; ++i)
+        {
+            void *tag = events[i].data.ptr;
+            if (tag == &wake_tag)
+            {
+                return;
+            }
+            if (tag == &listen_tag)
+            {
+                accept(loop);
+                continue;
+            }
+            Connection &connection = *static_cast<Connection *>(tag);
+            if (!serve(loop, connection, events[i].events))
+            {
+                close(loop, connection);
+            }
+        }
+    }
+}
+
+void BankServer::accept(EventLoop &loop)
+{
+    while (true)
+    {
+        // Another loop may have taken the connection first, which shows up as EAGAIN
+        int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        if (unix_path.empty())
+        {
+            // Responses are batched already; Nagle would only delay the last one
+            int enable = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+        unique_ptr<Connection> connection = make_unique<Connection>();
+        connection->fd = fd;
+        connection->slot = loop.connections.size();
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = connection.get();
+        if (::epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            ::close(fd);
+            continue;
+        }
+        loop.connections.push_back(move(connection));
+        num_connections.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+bool BankServer::serve(EventLoop &loop, Connection &connection, uint32_t events)
+{
+    if (events & EPOLLERR)
+    {
+        return false;
+    }
+
+    if (!connection.writing && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)))
+    {
+        while (!connection.peer_done && connection.input_end - connection.input_start < MAX_BUFFERED_INPUT)
+        {
+            // Move what is left of the last read to the front, and grow only if that leaves
+            // too little room
+            if (connection.input.size() - connection.input_end < READ_SIZE)
+            {
+                if (connection.input_start == connection.input_end)
+                {
+                    connection.input_start = connection.input_end = 0;
+                }
+                else if (connection.input_start != 0)
+                {
+                    memmove(connection.input.data(), connection.input.data() + connection.input_start,
+                            connection.input_end - connection.input_start);
+                    connection.input_end -= connection.input_start;
+                    connection.input_start = 0;
+                }
+                if (connection.input.size() - connection.input_end < READ_SIZE)
+                {
+                    connection.input.resize(connection.input_end + READ_SIZE);
+                }
+            }
+            ssize_t received = ::recv(connection.fd, connection.input.data() + connection.input_end,
+                                      connection.input.size() - connection.input_end, 0);
+            if (received > 0)
+            {
+                connection.input_end += static_cast<size_t>(received);
+            }
+            else if (received == 0)
+            {
+                connection.peer_done = true;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        if (!execute(connection))
+        {
+            return false;
+        }
+    }
+
+    // Write everything the socket takes, in as few calls as it allows
+    while (connection.output_start < connection.output.size())
+    {
+        ssize_t sent = ::send(connection.fd, connection.output.data() + connection.output_start,
+                              connection.output.size() - connection.output_start, MSG_NOSIGNAL);
+        if (sent >= 0)
+        {
+            connection.output_start += static_cast<size_t>(sent);
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    bool drained = connection.output_start == connection.output.size();
+    if (drained)
+    {
+        connection.output.clear();
+        connection.output_start = 0;
+    }
+    if (drained == connection.writing)
+    {
+        // Wait for room to write instead of reading more, or go back to reading
+        connection.writing = !drained;
+        epoll_event event{};
+        event.events = connection.writing ? EPOLLOUT : EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = &connection;
+        ::epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+    return !(connection.peer_done && drained);
+}
+
+bool BankServer::execute(Connection &connection)
+{
+    size_t position = connection.input_start;
+    size_t num_executed = 0;
+    bool well_formed = true;
+    while (true)
+    {
+        Request request;
+        size_t consumed = 0;
+        DecodeResult result = decodeRequest(connection.input.data() + position, connection.input_end - position,
+                                            request, consumed);
+        if (result != DecodeResult::Complete)
+        {
+            well_formed = result == DecodeResult::Incomplete;
+            break;
+        }
+        position += consumed;
+        num_executed++;
+
+        Response response;
+        switch (request.opcode)
+        {
+        case RequestOpcode::Deposit:
+        case RequestOpcode::Withdraw:
+        case RequestOpcode::Transfer:
+        {
+            OperationType type = request.opcode == RequestOpcode::Deposit    ? OperationType::Deposit
+                                 : request.opcode == RequestOpcode::Withdraw ? OperationType::Withdrawal
+                                                                             : OperationType::Transfer;
+            connection.batch.push_back({type, request.account_number, request.to_account_number, request.amount});
+            // The status is filled in once the batch has run
+            encodeResponse(request.opcode, response, connection.output);
+            connection.batch_status_offsets.push_back(connection.output.size() - 1);
+            continue;
+        }
+        case RequestOpcode::CreateAccount:
+            flushBatch(connection);
+            response.status = bank.createAccount(request.account_number, string(request.owner), request.amount);
+            break;
+        case RequestOpcode::DeleteAccount:
+            flushBatch(connection);
+            response.status = bank.deleteAccount(request.account_number);
+            break;
+        case RequestOpcode::Balance:
+        {
+            flushBatch(connection);
+            optional<Money> balance = bank.begin().balance(request.account_number);
+            response.status = balance ? Status::Ok : Status::AccountNotFound;
+            response.balance = balance.value_or(Money());
+            break;
+        }
+        case RequestOpcode::Interest:
+            flushBatch(connection);
+            response.status = bank.calculateInterest(request.rate);
+            break;
+        }
+        encodeResponse(request.opcode, response, connection.output);
+    }
+    flushBatch(connection);
+    num_requests.fetch_add(num_executed, memory_order_relaxed);
+
+    connection.input_start = position;
+    if (connection.input_start == connection.input_end)
+    {
+        connection.input_start = 0;
+        connection.input_end = 0;
+    }
+    return well_formed;
+}
+
+void BankServer::flushBatch(Connection &connection)
+{
+    if (connection.batch.empty())
+    {
+        return;
+    }
+    BatchResult result = bank.applyBatch(connection.batch);
+    for (size_t i = 0; i < result.statuses.size(); ++i)
+    {
+        connection.output[connection.batch_status_offsets[i]] = static_cast<char>(result.statuses[i]);
+    }
+    connection.batch.clear();
+    connection.batch_status_offsets.clear();
+}
+
+void BankServer::close(EventLoop &loop, Connection &connection)
+{
+    ::epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, connection.fd, nullptr);
+    ::close(connection.fd);
+    // Swap the last connection into this one's slot
+    size_t slot = connection.slot;
+    swap(loop.connections[slot], loop.connections.back());
+    loop.connections[slot]->slot = slot;
+    loop.connections.pop_back();
+    num_connections.fetch_sub(1, memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+#ifndef BANK_SERVER_H
+#define BANK_SERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bank_protocol.h"
+#include "banking_system.h"
+
+// Serves a BankingSystem over TCP or a Unix domain socket with the protocol in
+// bank_protocol.h. Each event-loop thread has its own epoll instance and accepts from the
+// shared listening socket, so a connection stays on the thread that accepted it. A
+// readable connection is drained into its input buffer and every complete request in it
+// is executed before anything is written; runs of consecutive deposits, withdrawals and
+// transfers go to the bank as one applyBatch, and all the responses go out in one write.
+// A connection whose client stops reading is not read from either until its pending
+// responses drain, and one that sends a malformed message is closed.
+class BankServer
+{
+public:
+    // Listens on address (see SocketAddress) and starts num_threads event loops, 0 for one
+    // per hardware thread. Returns null if the address is invalid or cannot be bound. The
+    // bank is not owned and must outlive the server.
+    static std::unique_ptr<BankServer> start(BankingSystem &bank, const std::string &address,
+                                             std::size_t num_threads = 0);
+    // Stops the event loops and closes every connection; requests already read have been
+    // answered, later ones are dropped
+    ~BankServer();
+    BankServer(const BankServer &) = delete;
+    BankServer &operator=(const BankServer &) = delete;
+
+    // Port the server listens on, e.g. the one picked for port 0; 0 for a Unix socket
+    uint16_t port() const { return bound_port; }
+    std::size_t connectionCount() const { return num_connections.load(std::memory_order_relaxed); }
+    std::size_t requestCount() const { return num_requests.load(std::memory_order_relaxed); }
+
+private:
+    struct Connection;
+    struct EventLoop;
+
+    BankServer(BankingSystem &bank, int listen_fd, int wake_fd, std::string unix_path);
+
+    void run(EventLoop &loop);
+    void accept(EventLoop &loop);
+    // Reads, executes and writes as far as the socket allows; false once the connection is done
+    bool serve(EventLoop &loop, Connection &connection, uint32_t events);
+    // Executes every complete request in the input buffer; false on a protocol error
+    bool execute(Connection &connection);
+    void flushBatch(Connection &connection);
+    void close(EventLoop &loop, Connection &connection);
+
+    BankingSystem &bank;
+    int listen_fd;
+    int wake_fd;            // eventfd that tells every loop to stop
+    std::string unix_path;  // removed on shutdown; empty for TCP
+    uint16_t bound_port = 0;
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> num_connections{0};
+    std::atomic<std::size_t> num_requests{0};
+};
+
+#endif /* BANK_SERVER_H */
@@ -0,0 +1,108 @@
+#include <signal.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "bank_server.h"
+#include "banking_system.h"
+#include "journal.h"
+
+using namespace std;
+
+// Serves a bank until SIGINT or SIGTERM, then prints its metrics. With --journal, the
+// bank is first recovered from the journal and every change is journaled from then on.
+
+namespace
+{
+void usage()
+{
+    cerr << "usage: banking_server [--address host:port|unix:path] [--threads N] [--journal path]\n";
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    string address = "127.0.0.1:7878";
+    size_t num_threads = 0;
+    string journal_path;
+    for (int i = 1; i < argc; ++i)
+    {
+        string name = argv[i];
+        if (i + 1 == argc)
+        {
+            usage();
+            return 2;
+        }
+        const char *value = argv[++i];
+        if (name == "--address")
+        {
+            address = value;
+        }
+        else if (name == "--threads")
+        {
+            num_threads = strtoul(value, nullptr, 10);
+        }
+        else if (name == "--journal")
+        {
+            journal_path = value;
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    // Blocked before any thread starts, so every thread inherits the mask and the signals
+    // are only taken by sigwait below
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    BankingSystem bank;
+    unique_ptr<Journal> journal;
+    if (!journal_path.empty())
+    {
+        optional<size_t> replayed = bank.recover(journal_path);
+        if (!replayed)
+        {
+            cerr << "Journal " << journal_path << " holds records this version cannot read\n";
+            return 1;
+        }
+        journal = Journal::open(journal_path);
+        if (!journal)
+        {
+            cerr << "Could not open journal " << journal_path << '\n';
+            return 1;
+        }
+        bank.attachJournal(journal.get());
+        cout << "Recovered " << *replayed << " journal records\n";
+    }
+
+    unique_ptr<BankServer> server = BankServer::start(bank, address, num_threads);
+    if (!server)
+    {
+        cerr << "Could not listen on " << address << '\n';
+        return 1;
+    }
+    cout << "Listening on " << address;
+    if (server->port() != 0)
+    {
+        cout << " (port " << server->port() << ')';
+    }
+    cout << endl;
+
+    int signal_number;
+    sigwait(&signals, &signal_number);
+    size_t num_requests = server->requestCount();
+    server.reset();
+    bank.attachJournal(nullptr);
+    cout << "Served " << num_requests << " requests\n";
+    writeMetricsText(cout, bank.metricsSnapshot());
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef BANK_TOTALS_H
+#define BANK_TOTALS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "money.h"
+#include "transaction.h"
+
+constexpr std::size_t NUM_TRANSACTION_TYPES = static_cast<std::size_t>(TransactionType::Credit) + 1;
+
+// Number of history records of one type and the sum of their amounts
+struct TypeTotals
+{
+    uint64_t count = 0;
+    Money volume;
+};
+
+// Bank-wide running totals: the sum of every balance, and the number and volume of
+// history records of each type. Updates go to one of NUM_STRIPES cache-line-sized stripes
+// picked by account number, so operations on different accounts rarely touch the same
+// line; reads add up the stripes, which costs the same for any number of accounts.
+// Every update is a relaxed atomic add, so a read taken while operations are in flight
+// can see part of one; totals are exact whenever none is.
+class BankTotals
+{
+public:
+    static constexpr std::size_t NUM_STRIPES = 64;
+
+    BankTotals() = default;
+    BankTotals(const BankTotals &) = delete;
+    BankTotals &operator=(const BankTotals &) = delete;
+
+    void addBalance(int32_t account_number, Money delta)
+    {
+        stripeFor(account_number).balance.fetch_add(delta.minorUnits(), std::memory_order_relaxed);
+    }
+    void addRecord(int32_t account_number, TransactionType type, Money amount)
+    {
+        Stripe &stripe = stripeFor(account_number);
+        std::size_t t = static_cast<std::size_t>(type);
+        stripe.counts[t].fetch_add(1, std::memory_order_relaxed);
+        stripe.volumes[t].fetch_add(amount.minorUnits(), std::memory_order_relaxed);
+    }
+    // Adds a group of records, or with sign -1 takes them away, e.g. when a history is discarded
+    void addRecords(int32_t account_number, TransactionType type, const TypeTotals &records, int64_t sign)
+    {
+        Stripe &stripe = stripeFor(account_number);
+        std::size_t t = static_cast<std::size_t>(type);
+        stripe.counts[t].fetch_add(sign * static_cast<int64_t>(records.count), std::memory_order_relaxed);
+        stripe.volumes[t].fetch_add(sign * records.volume.minorUnits(), std::memory_order_relaxed);
+    }
+
+    Money balance() const
+    {
+        int64_t total = 0;
+        for (const Stripe &stripe : stripes)
+        {
+            total += stripe.balance.load(std::memory_order_relaxed);
+        }
+        return Money::fromMinorUnits(total);
+    }
+    TypeTotals records(TransactionType type) const
+    {
+        std::size_t t = static_cast<std::size_t>(type);
+        int64_t count = 0;
+        int64_t volume = 0;
+        for (const Stripe &stripe : stripes)
+        {
+            count += stripe.counts[t].load(std::memory_order_relaxed);
+            volume += stripe.volumes[t].load(std::memory_order_relaxed);
+        }
+        return {static_cast<uint64_t>(count), Money::fromMinorUnits(volume)};
+    }
+
+private:
+    struct alignas(64) Stripe
+    {
+        std::atomic<int64_t> balance{0};
+        std::atomic<int64_t> counts[NUM_TRANSACTION_TYPES] = {};
+        std::atomic<int64_t> volumes[NUM_TRANSACTION_TYPES] = {};
+    };
+
+    Stripe &stripeFor(int32_t account_number)
+    {
+        return stripes[static_cast<uint32_t>(account_number) % NUM_STRIPES];
+    }
+
+    Stripe stripes[NUM_STRIPES];
+};
+
+#endif /* BANK_TOTALS_H */
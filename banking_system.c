@@ -1,3 +1,5 @@
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,13 +7,45 @@
 #define MAX_ACCOUNTS 100
 #define MAX_NAME_LENGTH 50
 #define MAX_TRANSACTIONS 100
+#define MINOR_UNITS_PER_UNIT 100
+#define MONEY_TEXT_SIZE 32
+#define SNAPSHOT_VERSION 1
+#define OWNER_TABLE_SIZE 256 // power of two, at least twice MAX_ACCOUNTS
+#define MIN_INTEREST_RATE -1.0 // below it, 1 + rate would flip the sign of every balance
+#define MAX_INTEREST_RATE 10.0
+
+// Money is held as a signed 64-bit count of minor currency units (cents)
+typedef int64_t money_t;
+
+// How a result that falls between two minor units is rounded
+typedef enum
+{
+    ROUND_HALF_EVEN,
+    ROUND_HALF_UP,
+    ROUND_DOWN,
+    ROUND_FLOOR,
+    ROUND_CEILING
+} rounding_mode;
+
+// Outcome of an operation; the operations themselves print nothing
+typedef enum
+{
+    STATUS_OK,
+    STATUS_ACCOUNT_NOT_FOUND,
+    STATUS_TOO_MANY_ACCOUNTS,
+    STATUS_INVALID_AMOUNT,
+    STATUS_INSUFFICIENT_FUNDS,
+    STATUS_HISTORY_FULL, // the account already holds MAX_TRANSACTIONS transactions
+    STATUS_IO_ERROR,
+    STATUS_INVALID_SNAPSHOT
+} status;
 
 // Structure to represent a transaction
 typedef struct
 {
     int account_number;
-    char type[20]; // "Deposit", "Withdrawal", "Transfer"
-    double amount;
+    char type[20]; // "Deposit", "Withdrawal", "Transfer", "Interest"
+    money_t amount;
 } Transaction;
 
 // Structure to represent an account
@@ -19,27 +53,174 @@ typedef struct
 {
     int account_number;
     char owner[MAX_NAME_LENGTH];
-    double balance;
+    money_t balance;
     Transaction transactions[MAX_TRANSACTIONS];
     int num_transactions;
 } Account;
 
+// Header of a snapshot file, which is followed by num_accounts Account records
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t checksum; // CRC-32C of the account records
+    int32_t num_accounts;
+} SnapshotHeader;
+
 // Array to store all accounts
 Account accounts[MAX_ACCOUNTS];
 int num_accounts = 0;
 
+// Open-addressing hash table on owner name; each entry is an index into accounts plus one,
+// or 0 for an empty entry
+int owner_table[OWNER_TABLE_SIZE];
+
 // Function prototypes
+money_t money_from_double(double amount, rounding_mode mode);
+int money_add(money_t a, money_t b, money_t *result);
+int money_subtract(money_t a, money_t b, money_t *result);
+int money_scale(money_t amount, int64_t numerator, int64_t denominator, rounding_mode mode, money_t *result);
+const char *format_money(money_t amount, char *buffer);
 Account *find_account(int account_number);
-void create_account(int account_number, const char *owner, double initial_balance);
-void deposit(int account_number, double amount);
-void withdraw(int account_number, double amount);
-void transfer(int from_account_number, int to_account_number, double amount);
-void calculate_interest(double rate);
+const char *status_message(status result);
+uint32_t hash_owner(const char *owner);
+void index_owner(int index);
+void rebuild_owner_table();
+status create_account(int account_number, const char *owner, money_t initial_balance);
+status deposit(int account_number, money_t amount);
+status withdraw(int account_number, money_t amount);
+status transfer(int from_account_number, int to_account_number, money_t amount);
+status calculate_interest(double rate);
 void display_transactions(int account_number);
-void delete_account(int account_number);
+status delete_account(int account_number);
 void display_account_details(int account_number);
 void display_all_accounts();
 void search_accounts_by_owner(const char *owner_name);
+uint32_t crc32c(const void *data, size_t length);
+status save_snapshot(const char *path);
+status load_snapshot(const char *path);
+
+// Function to convert a decimal amount to minor units, saturating outside the money_t range
+money_t money_from_double(double amount, rounding_mode mode)
+{
+    double scaled = amount * MINOR_UNITS_PER_UNIT;
+    switch (mode)
+    {
+    case ROUND_HALF_EVEN:
+        scaled = nearbyint(scaled);
+        break;
+    case ROUND_HALF_UP:
+        scaled = round(scaled);
+        break;
+    case ROUND_DOWN:
+        scaled = trunc(scaled);
+        break;
+    case ROUND_FLOOR:
+        scaled = floor(scaled);
+        break;
+    case ROUND_CEILING:
+        scaled = ceil(scaled);
+        break;
+    }
+    if (scaled >= 9223372036854775808.0)
+    {
+        return INT64_MAX;
+    }
+    if (scaled < -9223372036854775808.0 || isnan(scaled))
+    {
+        return INT64_MIN;
+    }
+    return (money_t)scaled;
+}
+
+// Function to add two amounts; returns 0 on overflow
+int money_add(money_t a, money_t b, money_t *result)
+{
+    return !__builtin_add_overflow(a, b, result);
+}
+
+// Function to subtract two amounts; returns 0 on overflow
+int money_subtract(money_t a, money_t b, money_t *result)
+{
+    return !__builtin_sub_overflow(a, b, result);
+}
+
+// Function to multiply an amount by numerator / denominator with rounding; returns 0 on overflow
+int money_scale(money_t amount, int64_t numerator, int64_t denominator, rounding_mode mode, money_t *result)
+{
+    __int128 product = (__int128)amount * numerator;
+    __int128 quotient = product / denominator;
+    __int128 remainder = product % denominator;
+    if (remainder != 0)
+    {
+        int negative = remainder < 0;
+        __int128 twice_remainder = (negative ? -remainder : remainder) * 2;
+        int away = 0;
+        switch (mode)
+        {
+        case ROUND_HALF_EVEN:
+            away = twice_remainder > denominator || (twice_remainder == denominator && (quotient & 1) != 0);
+            break;
+        case ROUND_HALF_UP:
+            away = twice_remainder >= denominator;
+            break;
+        case ROUND_DOWN:
+            away = 0;
+            break;
+        case ROUND_FLOOR:
+            away = negative;
+            break;
+        case ROUND_CEILING:
+            away = !negative;
+            break;
+        }
+        if (away)
+        {
+            quotient += negative ? -1 : 1;
+        }
+    }
+    if (quotient > INT64_MAX || quotient < INT64_MIN)
+    {
+        return 0;
+    }
+    *result = (money_t)quotient;
+    return 1;
+}
+
+// Function to format an amount with two decimals into a MONEY_TEXT_SIZE buffer
+const char *format_money(money_t amount, char *buffer)
+{
+    uint64_t magnitude = amount < 0 ? 0 - (uint64_t)amount : (uint64_t)amount;
+    snprintf(buffer, MONEY_TEXT_SIZE, "%s%llu.%02llu", amount < 0 ? "-" : "",
+             (unsigned long long)(magnitude / MINOR_UNITS_PER_UNIT),
+             (unsigned long long)(magnitude % MINOR_UNITS_PER_UNIT));
+    return buffer;
+}
+
+// Function to describe a failed operation
+const char *status_message(status result)
+{
+    switch (result)
+    {
+    case STATUS_OK:
+        return "OK.";
+    case STATUS_ACCOUNT_NOT_FOUND:
+        return "Error: Account not found.";
+    case STATUS_TOO_MANY_ACCOUNTS:
+        return "Error: Maximum number of accounts reached.";
+    case STATUS_INVALID_AMOUNT:
+        return "Error: Invalid amount.";
+    case STATUS_INSUFFICIENT_FUNDS:
+        return "Error: Insufficient funds.";
+    case STATUS_HISTORY_FULL:
+        return "Error: Transaction history is full.";
+    case STATUS_IO_ERROR:
+        return "Error: Could not read or write the file.";
+    case STATUS_INVALID_SNAPSHOT:
+        return "Error: Not a valid snapshot.";
+    }
+    return "Error: Unknown status.";
+}
 
 // Function to find an account by account number
 Account *find_account(int account_number)
@@ -54,13 +235,48 @@ Account *find_account(int account_number)
     return NULL;
 }
 
+// Function to hash an owner name (FNV-1a), reading at most MAX_NAME_LENGTH characters
+uint32_t hash_owner(const char *owner)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < MAX_NAME_LENGTH && owner[i] != '\0'; ++i)
+    {
+        hash = (hash ^ (unsigned char)owner[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Function to add accounts[index] to the owner table
+void index_owner(int index)
+{
+    uint32_t slot = hash_owner(accounts[index].owner) & (OWNER_TABLE_SIZE - 1);
+    while (owner_table[slot] != 0)
+    {
+        slot = (slot + 1) & (OWNER_TABLE_SIZE - 1);
+    }
+    owner_table[slot] = index + 1;
+}
+
+// Function to rebuild the owner table after accounts have moved
+void rebuild_owner_table()
+{
+    memset(owner_table, 0, sizeof(owner_table));
+    for (int i = 0; i < num_accounts; ++i)
+    {
+        index_owner(i);
+    }
+}
+
 // Function to create a new account
-void create_account(int account_number, const char *owner, double initial_balance)
+status create_account(int account_number, const char *owner, money_t initial_balance)
 {
     if (num_accounts >= MAX_ACCOUNTS)
     {
-        printf("Error: Maximum number of accounts reached.\n");
-        return;
+        return STATUS_TOO_MANY_ACCOUNTS;
+    }
+    if (initial_balance < 0)
+    {
+        return STATUS_INVALID_AMOUNT;
     }
 
     Account new_account;
@@ -70,47 +286,56 @@ void create_account(int account_number, const char *owner, double initial_balanc
     new_account.num_transactions = 0;
 
     accounts[num_accounts++] = new_account;
-    printf("Account created successfully.\n");
+    index_owner(num_accounts - 1);
+    return STATUS_OK;
 }
 
 // Function to deposit money into an account
-void deposit(int account_number, double amount)
+status deposit(int account_number, money_t amount)
 {
     Account *account = find_account(account_number);
     if (account == NULL)
     {
-        printf("Error: Account not found.\n");
-        return;
+        return STATUS_ACCOUNT_NOT_FOUND;
     }
-    if (amount <= 0)
+    money_t new_balance;
+    if (amount <= 0 || !money_add(account->balance, amount, &new_balance))
     {
-        printf("Error: Invalid amount.\n");
-        return;
+        return STATUS_INVALID_AMOUNT;
+    }
+    if (account->num_transactions >= MAX_TRANSACTIONS)
+    {
+        return STATUS_HISTORY_FULL;
     }
-    account->balance += amount;
+    account->balance = new_balance;
 
     // Update transaction history
     Transaction *transaction = &account->transactions[account->num_transactions++];
     transaction->account_number = account_number;
     strcpy(transaction->type, "Deposit");
     transaction->amount = amount;
-
-    printf("Deposit successful. New balance: %.2f\n", account->balance);
+    return STATUS_OK;
 }
 
 // Function to withdraw money from an account
-void withdraw(int account_number, double amount)
+status withdraw(int account_number, money_t amount)
 {
     Account *account = find_account(account_number);
     if (account == NULL)
     {
-        printf("Error: Account not found.\n");
-        return;
+        return STATUS_ACCOUNT_NOT_FOUND;
     }
-    if (amount <= 0 || amount > account->balance)
+    if (amount <= 0)
     {
-        printf("Error: Insufficient funds or invalid amount.\n");
-        return;
+        return STATUS_INVALID_AMOUNT;
+    }
+    if (amount > account->balance)
+    {
+        return STATUS_INSUFFICIENT_FUNDS;
+    }
+    if (account->num_transactions >= MAX_TRANSACTIONS)
+    {
+        return STATUS_HISTORY_FULL;
     }
     account->balance -= amount;
 
@@ -119,27 +344,39 @@ void withdraw(int account_number, double amount)
     transaction->account_number = account_number;
     strcpy(transaction->type, "Withdrawal");
     transaction->amount = amount;
-
-    printf("Withdrawal successful. New balance: %.2f\n", account->balance);
+    return STATUS_OK;
 }
 
 // Function to transfer money between two accounts
-void transfer(int from_account_number, int to_account_number, double amount)
+status transfer(int from_account_number, int to_account_number, money_t amount)
 {
     Account *from_account = find_account(from_account_number);
     Account *to_account = find_account(to_account_number);
     if (from_account == NULL || to_account == NULL)
     {
-        printf("Error: One or both accounts not found.\n");
-        return;
+        return STATUS_ACCOUNT_NOT_FOUND;
     }
-    if (amount <= 0 || amount > from_account->balance)
+    if (amount <= 0)
     {
-        printf("Error: Insufficient funds or invalid amount.\n");
-        return;
+        return STATUS_INVALID_AMOUNT;
+    }
+    if (amount > from_account->balance)
+    {
+        return STATUS_INSUFFICIENT_FUNDS;
+    }
+    money_t new_to_balance;
+    if (!money_add(to_account->balance, amount, &new_to_balance))
+    {
+        return STATUS_INVALID_AMOUNT;
+    }
+    // A transfer to the same account posts both transactions to it
+    int to_room = to_account == from_account ? MAX_TRANSACTIONS - 1 : MAX_TRANSACTIONS;
+    if (from_account->num_transactions >= MAX_TRANSACTIONS || to_account->num_transactions >= to_room)
+    {
+        return STATUS_HISTORY_FULL;
     }
     from_account->balance -= amount;
-    to_account->balance += amount;
+    to_account->balance = new_to_balance;
 
     // Update transaction history for both accounts
     Transaction *transaction1 = &from_account->transactions[from_account->num_transactions++];
@@ -151,24 +388,46 @@ void transfer(int from_account_number, int to_account_number, double amount)
     transaction2->account_number = to_account_number;
     strcpy(transaction2->type, "Transfer (from)");
     transaction2->amount = amount;
-
-    printf("Transfer successful. New balance for %s: %.2f\n", from_account->owner, from_account->balance);
-    printf("New balance for %s: %.2f\n", to_account->owner, to_account->balance);
+    return STATUS_OK;
 }
 
 // Function to calculate interest for all accounts
-void calculate_interest(double rate)
+// Accounts whose history is full are skipped, and reported as STATUS_HISTORY_FULL
+status calculate_interest(double rate)
 {
+    if (!isfinite(rate) || rate < MIN_INTEREST_RATE || rate > MAX_INTEREST_RATE)
+    {
+        return STATUS_INVALID_AMOUNT;
+    }
+    // Apply the rate in parts per billion so each balance is scaled exactly and rounded once
+    const int64_t rate_scale = 1000000000;
+    int64_t factor = rate_scale + llround(rate * rate_scale);
+    status result = STATUS_OK;
     for (int i = 0; i < num_accounts; ++i)
     {
-        accounts[i].balance *= (1 + rate);
+        money_t new_balance;
+        if (money_scale(accounts[i].balance, factor, rate_scale, ROUND_HALF_EVEN, &new_balance) &&
+            new_balance != accounts[i].balance)
+        {
+            if (accounts[i].num_transactions >= MAX_TRANSACTIONS)
+            {
+                result = STATUS_HISTORY_FULL;
+                continue;
+            }
+            Transaction *transaction = &accounts[i].transactions[accounts[i].num_transactions++];
+            transaction->account_number = accounts[i].account_number;
+            strcpy(transaction->type, "Interest");
+            transaction->amount = new_balance - accounts[i].balance;
+            accounts[i].balance = new_balance;
+        }
     }
-    printf("Interest calculated and applied to all accounts.\n");
+    return result;
 }
 
 // Function to display transaction history for an account
 void display_transactions(int account_number)
 {
+    char amount_text[MONEY_TEXT_SIZE];
     Account *account = find_account(account_number);
     if (account == NULL)
     {
@@ -179,12 +438,12 @@ void display_transactions(int account_number)
     for (int i = 0; i < account->num_transactions; ++i)
     {
         Transaction *transaction = &account->transactions[i];
-        printf("Type: %s, Amount: %.2f\n", transaction->type, transaction->amount);
+        printf("Type: %s, Amount: %s\n", transaction->type, format_money(transaction->amount, amount_text));
     }
 }
 
 // Function to delete an account
-void delete_account(int account_number)
+status delete_account(int account_number)
 {
     for (int i = 0; i < num_accounts; ++i)
     {
@@ -196,16 +455,17 @@ void delete_account(int account_number)
                 accounts[j] = accounts[j + 1];
             }
             num_accounts--;
-            printf("Account %d deleted successfully.\n", account_number);
-            return;
+            rebuild_owner_table();
+            return STATUS_OK;
         }
     }
-    printf("Error: Account not found.\n");
+    return STATUS_ACCOUNT_NOT_FOUND;
 }
 
 // Function to display details of a specific account
 void display_account_details(int account_number)
 {
+    char amount_text[MONEY_TEXT_SIZE];
     Account *account = find_account(account_number);
     if (account == NULL)
     {
@@ -214,7 +474,7 @@ void display_account_details(int account_number)
     }
     printf("Account Number: %d\n", account->account_number);
     printf("Owner: %s\n", account->owner);
-    printf("Balance: %.2f\n", account->balance);
+    printf("Balance: %s\n", format_money(account->balance, amount_text));
     printf("Transaction History:\n");
     display_transactions(account_number);
 }
@@ -222,26 +482,95 @@ void display_account_details(int account_number)
 // Function to display details of all accounts
 void display_all_accounts()
 {
+    char amount_text[MONEY_TEXT_SIZE];
     printf("List of all accounts:\n");
     for (int i = 0; i < num_accounts; ++i)
     {
-        printf("Account Number: %d, Owner: %s, Balance: %.2f\n",
-               accounts[i].account_number, accounts[i].owner, accounts[i].balance);
+        printf("Account Number: %d, Owner: %s, Balance: %s\n",
+               accounts[i].account_number, accounts[i].owner, format_money(accounts[i].balance, amount_text));
     }
 }
 
 // Function to search accounts by owner name
 void search_accounts_by_owner(const char *owner_name)
 {
+    char amount_text[MONEY_TEXT_SIZE];
     printf("Accounts owned by %s:\n", owner_name);
-    for (int i = 0; i < num_accounts; ++i)
+    // Same-named accounts share a probe run, in the order they were indexed
+    uint32_t slot = hash_owner(owner_name) & (OWNER_TABLE_SIZE - 1);
+    for (; owner_table[slot] != 0; slot = (slot + 1) & (OWNER_TABLE_SIZE - 1))
+    {
+        Account *account = &accounts[owner_table[slot] - 1];
+        if (strncmp(account->owner, owner_name, MAX_NAME_LENGTH) == 0)
+        {
+            printf("Account Number: %d, Balance: %s\n",
+                   account->account_number, format_money(account->balance, amount_text));
+        }
+    }
+}
+
+// Function to checksum a block of memory (CRC-32C, bit at a time)
+uint32_t crc32c(const void *data, size_t length)
+{
+    const unsigned char *bytes = data;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i)
     {
-        if (strcmp(accounts[i].owner, owner_name) == 0)
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; ++bit)
         {
-            printf("Account Number: %d, Balance: %.2f\n",
-                   accounts[i].account_number, accounts[i].balance);
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
         }
     }
+    return ~crc;
+}
+
+// Function to write every account to a snapshot file
+status save_snapshot(const char *path)
+{
+    SnapshotHeader header = {{'B', 'A', 'N', 'K', 'S', 'N', 'P', 'C'}, SNAPSHOT_VERSION, 0, num_accounts};
+    header.checksum = crc32c(accounts, sizeof(Account) * num_accounts);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return STATUS_IO_ERROR;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(accounts, sizeof(Account), num_accounts, file) == (size_t)num_accounts;
+    if (fclose(file) != 0 || !ok)
+    {
+        return STATUS_IO_ERROR;
+    }
+    return STATUS_OK;
+}
+
+// Function to replace every account with the contents of a snapshot file
+status load_snapshot(const char *path)
+{
+    static Account loaded[MAX_ACCOUNTS];
+    SnapshotHeader header;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return STATUS_IO_ERROR;
+    }
+    int ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "BANKSNPC", 8) == 0 &&
+             header.version == SNAPSHOT_VERSION && header.num_accounts >= 0 && header.num_accounts <= MAX_ACCOUNTS &&
+             fread(loaded, sizeof(Account), header.num_accounts, file) == (size_t)header.num_accounts &&
+             crc32c(loaded, sizeof(Account) * header.num_accounts) == header.checksum;
+    fclose(file);
+    for (int i = 0; ok && i < header.num_accounts; ++i)
+    {
+        ok = loaded[i].num_transactions >= 0 && loaded[i].num_transactions <= MAX_TRANSACTIONS;
+    }
+    if (!ok)
+    {
+        return STATUS_INVALID_SNAPSHOT;
+    }
+    memcpy(accounts, loaded, sizeof(Account) * header.num_accounts);
+    num_accounts = header.num_accounts;
+    rebuild_owner_table();
+    return STATUS_OK;
 }
 
 // Main function with user interaction
@@ -253,6 +582,9 @@ int main()
     double amount;
     double rate;
     char owner_name[MAX_NAME_LENGTH];
+    char amount_text[MONEY_TEXT_SIZE];
+    char path[256];
+    status result;
 
     do
     {
@@ -267,6 +599,8 @@ int main()
         printf("8. Display All Accounts\n");
         printf("9. Search Accounts by Owner\n");
         printf("10. Delete Account\n");
+        printf("11. Save Snapshot\n");
+        printf("12. Load Snapshot\n");
         printf("0. Exit\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
@@ -280,21 +614,40 @@ int main()
             scanf("%s", owner);
             printf("Enter initial balance: ");
             scanf("%lf", &amount);
-            create_account(account_number, owner, amount);
+            result = create_account(account_number, owner, money_from_double(amount, ROUND_HALF_EVEN));
+            printf("%s\n", result == STATUS_OK ? "Account created successfully." : status_message(result));
             break;
         case 2:
             printf("Enter account number: ");
             scanf("%d", &account_number);
             printf("Enter amount to deposit: ");
             scanf("%lf", &amount);
-            deposit(account_number, amount);
+            result = deposit(account_number, money_from_double(amount, ROUND_HALF_EVEN));
+            if (result == STATUS_OK)
+            {
+                printf("Deposit successful. New balance: %s\n",
+                       format_money(find_account(account_number)->balance, amount_text));
+            }
+            else
+            {
+                printf("%s\n", status_message(result));
+            }
             break;
         case 3:
             printf("Enter account number: ");
             scanf("%d", &account_number);
             printf("Enter amount to withdraw: ");
             scanf("%lf", &amount);
-            withdraw(account_number, amount);
+            result = withdraw(account_number, money_from_double(amount, ROUND_HALF_EVEN));
+            if (result == STATUS_OK)
+            {
+                printf("Withdrawal successful. New balance: %s\n",
+                       format_money(find_account(account_number)->balance, amount_text));
+            }
+            else
+            {
+                printf("%s\n", status_message(result));
+            }
             break;
         case 4:
             printf("Enter source account number: ");
@@ -304,12 +657,30 @@ int main()
             scanf("%d", &dest_account_number);
             printf("Enter amount to transfer: ");
             scanf("%lf", &amount);
-            transfer(account_number, dest_account_number, amount);
+            result = transfer(account_number, dest_account_number, money_from_double(amount, ROUND_HALF_EVEN));
+            if (result == STATUS_OK)
+            {
+                Account *from_account = find_account(account_number);
+                Account *to_account = find_account(dest_account_number);
+                printf("Transfer successful. New balance for %s: %s\n", from_account->owner,
+                       format_money(from_account->balance, amount_text));
+                printf("New balance for %s: %s\n", to_account->owner, format_money(to_account->balance, amount_text));
+            }
+            else if (result == STATUS_ACCOUNT_NOT_FOUND)
+            {
+                printf("Error: One or both accounts not found.\n");
+            }
+            else
+            {
+                printf("%s\n", status_message(result));
+            }
             break;
         case 5:
             printf("Enter interest rate: ");
             scanf("%lf", &rate);
-            calculate_interest(rate);
+            result = calculate_interest(rate);
+            printf("%s\n",
+                   result == STATUS_OK ? "Interest calculated and applied to all accounts." : status_message(result));
             break;
         case 6:
             printf("Enter account number: ");
@@ -332,7 +703,34 @@ int main()
         case 10:
             printf("Enter account number to delete: ");
             scanf("%d", &account_number);
-            delete_account(account_number);
+            result = delete_account(account_number);
+            if (result == STATUS_OK)
+            {
+                printf("Account %d deleted successfully.\n", account_number);
+            }
+            else
+            {
+                printf("%s\n", status_message(result));
+            }
+            break;
+        case 11:
+            printf("Enter snapshot file: ");
+            scanf("%255s", path);
+            result = save_snapshot(path);
+            printf("%s\n", result == STATUS_OK ? "Snapshot saved." : status_message(result));
+            break;
+        case 12:
+            printf("Enter snapshot file: ");
+            scanf("%255s", path);
+            result = load_snapshot(path);
+            if (result == STATUS_OK)
+            {
+                printf("Loaded %d accounts.\n", num_accounts);
+            }
+            else
+            {
+                printf("%s\n", status_message(result));
+            }
             break;
         case 0:
             printf("Exiting...\n");
@@ -1,225 +1,1478 @@
 #include "banking_system.h"
 
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <sstream>
+#include <thread>
+
 using namespace std;
 
-BankingSystem::BankingSystem() : num_accounts(0) {}
+namespace
+{
+thread_local DeferredCommit *deferred_commit = nullptr;
+} // namespace
 
-Account *BankingSystem::findAccount(int account_number)
+DeferredCommit::DeferredCommit()
+{
+    deferred_commit = this;
+}
+
+DeferredCommit::~DeferredCommit()
+{
+    deferred_commit = nullptr;
+}
+
+BankingSystem::BankingSystem() {}
+
+template <typename... Args>
+void BankingSystem::log(const Args &...args)
+{
+    LogSink *sink = log_sink.load(memory_order_acquire);
+    if (sink == nullptr)
+    {
+        return;
+    }
+    // Reused per thread so a message costs no stream construction
+    thread_local ostringstream message;
+    message.str(string());
+    (message << ... << args);
+    sink->write(message.view());
+}
+
+Account *BankingSystem::lookup(IndexStripe &stripe, int account_number)
+{
+    int32_t handle = stripe.index.find(account_number);
+    return handle == AccountIndex::NOT_FOUND ? nullptr : &accounts[handle];
+}
+
+vector<shared_lock<shared_mutex>> BankingSystem::lockAllStripes()
+{
+    vector<shared_lock<shared_mutex>> locks;
+    locks.reserve(NUM_INDEX_STRIPES);
+    for (IndexStripe &stripe : stripes)
+    {
+        locks.emplace_back(stripe.mutex);
+    }
+    return locks;
+}
+
+vector<unique_lock<shared_mutex>> BankingSystem::lockAllStripesExclusive()
+{
+    vector<unique_lock<shared_mutex>> locks;
+    locks.reserve(NUM_INDEX_STRIPES);
+    for (IndexStripe &stripe : stripes)
+    {
+        locks.emplace_back(stripe.mutex);
+    }
+    return locks;
+}
+
+vector<unique_lock<shared_mutex>> BankingSystem::lockStripesExclusive(uint64_t stripe_mask)
 {
-    for (int i = 0; i < num_accounts; ++i)
+    vector<unique_lock<shared_mutex>> locks;
+    for (int i = 0; i < NUM_INDEX_STRIPES; ++i)
     {
-        if (accounts[i].account_number == account_number)
+        if (stripe_mask & (uint64_t(1) << i))
         {
-            return &accounts[i];
+            locks.emplace_back(stripes[i].mutex);
         }
     }
-    return nullptr;
+    return locks;
 }
 
-void BankingSystem::createAccount(int account_number, const string &owner, double initial_balance)
+void BankingSystem::addToTotals(Account &account, Money delta)
 {
-    if (num_accounts >= MAX_ACCOUNTS)
+    totals.addBalance(account.account_number, delta);
+    account.owner_balance->fetch_add(delta.minorUnits(), memory_order_relaxed);
+}
+
+void BankingSystem::appendHistory(Account &account, TransactionType type, Money amount, int32_t counterparty,
+                                  uint32_t timestamp)
+{
+    account.transactions.append(transaction_arena, type, amount, counterparty, timestamp);
+    totals.addRecord(account.account_number, type, amount);
+}
+
+Account *BankingSystem::findAccount(int account_number)
+{
+    OperationTimer timer(metrics, MetricOperation::FindAccount);
+    IndexStripe &stripe = stripeFor(account_number);
+    shared_lock<shared_mutex> stripe_lock(stripe.mutex);
+    Account *account = lookup(stripe, account_number);
+    timer.finish(account == nullptr ? Status::AccountNotFound : Status::Ok);
+    return account;
+}
+
+Status BankingSystem::createAccount(int account_number, const string &owner, Money initial_balance)
+{
+    OperationTimer timer(metrics, MetricOperation::CreateAccount);
+    if (initial_balance.isNegative())
     {
-        cout << "Error: Maximum number of accounts reached." << endl;
-        return;
+        log(statusMessage(Status::InvalidAmount));
+        return timer.finish(Status::InvalidAmount);
+    }
+    // A journaled owner would otherwise not survive replay intact
+    if (owner.size() > MAX_OWNER_LENGTH)
+    {
+        log(statusMessage(Status::OwnerTooLong));
+        return timer.finish(Status::OwnerTooLong);
+    }
+    if (account_number == NO_COUNTERPARTY)
+    {
+        log(statusMessage(Status::InvalidAccount));
+        return timer.finish(Status::InvalidAccount);
+    }
+
+    IndexStripe &stripe = stripeFor(account_number);
+    unique_lock<shared_mutex> stripe_lock(stripe.mutex);
+    if (stripe.index.find(account_number) != AccountIndex::NOT_FOUND)
+    {
+        stripe_lock.unlock();
+        log(statusMessage(Status::AccountExists));
+        return timer.finish(Status::AccountExists);
     }
 
-    Account new_account;
+    int32_t handle = accounts.allocate();
+    if (handle == SlabStore<Account>::FULL)
+    {
+        stripe_lock.unlock();
+        log(statusMessage(Status::TooManyAccounts));
+        return timer.finish(Status::TooManyAccounts);
+    }
+    Account &new_account = accounts[handle];
     new_account.account_number = account_number;
     new_account.owner = owner;
-    new_account.balance = initial_balance;
-    new_account.num_transactions = 0;
+    balance_column.ensure(handle);
+    new_account.balance.bind(balance_column.balance(handle),
+                             uint64_t(next_incarnation.fetch_add(1, memory_order_relaxed)) << 32);
+    new_account.balance.store(initial_balance);
 
-    accounts[num_accounts++] = new_account;
-    cout << "Account created successfully." << endl;
+    stripe.index.insert(account_number, handle);
+    {
+        lock_guard<shared_mutex> owner_lock(owner_mutex);
+        new_account.owner_balance = &owner_index.insert(owner, account_number);
+    }
+    addToTotals(new_account, initial_balance);
+    Journal *active_journal = journal.load(memory_order_acquire);
+    uint64_t position = 0;
+    if (active_journal != nullptr)
+    {
+        position = active_journal->appendCreateAccount(account_number, owner, initial_balance);
+    }
+    stripe_lock.unlock();
+    log("Account created successfully.");
+    return timer.finish(commit(active_journal, position));
 }
 
-void BankingSystem::deposit(int account_number, double amount)
+Status BankingSystem::deposit(int account_number, Money amount)
 {
-    Account *account = findAccount(account_number);
+    OperationTimer timer(metrics, MetricOperation::Deposit);
+    IndexStripe &stripe = stripeFor(account_number);
+    shared_lock<shared_mutex> stripe_lock(stripe.mutex);
+    Account *account = lookup(stripe, account_number);
     if (account == nullptr)
     {
-        cout << "Error: Account not found." << endl;
-        return;
+        log(statusMessage(Status::AccountNotFound));
+        return timer.finish(Status::AccountNotFound);
     }
-    if (amount <= 0)
+
+    unique_lock<mutex> account_lock(account->mutex, defer_lock);
+    if (!account->lock_free.load(memory_order_relaxed))
     {
-        cout << "Error: Invalid amount." << endl;
-        return;
+        account_lock.lock();
+    }
+    optional<Money> new_balance;
+    if (!amount.isPositive() || !(new_balance = account->balance.tryAdd(amount)))
+    {
+        log(statusMessage(Status::InvalidAmount));
+        return timer.finish(Status::InvalidAmount);
     }
-    account->balance += amount;
 
     // Update transaction history
-    Transaction *transaction = &account->transactions[account->num_transactions++];
-    transaction->account_number = account_number;
-    transaction->type = "Deposit";
-    transaction->amount = amount;
+    uint32_t timestamp = currentTimestamp();
+    addToTotals(*account, amount);
+    appendHistory(*account, TransactionType::Deposit, amount, NO_COUNTERPARTY, timestamp);
+    Journal *active_journal = journal.load(memory_order_acquire);
+    uint64_t position = 0;
+    if (active_journal != nullptr)
+    {
+        position = active_journal->appendDeposit(account_number, amount, timestamp);
+    }
 
-    cout << "Deposit successful. New balance: " << account->balance << endl;
+    log("Deposit successful. New balance: ", *new_balance);
+    if (account_lock.owns_lock())
+    {
+        account_lock.unlock();
+    }
+    stripe_lock.unlock();
+    return timer.finish(commit(active_journal, position));
 }
 
-void BankingSystem::withdraw(int account_number, double amount)
+Status BankingSystem::withdraw(int account_number, Money amount)
 {
-    Account *account = findAccount(account_number);
+    OperationTimer timer(metrics, MetricOperation::Withdraw);
+    IndexStripe &stripe = stripeFor(account_number);
+    shared_lock<shared_mutex> stripe_lock(stripe.mutex);
+    Account *account = lookup(stripe, account_number);
     if (account == nullptr)
     {
-        cout << "Error: Account not found." << endl;
-        return;
+        log(statusMessage(Status::AccountNotFound));
+        return timer.finish(Status::AccountNotFound);
     }
-    if (amount <= 0 || amount > account->balance)
+    if (!amount.isPositive())
     {
-        cout << "Error: Insufficient funds or invalid amount." << endl;
-        return;
+        log(statusMessage(Status::InvalidAmount));
+        return timer.finish(Status::InvalidAmount);
+    }
+
+    unique_lock<mutex> account_lock(account->mutex, defer_lock);
+    if (!account->lock_free.load(memory_order_relaxed))
+    {
+        account_lock.lock();
+    }
+    // The funds check happens inside the CAS, so concurrent lock-free withdrawals cannot overdraw
+    optional<Money> new_balance = account->balance.trySubtract(amount);
+    if (!new_balance)
+    {
+        log(statusMessage(Status::InsufficientFunds));
+        return timer.finish(Status::InsufficientFunds);
     }
-    account->balance -= amount;
 
     // Update transaction history
-    Transaction *transaction = &account->transactions[account->num_transactions++];
-    transaction->account_number = account_number;
-    transaction->type = "Withdrawal";
-    transaction->amount = amount;
+    uint32_t timestamp = currentTimestamp();
+    addToTotals(*account, Money::fromMinorUnits(-amount.minorUnits()));
+    appendHistory(*account, TransactionType::Withdrawal, amount, NO_COUNTERPARTY, timestamp);
+    Journal *active_journal = journal.load(memory_order_acquire);
+    uint64_t position = 0;
+    if (active_journal != nullptr)
+    {
+        position = active_journal->appendWithdrawal(account_number, amount, timestamp);
+    }
 
-    cout << "Withdrawal successful. New balance: " << account->balance << endl;
+    log("Withdrawal successful. New balance: ", *new_balance);
+    if (account_lock.owns_lock())
+    {
+        account_lock.unlock();
+    }
+    stripe_lock.unlock();
+    return timer.finish(commit(active_journal, position));
 }
 
-void BankingSystem::transfer(int from_account_number, int to_account_number, double amount)
+Status BankingSystem::transfer(int from_account_number, int to_account_number, Money amount)
 {
-    Account *from_account = findAccount(from_account_number);
-    Account *to_account = findAccount(to_account_number);
+    OperationTimer timer(metrics, MetricOperation::Transfer);
+    // Stripes are always locked in array order, so two transfers cannot deadlock
+    IndexStripe *first_stripe = &stripeFor(from_account_number);
+    IndexStripe *second_stripe = &stripeFor(to_account_number);
+    if (second_stripe < first_stripe)
+    {
+        swap(first_stripe, second_stripe);
+    }
+    shared_lock<shared_mutex> first_stripe_lock(first_stripe->mutex);
+    shared_lock<shared_mutex> second_stripe_lock;
+    if (second_stripe != first_stripe)
+    {
+        second_stripe_lock = shared_lock<shared_mutex>(second_stripe->mutex);
+    }
+
+    Account *from_account = lookup(stripeFor(from_account_number), from_account_number);
+    Account *to_account = lookup(stripeFor(to_account_number), to_account_number);
     if (from_account == nullptr || to_account == nullptr)
     {
-        cout << "Error: One or both accounts not found." << endl;
-        return;
+        log("Error: One or both accounts not found.");
+        return timer.finish(Status::AccountNotFound);
     }
-    if (amount <= 0 || amount > from_account->balance)
+
+    // Account locks are taken in account-number order for the same reason
+    unique_lock<mutex> first_lock;
+    unique_lock<mutex> second_lock;
+    if (from_account == to_account)
     {
-        cout << "Error: Insufficient funds or invalid amount." << endl;
-        return;
+        first_lock = unique_lock<mutex>(from_account->mutex);
+    }
+    else
+    {
+        bool from_first = from_account_number < to_account_number;
+        first_lock = unique_lock<mutex>(from_first ? from_account->mutex : to_account->mutex);
+        second_lock = unique_lock<mutex>(from_first ? to_account->mutex : from_account->mutex);
     }
-    from_account->balance -= amount;
-    to_account->balance += amount;
 
-    // Update transaction history for both accounts
-    Transaction *transaction1 = &from_account->transactions[from_account->num_transactions++];
-    transaction1->account_number = from_account_number;
-    transaction1->type = "Transfer (to)";
-    transaction1->amount = amount;
+    // Balances are still updated with CAS because lock-free deposits and withdrawals on
+    // either account do not take these locks
+    if (!amount.isPositive())
+    {
+        log(statusMessage(Status::InvalidAmount));
+        return timer.finish(Status::InvalidAmount);
+    }
+    optional<Money> new_from_balance = from_account->balance.trySubtract(amount);
+    if (!new_from_balance)
+    {
+        log(statusMessage(Status::InsufficientFunds));
+        return timer.finish(Status::InsufficientFunds);
+    }
+    optional<Money> new_to_balance = to_account->balance.tryAdd(amount);
+    if (!new_to_balance)
+    {
+        from_account->balance.tryAdd(amount);
+        log(statusMessage(Status::InvalidAmount));
+        return timer.finish(Status::InvalidAmount);
+    }
 
-    Transaction *transaction2 = &to_account->transactions[to_account->num_transactions++];
-    transaction2->account_number = to_account_number;
-    transaction2->type = "Transfer (from)";
-    transaction2->amount = amount;
+    // Update transaction history for both accounts
+    uint32_t timestamp = currentTimestamp();
+    addToTotals(*from_account, Money::fromMinorUnits(-amount.minorUnits()));
+    addToTotals(*to_account, amount);
+    appendHistory(*from_account, TransactionType::TransferOut, amount, to_account_number, timestamp);
+    appendHistory(*to_account, TransactionType::TransferIn, amount, from_account_number, timestamp);
+    Journal *active_journal = journal.load(memory_order_acquire);
+    uint64_t position = 0;
+    if (active_journal != nullptr)
+    {
+        position = active_journal->appendTransfer(from_account_number, to_account_number, amount, timestamp);
+    }
 
-    cout << "Transfer successful. New balance for " << from_account->owner << ": " << from_account->balance << endl;
-    cout << "New balance for " << to_account->owner << ": " << to_account->balance << endl;
+    log("Transfer successful. New balance for ", from_account->owner, ": ", from_account->balance.load());
+    log("New balance for ", to_account->owner, ": ", to_account->balance.load());
+    first_lock.unlock();
+    if (second_lock.owns_lock())
+    {
+        second_lock.unlock();
+    }
+    if (second_stripe_lock.owns_lock())
+    {
+        second_stripe_lock.unlock();
+    }
+    first_stripe_lock.unlock();
+    return timer.finish(commit(active_journal, position));
 }
 
-void BankingSystem::calculateInterest(double rate)
+BatchResult BankingSystem::applyBatch(span<const Operation> operations)
 {
-    for (int i = 0; i < num_accounts; ++i)
+    OperationTimer timer(metrics, MetricOperation::Batch);
+    // Group the operations by account: every distinct account number gets one slot, and
+    // each operation refers to its accounts by slot from here on
+    struct BatchAccount
+    {
+        int account_number;
+        Account *account;
+    };
+    vector<BatchAccount> batch_accounts;
+    AccountIndex slots;
+    vector<int32_t> from_slots(operations.size());
+    vector<int32_t> to_slots(operations.size(), AccountIndex::NOT_FOUND);
+    auto slotOf = [&batch_accounts, &slots](int account_number) {
+        int32_t slot = slots.find(account_number);
+        if (slot == AccountIndex::NOT_FOUND)
+        {
+            slot = static_cast<int32_t>(batch_accounts.size());
+            slots.insert(account_number, slot);
+            batch_accounts.push_back({account_number, nullptr});
+        }
+        return slot;
+    };
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        from_slots[i] = slotOf(operations[i].account_number);
+        if (operations[i].type == OperationType::Transfer)
+        {
+            to_slots[i] = slotOf(operations[i].to_account_number);
+        }
+    }
+
+    // Same lock order as transfer: stripes in array order, then accounts in account-number order
+    uint64_t stripe_mask = 0;
+    for (const BatchAccount &batch_account : batch_accounts)
     {
-        accounts[i].balance *= (1 + rate);
+        stripe_mask |= uint64_t(1) << (&stripeFor(batch_account.account_number) - stripes);
     }
-    cout << "Interest calculated and applied to all accounts." << endl;
+    vector<shared_lock<shared_mutex>> stripe_locks;
+    for (int i = 0; i < NUM_INDEX_STRIPES; ++i)
+    {
+        if (stripe_mask & (uint64_t(1) << i))
+        {
+            stripe_locks.emplace_back(stripes[i].mutex);
+        }
+    }
+
+    vector<BatchAccount> lock_order;
+    lock_order.reserve(batch_accounts.size());
+    for (BatchAccount &batch_account : batch_accounts)
+    {
+        batch_account.account = lookup(stripeFor(batch_account.account_number), batch_account.account_number);
+        if (batch_account.account != nullptr)
+        {
+            lock_order.push_back(batch_account);
+        }
+    }
+    sort(lock_order.begin(), lock_order.end(),
+         [](const BatchAccount &a, const BatchAccount &b) { return a.account_number < b.account_number; });
+    vector<unique_lock<mutex>> account_locks;
+    account_locks.reserve(lock_order.size());
+    for (const BatchAccount &batch_account : lock_order)
+    {
+        account_locks.emplace_back(batch_account.account->mutex);
+    }
+
+    // Balances are updated in batch order, with CAS because lock-free deposits and
+    // withdrawals do not take the account locks
+    BatchResult result;
+    result.statuses.resize(operations.size());
+    vector<uint32_t> postings_per_slot(batch_accounts.size() + 1, 0);
+    uint32_t timestamp = currentTimestamp();
+    Journal *active_journal = journal.load(memory_order_acquire);
+    uint64_t position = 0;
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        const Operation &operation = operations[i];
+        Account *account = batch_accounts[from_slots[i]].account;
+        Account *to_account =
+            operation.type == OperationType::Transfer ? batch_accounts[to_slots[i]].account : account;
+        Status status = Status::Ok;
+        if (account == nullptr || to_account == nullptr)
+        {
+            status = Status::AccountNotFound;
+        }
+        else if (!operation.amount.isPositive())
+        {
+            status = Status::InvalidAmount;
+        }
+        else if (operation.type == OperationType::Deposit)
+        {
+            if (!account->balance.tryAdd(operation.amount))
+            {
+                status = Status::InvalidAmount;
+            }
+        }
+        else if (operation.type == OperationType::Withdrawal)
+        {
+            if (!account->balance.trySubtract(operation.amount))
+            {
+                status = Status::InsufficientFunds;
+            }
+        }
+        else if (!account->balance.trySubtract(operation.amount))
+        {
+            status = Status::InsufficientFunds;
+        }
+        else if (!to_account->balance.tryAdd(operation.amount))
+        {
+            account->balance.tryAdd(operation.amount);
+            status = Status::InvalidAmount;
+        }
+
+        result.statuses[i] = status;
+        if (status == Status::Ok)
+        {
+            result.succeeded++;
+            if (operation.type != OperationType::Deposit)
+            {
+                addToTotals(*account, Money::fromMinorUnits(-operation.amount.minorUnits()));
+            }
+            if (operation.type != OperationType::Withdrawal)
+            {
+                addToTotals(*to_account, operation.amount);
+            }
+            postings_per_slot[from_slots[i] + 1]++;
+            if (operation.type == OperationType::Transfer)
+            {
+                postings_per_slot[to_slots[i] + 1]++;
+            }
+            if (active_journal != nullptr)
+            {
+                switch (operation.type)
+                {
+                case OperationType::Deposit:
+                    position = active_journal->appendDeposit(operation.account_number, operation.amount, timestamp);
+                    break;
+                case OperationType::Withdrawal:
+                    position = active_journal->appendWithdrawal(operation.account_number, operation.amount, timestamp);
+                    break;
+                case OperationType::Transfer:
+                    position = active_journal->appendTransfer(operation.account_number, operation.to_account_number,
+                                                              operation.amount, timestamp);
+                    break;
+                }
+            }
+        }
+        else
+        {
+            result.failed++;
+        }
+    }
+
+    // History records are then appended one account at a time, still in batch order within
+    // each account, so consecutive appends land in the same segment instead of hopping
+    // between every account in the batch
+    struct Posting
+    {
+        TransactionType type;
+        int32_t counterparty;
+        Money amount;
+    };
+    for (size_t slot = 1; slot < postings_per_slot.size(); ++slot)
+    {
+        postings_per_slot[slot] += postings_per_slot[slot - 1];
+    }
+    vector<Posting> postings(postings_per_slot.back());
+    vector<uint32_t> next_posting(postings_per_slot.begin(), postings_per_slot.end() - 1);
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        if (result.statuses[i] != Status::Ok)
+        {
+            continue;
+        }
+        const Operation &operation = operations[i];
+        switch (operation.type)
+        {
+        case OperationType::Deposit:
+            postings[next_posting[from_slots[i]]++] = {TransactionType::Deposit, NO_COUNTERPARTY, operation.amount};
+            break;
+        case OperationType::Withdrawal:
+            postings[next_posting[from_slots[i]]++] = {TransactionType::Withdrawal, NO_COUNTERPARTY,
+                                                       operation.amount};
+            break;
+        case OperationType::Transfer:
+            postings[next_posting[from_slots[i]]++] = {TransactionType::TransferOut, operation.to_account_number,
+                                                       operation.amount};
+            postings[next_posting[to_slots[i]]++] = {TransactionType::TransferIn, operation.account_number,
+                                                     operation.amount};
+            break;
+        }
+    }
+
+    for (size_t slot = 0; slot < batch_accounts.size(); ++slot)
+    {
+        for (uint32_t p = postings_per_slot[slot]; p < postings_per_slot[slot + 1]; ++p)
+        {
+            appendHistory(*batch_accounts[slot].account, postings[p].type, postings[p].amount,
+                          postings[p].counterparty, timestamp);
+        }
+    }
+
+    // One durability wait covers the whole batch
+    account_locks.clear();
+    stripe_locks.clear();
+    Status durability = commit(active_journal, position);
+    if (durability != Status::Ok)
+    {
+        for (Status &status : result.statuses)
+        {
+            if (status == Status::Ok)
+            {
+                status = Status::JournalFailed;
+            }
+        }
+        result.failed += result.succeeded;
+        result.succeeded = 0;
+    }
+    timer.finish(durability);
+    return result;
 }
 
-void BankingSystem::displayTransactions(int account_number)
+optional<Money> BankTransaction::balance(int account_number)
 {
-    Account *account = findAccount(account_number);
+    BankingSystem::IndexStripe &stripe = bank->stripeFor(account_number);
+    shared_lock<shared_mutex> stripe_lock(stripe.mutex);
+    Account *account = bank->lookup(stripe, account_number);
     if (account == nullptr)
     {
-        cout << "Error: Account not found." << endl;
-        return;
+        return nullopt;
     }
-    cout << "Transaction history for account " << account->account_number << " (" << account->owner << "):" << endl;
-    for (int i = 0; i < account->num_transactions; ++i)
+    // The version is read first, so the balance is at least as new as the version recorded
+    uint64_t version = account->balance.version();
+    Money balance = account->balance.load();
+    reads.push_back({account_number, version});
+    return balance;
+}
+
+Status BankTransaction::commit()
+{
+    Status status = bank->commitTransaction(*this);
+    reads.clear();
+    legs.clear();
+    return status;
+}
+
+Status BankingSystem::runTransaction(const function<Status(BankTransaction &)> &body, int max_attempts)
+{
+    Status status = Status::Conflict;
+    for (int attempt = 0; attempt < max_attempts && status == Status::Conflict; ++attempt)
     {
-        Transaction *transaction = &account->transactions[i];
-        cout << "Type: " << transaction->type << ", Amount: " << transaction->amount << endl;
+        BankTransaction transaction = begin();
+        status = body(transaction);
+        if (status == Status::Ok)
+        {
+            status = transaction.commit();
+        }
     }
+    return status;
 }
 
-void BankingSystem::deleteAccount(int account_number)
+Status BankingSystem::commitTransaction(BankTransaction &transaction)
 {
-    for (int i = 0; i < num_accounts; ++i)
+    OperationTimer timer(metrics, MetricOperation::Transaction);
+    if (transaction.legs.size() > MAX_TRANSACTION_LEGS)
+    {
+        log(statusMessage(Status::TooManyLegs));
+        return timer.finish(Status::TooManyLegs);
+    }
+    for (const BankTransaction::Leg &leg : transaction.legs)
+    {
+        if (!leg.amount.isPositive())
+        {
+            log(statusMessage(Status::InvalidAmount));
+            return timer.finish(Status::InvalidAmount);
+        }
+    }
+
+    // Every account read or posted to gets one slot; sorted, the slots are also the lock order
+    vector<int32_t> account_numbers;
+    account_numbers.reserve(transaction.legs.size() + transaction.reads.size());
+    for (const BankTransaction::Leg &leg : transaction.legs)
+    {
+        account_numbers.push_back(leg.account_number);
+    }
+    for (const BankTransaction::Read &read : transaction.reads)
+    {
+        account_numbers.push_back(read.account_number);
+    }
+    sort(account_numbers.begin(), account_numbers.end());
+    account_numbers.erase(unique(account_numbers.begin(), account_numbers.end()), account_numbers.end());
+    auto slotOf = [&account_numbers](int32_t account_number) {
+        return lower_bound(account_numbers.begin(), account_numbers.end(), account_number) - account_numbers.begin();
+    };
+
+    // Same lock order as transfer: stripes in array order, then accounts in account-number order
+    uint64_t stripe_mask = 0;
+    for (int32_t account_number : account_numbers)
+    {
+        stripe_mask |= uint64_t(1) << (&stripeFor(account_number) - stripes);
+    }
+    vector<shared_lock<shared_mutex>> stripe_locks;
+    for (int i = 0; i < NUM_INDEX_STRIPES; ++i)
+    {
+        if (stripe_mask & (uint64_t(1) << i))
+        {
+            stripe_locks.emplace_back(stripes[i].mutex);
+        }
+    }
+
+    vector<Account *> involved(account_numbers.size());
+    for (size_t slot = 0; slot < account_numbers.size(); ++slot)
+    {
+        involved[slot] = lookup(stripeFor(account_numbers[slot]), account_numbers[slot]);
+    }
+    for (const BankTransaction::Leg &leg : transaction.legs)
+    {
+        if (involved[slotOf(leg.account_number)] == nullptr)
+        {
+            log(statusMessage(Status::AccountNotFound));
+            return timer.finish(Status::AccountNotFound);
+        }
+    }
+    // An account read earlier has been deleted since
+    for (const BankTransaction::Read &read : transaction.reads)
+    {
+        if (involved[slotOf(read.account_number)] == nullptr)
+        {
+            log(statusMessage(Status::Conflict));
+            return timer.finish(Status::Conflict);
+        }
+    }
+
+    vector<unique_lock<mutex>> account_locks;
+    account_locks.reserve(involved.size());
+    for (Account *account : involved)
+    {
+        account_locks.emplace_back(account->mutex);
+    }
+    for (const BankTransaction::Read &read : transaction.reads)
+    {
+        if (involved[slotOf(read.account_number)]->balance.version() != read.version)
+        {
+            log(statusMessage(Status::Conflict));
+            return timer.finish(Status::Conflict);
+        }
+    }
+
+    // Legs on the same account are netted, so a credit can fund a debit from that account
+    vector<Money> debits(involved.size());
+    vector<Money> credits(involved.size());
+    for (const BankTransaction::Leg &leg : transaction.legs)
+    {
+        Money &total = leg.is_debit ? debits[slotOf(leg.account_number)] : credits[slotOf(leg.account_number)];
+        optional<Money> sum = total.checkedAdd(leg.amount);
+        if (!sum)
+        {
+            log(statusMessage(Status::InvalidAmount));
+            return timer.finish(Status::InvalidAmount);
+        }
+        total = *sum;
+    }
+
+    // Debits go first so a failed one leaves no credit to take back. Balances are still
+    // updated with CAS because lock-free deposits and withdrawals do not take these locks;
+    // undoing a change adds its exact opposite, which needs no funds check.
+    vector<pair<size_t, Money>> applied;
+    auto rollBack = [&applied, &involved]() {
+        for (auto it = applied.rbegin(); it != applied.rend(); ++it)
+        {
+            involved[it->first]->balance.tryAdd(Money::fromMinorUnits(-it->second.minorUnits()));
+        }
+    };
+    for (size_t slot = 0; slot < involved.size(); ++slot)
     {
-        if (accounts[i].account_number == account_number)
+        if (debits[slot] > credits[slot])
         {
-            // Shift remaining accounts to fill the gap
-            for (int j = i; j < num_accounts - 1; ++j)
+            Money amount = *debits[slot].checkedSubtract(credits[slot]);
+            if (!involved[slot]->balance.trySubtract(amount))
             {
-                accounts[j] = accounts[j + 1];
+                rollBack();
+                log(statusMessage(Status::InsufficientFunds));
+                return timer.finish(Status::InsufficientFunds);
             }
-            num_accounts--;
-            cout << "Account " << account_number << " deleted successfully." << endl;
-            return;
+            applied.emplace_back(slot, Money::fromMinorUnits(-amount.minorUnits()));
         }
     }
-    cout << "Error: Account not found." << endl;
+    for (size_t slot = 0; slot < involved.size(); ++slot)
+    {
+        if (credits[slot] > debits[slot])
+        {
+            Money amount = *credits[slot].checkedSubtract(debits[slot]);
+            if (!involved[slot]->balance.tryAdd(amount))
+            {
+                rollBack();
+                log(statusMessage(Status::InvalidAmount));
+                return timer.finish(Status::InvalidAmount);
+            }
+            applied.emplace_back(slot, amount);
+        }
+    }
+
+    for (const pair<size_t, Money> &change : applied)
+    {
+        addToTotals(*involved[change.first], change.second);
+    }
+
+    // Every leg is posted to its account's history and the whole transaction is one
+    // journal record, so replay cannot apply part of it
+    uint32_t timestamp = currentTimestamp();
+    vector<JournalLeg> journal_legs;
+    journal_legs.reserve(transaction.legs.size());
+    for (const BankTransaction::Leg &leg : transaction.legs)
+    {
+        appendHistory(*involved[slotOf(leg.account_number)],
+                      leg.is_debit ? TransactionType::Debit : TransactionType::Credit, leg.amount, NO_COUNTERPARTY,
+                      timestamp);
+        journal_legs.push_back(
+            {leg.account_number, leg.is_debit ? Money::fromMinorUnits(-leg.amount.minorUnits()) : leg.amount});
+    }
+    Journal *active_journal = journal.load(memory_order_acquire);
+    uint64_t position = 0;
+    if (active_journal != nullptr && !journal_legs.empty())
+    {
+        position = active_journal->appendLegs(journal_legs, timestamp);
+    }
+
+    account_locks.clear();
+    stripe_locks.clear();
+    log("Transaction committed.");
+    return timer.finish(commit(active_journal, position));
 }
 
-void BankingSystem::displayAccountDetails(int account_number)
+Status BankingSystem::calculateInterest(double rate)
+{
+    if (!validInterestRate(rate))
+    {
+        return rejectInterestRate();
+    }
+    RateTable rates;
+    fill_n(rates.rates, NUM_RATE_TIERS, llround(rate * RATE_SCALE));
+    return applyInterest(rates);
+}
+
+Status BankingSystem::calculateInterest(span<const double> tier_rates)
+{
+    RateTable rates = {};
+    for (size_t tier = 0; tier < min(tier_rates.size(), NUM_RATE_TIERS); ++tier)
+    {
+        if (!validInterestRate(tier_rates[tier]))
+        {
+            return rejectInterestRate();
+        }
+        rates.rates[tier] = llround(tier_rates[tier] * RATE_SCALE);
+    }
+    return applyInterest(rates);
+}
+
+Status BankingSystem::rejectInterestRate()
 {
-    Account *account = findAccount(account_number);
+    OperationTimer timer(metrics, MetricOperation::Interest);
+    log(statusMessage(Status::InvalidAmount));
+    return timer.finish(Status::InvalidAmount);
+}
+
+Status BankingSystem::applyInterest(const RateTable &rates)
+{
+    OperationTimer timer(metrics, MetricOperation::Interest);
+    Journal *active_journal = journal.load(memory_order_acquire);
+    uint32_t timestamp = currentTimestamp();
+    // Every operation holds its stripe while it touches a balance, so with all stripes held
+    // exclusively the kernel can work on the raw cells
+    vector<unique_lock<shared_mutex>> stripe_locks = lockAllStripesExclusive();
+    size_t num_chunks = balance_column.numChunks();
+    // Below the threshold waking the pool costs more than the sweep saves
+    size_t num_workers = num_chunks < PARALLEL_INTEREST_CHUNKS
+                             ? min<size_t>(num_chunks, 1)
+                             : min<size_t>(max(thread::hardware_concurrency(), 1u), num_chunks);
+    vector<uint64_t> positions(num_workers, 0);
+
+    // Interest is journaled as the amount credited to each account, so replay does not
+    // depend on the order it interleaved with other postings
+    auto sweep = [&](size_t worker) {
+        vector<int64_t> credited(BalanceColumn::CHUNK_SIZE);
+        for (size_t chunk = worker; chunk < num_chunks; chunk += num_workers)
+        {
+            accrueInterest(balance_column.balanceChunk(chunk), balance_column.rateTierChunk(chunk),
+                           BalanceColumn::CHUNK_SIZE, rates, credited.data());
+            for (size_t i = 0; i < BalanceColumn::CHUNK_SIZE; ++i)
+            {
+                if (credited[i] == 0)
+                {
+                    continue;
+                }
+                // Only live accounts have a balance to change
+                Account &account = accounts[static_cast<int32_t>(chunk * BalanceColumn::CHUNK_SIZE + i)];
+                account.balance.markChanged();
+                Money amount = Money::fromMinorUnits(credited[i]);
+                addToTotals(account, amount);
+                appendHistory(account, TransactionType::Interest, amount, NO_COUNTERPARTY, timestamp);
+                if (active_journal != nullptr)
+                {
+                    positions[worker] = active_journal->appendInterest(account.account_number, amount, timestamp);
+                }
+            }
+        }
+    };
+    if (num_workers == 1)
+    {
+        sweep(0);
+    }
+    else if (num_workers > 1)
+    {
+        interest_workers.run(num_workers, sweep);
+    }
+    stripe_locks.clear();
+    log("Interest calculated and applied to all accounts.");
+    uint64_t last_position = positions.empty() ? 0 : *max_element(positions.begin(), positions.end());
+    return timer.finish(commit(active_journal, last_position));
+}
+
+Status BankingSystem::setRateTier(int account_number, uint8_t tier)
+{
+    IndexStripe &stripe = stripeFor(account_number);
+    shared_lock<shared_mutex> stripe_lock(stripe.mutex);
+    int32_t handle = stripe.index.find(account_number);
+    if (handle == AccountIndex::NOT_FOUND)
+    {
+        log(statusMessage(Status::AccountNotFound));
+        return Status::AccountNotFound;
+    }
+    lock_guard<mutex> account_lock(accounts[handle].mutex);
+    balance_column.rateTier(handle) = tier;
+    return Status::Ok;
+}
+
+void BankingSystem::printHistory(const BankView &view, const SnapshotEntry &entry)
+{
+    cout << "Transaction history for account " << entry.account_number << " (" << entry.owner << "):" << endl;
+    view.forEachTransaction(entry, [](const Transaction &transaction) {
+        cout << "Type: " << transactionTypeName(transaction.type) << ", Amount: " << transaction.amount
+             << endl;
+    });
+}
+
+void BankingSystem::displayTransactions(int account_number)
+{
+    unique_ptr<BankView> view = openView(account_number);
+    if (view->accounts().empty())
+    {
+        cout << "Error: Account not found." << endl;
+        return;
+    }
+    printHistory(*view, view->accounts().front());
+}
+
+HistoryPage BankingSystem::queryHistory(int account_number, const HistoryQuery &query,
+                                       const function<void(span<const Transaction>)> &consume)
+{
+    HistoryPage page;
+    IndexStripe &stripe = stripeFor(account_number);
+    // The stripe lock keeps the account, and so its history segments, from being deleted
+    shared_lock<shared_mutex> stripe_lock(stripe.mutex);
+    Account *account = lookup(stripe, account_number);
     if (account == nullptr)
+    {
+        page.status = Status::AccountNotFound;
+        return page;
+    }
+
+    auto matches = [&query](const Transaction &transaction) {
+        return transaction.timestamp >= query.from_timestamp && transaction.timestamp <= query.to_timestamp &&
+               (query.types & transactionTypeBit(transaction.type)) != 0 &&
+               (!query.min_amount || transaction.amount >= *query.min_amount) &&
+               (!query.max_amount || transaction.amount <= *query.max_amount);
+    };
+    // Records appended after this point belong to later pages
+    uint64_t size = account->transactions.size();
+    uint64_t cursor = min(query.cursor.value_or(query.newest_first ? size : 0), size);
+
+    if (!query.newest_first)
+    {
+        account->transactions.forEachRunBetween(cursor, size, false, [&](span<const Transaction> run) {
+            size_t i = 0;
+            while (i < run.size() && page.count < query.limit)
+            {
+                size_t j = i;
+                while (j < run.size() && j - i < query.limit - page.count && matches(run[j]))
+                {
+                    j++;
+                }
+                if (j > i)
+                {
+                    consume(run.subspan(i, j - i));
+                    page.count += j - i;
+                    i = j;
+                }
+                else
+                {
+                    i++;
+                }
+            }
+            cursor += i;
+            return page.count < query.limit;
+        });
+        page.at_end = cursor == size;
+    }
+    else
+    {
+        account->transactions.forEachRunBetween(0, cursor, true, [&](span<const Transaction> run) {
+            // Scans back from the newest record; i is the end of the part not yet scanned
+            size_t i = run.size();
+            while (i > 0 && page.count < query.limit)
+            {
+                size_t j = i;
+                while (j > 0 && i - j < query.limit - page.count && matches(run[j - 1]))
+                {
+                    j--;
+                }
+                if (j < i)
+                {
+                    consume(run.subspan(j, i - j));
+                    page.count += i - j;
+                    i = j;
+                }
+                else
+                {
+                    i--;
+                }
+            }
+            cursor -= run.size() - i;
+            return page.count < query.limit;
+        });
+        page.at_end = cursor == 0;
+    }
+    page.cursor = cursor;
+    return page;
+}
+
+Status BankingSystem::deleteAccount(int account_number)
+{
+    OperationTimer timer(metrics, MetricOperation::DeleteAccount);
+    IndexStripe &stripe = stripeFor(account_number);
+    unique_lock<shared_mutex> stripe_lock(stripe.mutex);
+    int32_t handle = stripe.index.find(account_number);
+    if (handle == AccountIndex::NOT_FOUND)
+    {
+        stripe_lock.unlock();
+        log(statusMessage(Status::AccountNotFound));
+        return timer.finish(Status::AccountNotFound);
+    }
+    // Every other operation on this account held the stripe lock, so none is still running
+    stripe.index.erase(account_number);
+    // Its balance and history leave the totals with it, which takes a pass over the history
+    Account &account = accounts[handle];
+    addToTotals(account, Money::fromMinorUnits(-account.balance.load().minorUnits()));
+    TypeTotals discarded[NUM_TRANSACTION_TYPES];
+    account.transactions.forEach([&discarded](const Transaction &transaction) {
+        TypeTotals &type_totals = discarded[static_cast<size_t>(transaction.type)];
+        type_totals.count++;
+        type_totals.volume = Money::fromMinorUnits(type_totals.volume.minorUnits() + transaction.amount.minorUnits());
+    });
+    for (size_t t = 0; t < NUM_TRANSACTION_TYPES; ++t)
+    {
+        totals.addRecords(account_number, static_cast<TransactionType>(t), discarded[t], -1);
+    }
+    {
+        lock_guard<shared_mutex> owner_lock(owner_mutex);
+        owner_index.erase(account.owner, account_number);
+    }
+    account.owner_balance = nullptr;
+    // Interest sweeps every slot in the column, so a retired one must earn nothing
+    account.balance.store(Money());
+    balance_column.rateTier(handle) = 0;
+    // Open views may still read its owner and history, so the slot is only released once
+    // they have all been destroyed; with none open that is right away
+    account.retired = true;
+    reclaimer.retire([this, handle] {
+        accounts[handle].transactions.clear(transaction_arena);
+        accounts.release(handle);
+    });
+    reclaimer.reclaim();
+    Journal *active_journal = journal.load(memory_order_acquire);
+    uint64_t position = 0;
+    if (active_journal != nullptr)
+    {
+        position = active_journal->appendDeleteAccount(account_number);
+    }
+    stripe_lock.unlock();
+    log("Account ", account_number, " deleted successfully.");
+    return timer.finish(commit(active_journal, position));
+}
+
+// Reports print from a view, so they hold no lock while they write to the console
+
+void BankingSystem::displayAccountDetails(int account_number)
+{
+    unique_ptr<BankView> view = openView(account_number);
+    if (view->accounts().empty())
     {
         cout << "Error: Account not found." << endl;
         return;
     }
-    cout << "Account Number: " << account->account_number << endl;
-    cout << "Owner: " << account->owner << endl;
-    cout << "Balance: " << account->balance << endl;
+    const SnapshotEntry &entry = view->accounts().front();
+    cout << "Account Number: " << entry.account_number << endl;
+    cout << "Owner: " << entry.owner << endl;
+    cout << "Balance: " << entry.balance << endl;
     cout << "Transaction History:" << endl;
-    displayTransactions(account_number);
+    printHistory(*view, entry);
 }
 
 void BankingSystem::displayAllAccounts()
 {
+    unique_ptr<BankView> view = openView();
     cout << "List of all accounts:" << endl;
-    for (int i = 0; i < num_accounts; ++i)
+    for (const SnapshotEntry &entry : view->accounts())
     {
-        cout << "Account Number: " << accounts[i].account_number << ", Owner: " << accounts[i].owner
-             << ", Balance: " << accounts[i].balance << endl;
+        cout << "Account Number: " << entry.account_number << ", Owner: " << entry.owner
+             << ", Balance: " << entry.balance << endl;
     }
 }
 
 void BankingSystem::searchAccountsByOwner(const string &owner_name)
 {
+    unique_ptr<BankView> view = openView(owner_name);
     cout << "Accounts owned by " << owner_name << ":" << endl;
-    for (int i = 0; i < num_accounts; ++i)
+    for (const SnapshotEntry &entry : view->accounts())
+    {
+        cout << "Account Number: " << entry.account_number << ", Balance: " << entry.balance << endl;
+    }
+}
+
+BankView::~BankView()
+{
+    if (bank->reclaimer.unpin(epoch))
+    {
+        // Any stripe keeps out accounts.forEach while slots are released
+        unique_lock<shared_mutex> stripe_lock(bank->stripes[0].mutex);
+        bank->reclaimer.reclaim();
+    }
+}
+
+void BankView::indexEntries()
+{
+    index.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        index.insert(entries[i].account_number, static_cast<int32_t>(i));
+    }
+}
+
+const SnapshotEntry *BankView::find(int account_number) const
+{
+    int32_t position = index.find(account_number);
+    return position == AccountIndex::NOT_FOUND ? nullptr : &entries[position];
+}
+
+void BankingSystem::addToView(BankView &view, Account &account)
+{
+    view.entries.push_back(SnapshotEntry{account.account_number, account.owner, account.balance.load(),
+                                         &account.transactions, account.transactions.size()});
+}
+
+void BankingSystem::setViewJournalPosition(BankView &view)
+{
+    Journal *active_journal = journal.load(memory_order_acquire);
+    if (active_journal != nullptr)
+    {
+        view.journal_position = active_journal->endPosition();
+    }
+}
+
+unique_ptr<BankView> BankingSystem::openView()
+{
+    unique_ptr<BankView> view(new BankView(*this, reclaimer.pin()));
+    // Every operation holds its stripe while it mutates and journals, so with all of them
+    // held exclusively the balances, history lengths and journal agree
     {
-        if (accounts[i].owner == owner_name)
+        vector<unique_lock<shared_mutex>> stripe_locks = lockAllStripesExclusive();
+        view->entries.reserve(accounts.size());
+        accounts.forEach([this, &view](int32_t, Account &account) {
+            if (!account.retired)
+            {
+                addToView(*view, account);
+            }
+        });
+        setViewJournalPosition(*view);
+    }
+    view->indexEntries();
+    return view;
+}
+
+unique_ptr<BankView> BankingSystem::openView(string_view owner_query, OwnerMatch match)
+{
+    unique_ptr<BankView> view(new BankView(*this, reclaimer.pin()));
+    vector<int32_t> account_numbers;
+    uint64_t stripe_mask = 0;
+    while (true)
+    {
+        // Creating or deleting an account takes its stripe exclusively, so with the stripe
+        // of every match held the matches cannot change. One created in another stripe
+        // before those were locked means trying again with that stripe as well.
+        vector<unique_lock<shared_mutex>> stripe_locks = lockStripesExclusive(stripe_mask);
+        shared_lock<shared_mutex> owner_lock(owner_mutex);
+        account_numbers.clear();
+        owner_index.search(owner_query, match, account_numbers);
+        uint64_t needed_mask = 0;
+        for (int32_t account_number : account_numbers)
         {
-            cout << "Account Number: " << accounts[i].account_number << ", Balance: " << accounts[i].balance << endl;
+            needed_mask |= uint64_t(1) << (&stripeFor(account_number) - stripes);
         }
+        if ((needed_mask & ~stripe_mask) != 0)
+        {
+            stripe_mask |= needed_mask;
+            continue;
+        }
+        sort(account_numbers.begin(), account_numbers.end());
+        for (int32_t account_number : account_numbers)
+        {
+            addToView(*view, *lookup(stripeFor(account_number), account_number));
+        }
+        setViewJournalPosition(*view);
+        break;
     }
+    view->indexEntries();
+    return view;
 }
-/**/
-int main()
+
+unique_ptr<BankView> BankingSystem::openView(int account_number)
 {
-    BankingSystem bank;
+    unique_ptr<BankView> view(new BankView(*this, reclaimer.pin()));
+    IndexStripe &stripe = stripeFor(account_number);
+    unique_lock<shared_mutex> stripe_lock(stripe.mutex);
+    Account *account = lookup(stripe, account_number);
+    if (account != nullptr)
+    {
+        addToView(*view, *account);
+        setViewJournalPosition(*view);
+    }
+    stripe_lock.unlock();
+    view->indexEntries();
+    return view;
+}
 
-    // Creating accounts
-    bank.createAccount(1001, "Alice", 5000);
-    bank.createAccount(1002, "Bob", 3000);
+vector<int32_t> BankingSystem::findAccountsByOwner(string_view query, OwnerMatch match)
+{
+    vector<int32_t> account_numbers;
+    {
+        shared_lock<shared_mutex> owner_lock(owner_mutex);
+        owner_index.search(query, match, account_numbers);
+    }
+    sort(account_numbers.begin(), account_numbers.end());
+    return account_numbers;
+}
 
-    // Performing transactions
-    bank.deposit(1001, 1000);
-    bank.withdraw(1002, 500);
-    bank.transfer(1001, 1002, 200);
+Money BankingSystem::ownerBalance(string_view owner)
+{
+    shared_lock<shared_mutex> owner_lock(owner_mutex);
+    return owner_index.balance(owner);
+}
 
-    // Displaying account details
-    bank.displayAccountDetails(1001);
-    bank.displayAccountDetails(1002);
+size_t BankingSystem::compactHistory(size_t hot_records)
+{
+    size_t num_moved = 0;
+    for (IndexStripe &stripe : stripes)
+    {
+        // Appends and history queries on these accounts hold the stripe, so only views can
+        // be reading them; what compaction unlinks is freed once those are gone
+        unique_lock<shared_mutex> stripe_lock(stripe.mutex);
+        vector<CompactedHistory> unlinked;
+        stripe.index.forEach([this, hot_records, &unlinked](int32_t, int32_t handle) {
+            TransactionLog &transactions = accounts[handle].transactions;
+            size_t size = transactions.size();
+            if (size > hot_records)
+            {
+                CompactedHistory compacted = transactions.compact(size - hot_records);
+                if (compacted.num_records != 0)
+                {
+                    unlinked.push_back(compacted);
+                }
+            }
+        });
+        if (unlinked.empty())
+        {
+            continue;
+        }
+        for (const CompactedHistory &compacted : unlinked)
+        {
+            num_moved += compacted.num_records;
+        }
+        reclaimer.retire([this, unlinked = std::move(unlinked)] {
+            for (const CompactedHistory &compacted : unlinked)
+            {
+                TransactionLog::release(transaction_arena, compacted);
+            }
+        });
+        reclaimer.reclaim();
+    }
+    return num_moved;
+}
+
+Status BankingSystem::commit(Journal *active_journal, uint64_t position)
+{
+    if (deferred_commit != nullptr && active_journal != nullptr && position != 0 &&
+        active_journal->commitMode() == CommitMode::Synchronous)
+    {
+        deferred_commit->deferred_journal = active_journal;
+        deferred_commit->deferred_position = max(deferred_commit->deferred_position, position);
+        return Status::Ok;
+    }
+    if (active_journal == nullptr || position == 0 || active_journal->commitMode() == CommitMode::Background ||
+        active_journal->waitDurable(position))
+    {
+        return Status::Ok;
+    }
+    log(statusMessage(Status::JournalFailed));
+    return Status::JournalFailed;
+}
+
+optional<size_t> BankingSystem::recover(const string &journal_path)
+{
+    return Journal::replay(journal_path, [this](const JournalRecord &record) { applyJournalRecord(record); });
+}
 
-    // Displaying all accounts
-    bank.displayAllAccounts();
+optional<size_t> BankingSystem::recover(const string &snapshot_path, const string &journal_path)
+{
+    unique_ptr<SnapshotView> snapshot = SnapshotView::open(snapshot_path);
+    if (snapshot == nullptr || !snapshot->verify())
+    {
+        return recover(journal_path);
+    }
+    loadSnapshot(*snapshot);
+    return Journal::replay(
+        journal_path, [this](const JournalRecord &record) { applyJournalRecord(record); }, snapshot->journalPosition());
+}
 
-    // Searching accounts by owner name
-    bank.searchAccountsByOwner("Alice");
+bool BankingSystem::writeSnapshot(const string &path)
+{
+    return withConsistentCut([&path](span<const SnapshotEntry> entries, uint64_t journal_position) {
+        return writeSnapshotFile(path, entries, journal_position);
+    });
+}
 
-    // Deleting an account
-    bank.deleteAccount(1002);
+bool BankingSystem::withConsistentCut(const function<bool(span<const SnapshotEntry>, uint64_t)> &write)
+{
+    // The view keeps the owners and histories of accounts deleted meanwhile until write returns
+    unique_ptr<BankView> view = openView();
+    return write(view->accounts(), view->journalPosition());
+}
 
-    return 0;
-}
\ No newline at end of file
+Account *BankingSystem::insertLoaded(int32_t account_number, string_view owner, Money balance)
+{
+    IndexStripe &stripe = stripeFor(account_number);
+    if (account_number == NO_COUNTERPARTY || stripe.index.find(account_number) != AccountIndex::NOT_FOUND)
+    {
+        return nullptr;
+    }
+    int32_t handle = accounts.allocate();
+    if (handle == SlabStore<Account>::FULL)
+    {
+        return nullptr;
+    }
+    Account &account = accounts[handle];
+    account.account_number = account_number;
+    account.owner = owner;
+    balance_column.ensure(handle);
+    account.balance.bind(balance_column.balance(handle),
+                         uint64_t(next_incarnation.fetch_add(1, memory_order_relaxed)) << 32);
+    account.balance.store(balance);
+    stripe.index.insert(account_number, handle);
+    account.owner_balance = &owner_index.insert(account.owner, account_number);
+    addToTotals(account, balance);
+    return &account;
+}
+
+size_t BankingSystem::loadSnapshot(const SnapshotView &snapshot)
+{
+    vector<unique_lock<shared_mutex>> stripe_locks = lockAllStripesExclusive();
+    lock_guard<shared_mutex> owner_lock(owner_mutex);
+    for (IndexStripe &stripe : stripes)
+    {
+        stripe.index.reserve(snapshot.size() / NUM_INDEX_STRIPES + 1);
+    }
+    size_t num_loaded = 0;
+    for (const SnapshotAccount &saved : snapshot.accounts())
+    {
+        Account *account = insertLoaded(saved.account_number, snapshot.owner(saved), snapshot.balance(saved));
+        if (account == nullptr)
+        {
+            continue;
+        }
+        for (const Transaction &transaction : snapshot.transactions(saved))
+        {
+            appendHistory(*account, transaction.type, transaction.amount, transaction.counterparty,
+                          transaction.timestamp);
+        }
+        num_loaded++;
+    }
+    return num_loaded;
+}
+
+size_t BankingSystem::loadAccounts(span<const AccountRecord> records)
+{
+    vector<unique_lock<shared_mutex>> stripe_locks = lockAllStripesExclusive();
+    lock_guard<shared_mutex> owner_lock(owner_mutex);
+    for (IndexStripe &stripe : stripes)
+    {
+        stripe.index.reserve(stripe.index.size() + records.size() / NUM_INDEX_STRIPES + 1);
+    }
+    size_t num_loaded = 0;
+    for (const AccountRecord &record : records)
+    {
+        if (!record.balance.isNegative() && insertLoaded(record.account_number, record.owner, record.balance) != nullptr)
+        {
+            num_loaded++;
+        }
+    }
+    return num_loaded;
+}
+
+size_t BankingSystem::loadHistory(span<const HistoryRecord> records)
+{
+    // Shared stripe locks keep accounts from being deleted; appends need no other lock
+    vector<shared_lock<shared_mutex>> stripe_locks = lockAllStripes();
+    size_t num_loaded = 0;
+    Account *account = nullptr;
+    for (const HistoryRecord &record : records)
+    {
+        // Histories usually come grouped by account
+        if (account == nullptr || account->account_number != record.account_number)
+        {
+            account = lookup(stripeFor(record.account_number), record.account_number);
+            if (account == nullptr)
+            {
+                continue;
+            }
+        }
+        appendHistory(*account, record.type, record.amount, record.counterparty, record.timestamp);
+        num_loaded++;
+    }
+    return num_loaded;
+}
+
+void BankingSystem::applyJournalRecord(const JournalRecord &record)
+{
+    // Records describe changes that were already accepted, so they are applied without
+    // re-checking funds
+    // Looks up directly rather than through findAccount, so replay does not show up in its metrics
+    auto post = [this](int account_number, Money delta) -> Account * {
+        IndexStripe &stripe = stripeFor(account_number);
+        shared_lock<shared_mutex> stripe_lock(stripe.mutex);
+        Account *account = lookup(stripe, account_number);
+        optional<Money> new_balance;
+        if (account != nullptr && (new_balance = account->balance.load().checkedAdd(delta)))
+        {
+            account->balance.store(*new_balance);
+            addToTotals(*account, delta);
+        }
+        return account;
+    };
+    Money negated = Money::fromMinorUnits(-record.amount.minorUnits());
+    Account *account;
+    switch (record.type)
+    {
+    case JournalRecordType::CreateAccount:
+        createAccount(record.account_number, record.owner, record.amount);
+        break;
+    case JournalRecordType::DeleteAccount:
+        deleteAccount(record.account_number);
+        break;
+    case JournalRecordType::Deposit:
+        if ((account = post(record.account_number, record.amount)) != nullptr)
+        {
+            appendHistory(*account, TransactionType::Deposit, record.amount, NO_COUNTERPARTY, record.timestamp);
+        }
+        break;
+    case JournalRecordType::Withdrawal:
+        if ((account = post(record.account_number, negated)) != nullptr)
+        {
+            appendHistory(*account, TransactionType::Withdrawal, record.amount, NO_COUNTERPARTY, record.timestamp);
+        }
+        break;
+    case JournalRecordType::Transfer:
+        if ((account = post(record.account_number, negated)) != nullptr)
+        {
+            appendHistory(*account, TransactionType::TransferOut, record.amount, record.to_account_number,
+                          record.timestamp);
+        }
+        if ((account = post(record.to_account_number, record.amount)) != nullptr)
+        {
+            appendHistory(*account, TransactionType::TransferIn, record.amount, record.account_number,
+                          record.timestamp);
+        }
+        break;
+    case JournalRecordType::Interest:
+        if ((account = post(record.account_number, record.amount)) != nullptr)
+        {
+            appendHistory(*account, TransactionType::Interest, record.amount, NO_COUNTERPARTY, record.timestamp);
+        }
+        break;
+    case JournalRecordType::MultiLeg:
+        for (const JournalLeg &leg : record.legs)
+        {
+            if ((account = post(leg.account_number, leg.amount)) != nullptr)
+            {
+                bool is_debit = leg.amount.isNegative();
+                appendHistory(*account, is_debit ? TransactionType::Debit : TransactionType::Credit,
+                              is_debit ? Money::fromMinorUnits(-leg.amount.minorUnits()) : leg.amount,
+                              NO_COUNTERPARTY, record.timestamp);
+            }
+        }
+        break;
+    }
+}
+
+Status BankingSystem::setLockFreeFastPath(int account_number, bool enabled)
+{
+    IndexStripe &stripe = stripeFor(account_number);
+    shared_lock<shared_mutex> stripe_lock(stripe.mutex);
+    Account *account = lookup(stripe, account_number);
+    if (account == nullptr)
+    {
+        log(statusMessage(Status::AccountNotFound));
+        return Status::AccountNotFound;
+    }
+    account->lock_free.store(enabled, memory_order_relaxed);
+    return Status::Ok;
+}
@@ -1,51 +1,435 @@
 #ifndef BANKING_SYSTEM_H
 #define BANKING_SYSTEM_H
 
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
 #include <string>
+#include <vector>
 
-constexpr int MAX_ACCOUNTS = 100;
-constexpr int MAX_NAME_LENGTH = 50;
-constexpr int MAX_TRANSACTIONS = 100;
+#include "account_index.h"
+#include "atomic_money.h"
+#include "balance_column.h"
+#include "bank_totals.h"
+#include "epoch_reclaimer.h"
+#include "interest_kernel.h"
+#include "journal.h"
+#include "log_sink.h"
+#include "metrics.h"
+#include "money.h"
+#include "owner_index.h"
+#include "slab_store.h"
+#include "snapshot.h"
+#include "status.h"
+#include "transaction_log.h"
+#include "worker_pool.h"
 
-// Structure to represent a transaction
-struct Transaction
-{
-    int account_number;
-    std::string type; // "Deposit", "Withdrawal", "Transfer"
-    double amount;
-};
+constexpr int MAX_NAME_LENGTH = 50;
 
 // Structure to represent an account
 struct Account
 {
     int account_number;
     std::string owner;
-    double balance;
-    Transaction transactions[MAX_TRANSACTIONS];
-    int num_transactions;
+    AtomicMoney balance;                // cell in the bank's BalanceColumn; versioned for optimistic reads
+    TransactionLog transactions;
+    std::mutex mutex;                   // held by every locked-path operation on this account
+    std::atomic<bool> lock_free{false}; // deposits and withdrawals skip the mutex
+    std::atomic<int64_t> *owner_balance = nullptr; // the owner's balance total in the owner index
+    bool retired = false; // deleted, but kept until no BankView can still read it
+};
+
+enum class OperationType : uint8_t
+{
+    Deposit,
+    Withdrawal,
+    Transfer,
+};
+
+// One posting in a batch; to_account_number is only used by transfers
+struct Operation
+{
+    OperationType type;
+    int32_t account_number;
+    int32_t to_account_number;
+    Money amount;
+};
+
+struct BatchResult
+{
+    std::vector<Status> statuses; // one per operation, in batch order
+    std::size_t succeeded = 0;
+    std::size_t failed = 0;
 };
 
+// One account for loadAccounts; owner is copied
+struct AccountRecord
+{
+    int32_t account_number;
+    std::string_view owner;
+    Money balance;
+};
+
+// One past posting for loadHistory
+struct HistoryRecord
+{
+    int32_t account_number;
+    TransactionType type;
+    Money amount;
+    int32_t counterparty;
+    uint32_t timestamp;
+};
+
+// Which records of an account's history queryHistory returns. A cursor is a position
+// between two records: 0 is before the oldest and size() after the newest.
+struct HistoryQuery
+{
+    bool newest_first = false;
+    // Where to resume, from HistoryPage::cursor; by default the oldest end of the history,
+    // or the newest end when newest_first is set
+    std::optional<uint64_t> cursor;
+    uint32_t from_timestamp = 0;            // inclusive
+    uint32_t to_timestamp = UINT32_MAX;     // inclusive
+    uint32_t types = ALL_TRANSACTION_TYPES; // transactionTypeBit of each type to include
+    std::optional<Money> min_amount;        // inclusive
+    std::optional<Money> max_amount;        // inclusive
+    std::size_t limit = SIZE_MAX;           // most records to return, i.e. the page size
+};
+
+struct HistoryPage
+{
+    Status status = Status::Ok;
+    std::size_t count = 0; // records passed to the callback
+    uint64_t cursor = 0;   // pass as HistoryQuery::cursor to continue after this page
+    // Nothing is left in the chosen direction. Oldest first, more records may still be
+    // appended later and read by resuming from cursor.
+    bool at_end = true;
+};
+
+// While one exists, operations on the thread that made it return as soon as their change
+// is in the journal instead of waiting for it to reach the disk, and it collects the
+// journal position that makes all of them durable. Meant for callers that wait for that
+// position some other way, e.g. with Journal::whenDurable. Not nestable.
+class DeferredCommit
+{
+public:
+    DeferredCommit();
+    ~DeferredCommit();
+    DeferredCommit(const DeferredCommit &) = delete;
+    DeferredCommit &operator=(const DeferredCommit &) = delete;
+
+    // Journal the deferred records went to, or null if nothing was deferred
+    Journal *journal() const { return deferred_journal; }
+    uint64_t position() const { return deferred_position; }
+
+private:
+    friend class BankingSystem;
+
+    Journal *deferred_journal = nullptr;
+    uint64_t deferred_position = 0;
+};
+
+class BankingSystem;
+
+// Point-in-time view of some or all accounts for reports, from BankingSystem::openView.
+// Balances are copied when it opens and histories are read up to the length they had
+// then, so it stays consistent for however long it is read while writers carry on, and
+// reading it takes no lock. Accounts deleted after it opened stay readable: deletion
+// retires them, and they are only reclaimed once every view that could see them has been
+// destroyed. Destroy views before the bank.
+class BankView
+{
+public:
+    ~BankView();
+    BankView(const BankView &) = delete;
+    BankView &operator=(const BankView &) = delete;
+
+    // Accounts in the view, in ascending account-number order for views of one owner and
+    // in no particular order otherwise
+    std::span<const SnapshotEntry> accounts() const { return entries; }
+    // The account's entry, or null if it is not in the view
+    const SnapshotEntry *find(int account_number) const;
+    // Calls f(transaction) for each record the account had when the view opened, oldest first
+    template <typename F>
+    void forEachTransaction(const SnapshotEntry &entry, F &&f) const
+    {
+        entry.transactions->forEachRun(entry.num_transactions, [&f](const Transaction *records, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                f(records[i]);
+            }
+        });
+    }
+    // Journal position that covers every change the view includes; 0 without a journal
+    uint64_t journalPosition() const { return journal_position; }
+
+private:
+    friend class BankingSystem;
+    BankView(BankingSystem &bank, uint64_t epoch) : bank(&bank), epoch(epoch) {}
+    // Fills index from entries, once they have all been captured
+    void indexEntries();
+
+    BankingSystem *bank;
+    uint64_t epoch; // pinned in the bank's reclaimer until the view is destroyed
+    std::vector<SnapshotEntry> entries;
+    AccountIndex index; // account number -> position in entries
+    uint64_t journal_position = 0;
+};
+
+constexpr int NUM_INDEX_STRIPES = 64;
+constexpr std::size_t MAX_TRANSACTION_LEGS = MAX_JOURNAL_LEGS;
+// Balance chunks, of BalanceColumn::CHUNK_SIZE accounts, from which interest sweeps split
+// across threads
+constexpr std::size_t PARALLEL_INTEREST_CHUNKS = 4;
+
+// Multi-account transaction built with BankingSystem::begin. Reads are optimistic: balance
+// records the version it saw without holding any lock, and commit fails with Conflict if
+// any account read has changed since, so decisions made on those balances still hold.
+// Debits and credits are only collected until commit, which applies all of them or none.
+class BankTransaction
+{
+public:
+    // Current balance, remembered so commit can check it is still current
+    std::optional<Money> balance(int account_number);
+    void debit(int account_number, Money amount) { legs.push_back({account_number, amount, true}); }
+    void credit(int account_number, Money amount) { legs.push_back({account_number, amount, false}); }
+    // Applies every leg at once. Fails without changing anything if an account is missing,
+    // a debit would overdraw, or (with Conflict) a balance read has changed.
+    Status commit();
+
+private:
+    friend class BankingSystem;
+    explicit BankTransaction(BankingSystem &bank) : bank(&bank) {}
+
+    struct Read
+    {
+        int32_t account_number;
+        uint64_t version;
+    };
+    struct Leg
+    {
+        int32_t account_number;
+        Money amount;
+        bool is_debit;
+    };
+
+    BankingSystem *bank;
+    std::vector<Read> reads;
+    std::vector<Leg> legs; // in the order given
+};
+
+// All operations are thread-safe. Deposits and withdrawals lock only the target account,
+// transfers lock both accounts in account-number order, and creating or deleting an
+// account briefly locks one of NUM_INDEX_STRIPES slices of the index.
+// Accounts switched to the lock-free fast path take deposits and withdrawals with a
+// single CAS on the balance plus a lock-free history append.
+//
+// Operations report their outcome as a Status and do no I/O of their own; the usual
+// human-readable messages are only formatted when a LogSink is set. The display
+// functions still print to std::cout.
+//
+// Balances and rate tiers live in a struct-of-arrays BalanceColumn. Interest pauses
+// every other operation and sweeps the column with a SIMD kernel, split across threads,
+// then posts an Interest transaction to each account whose balance changed.
+//
+// Multi-account transactions read balances optimistically and lock their accounts only
+// to validate and apply, in the same order as transfers, so transactions on disjoint
+// accounts commit in parallel. Accounts on the lock-free path can still take deposits
+// and withdrawals between validation and apply; debits are checked against the balance
+// they replace either way.
+//
+// With a Journal attached, every change is appended to the write-ahead journal while the
+// affected accounts are still locked, and in synchronous commit mode the operation only
+// returns once its record is on disk.
+//
+// Built with BANKING_METRICS, every operation counts its calls and outcomes and records its
+// latency in thread-local histograms; metricsSnapshot adds them up for export.
+//
+// Every change to a balance or a history also updates running totals: the sum of all
+// balances, each owner's balance and the count and volume of each transaction type, so
+// reading them costs the same for any size of bank.
+//
+// Reports print from a BankView, a consistent cut of the accounts they cover that they
+// read without locks. Opening one pauses operations on those accounts only while it copies
+// their balances and history lengths. writeSnapshot saves a view of every account, so it
+// can run on a background thread while the bank keeps serving.
+//
+// compactHistory moves old history records into compressed cold storage; reads decode
+// them transparently, so only memory use and scan speed tell the tiers apart.
 class BankingSystem
 {
 public:
     BankingSystem();
 
-    void createAccount(int account_number, const std::string &owner, double initial_balance);
-    void deposit(int account_number, double amount);
-    void withdraw(int account_number, double amount);
-    void transfer(int from_account_number, int to_account_number, double amount);
-    void calculateInterest(double rate);
+    Status createAccount(int account_number, const std::string &owner, Money initial_balance);
+    Status deposit(int account_number, Money amount);
+    Status withdraw(int account_number, Money amount);
+    Status transfer(int from_account_number, int to_account_number, Money amount);
+    // Rates are fractions, e.g. 0.01 for 1%; a rate that is not finite or is outside
+    // [MIN_INTEREST_RATE, MAX_INTEREST_RATE] fails with InvalidAmount and changes nothing
+    Status calculateInterest(double rate);
+    // Credits interest at tier_rates[t] to every account in rate tier t; accounts in tiers
+    // past the end of tier_rates earn nothing
+    Status calculateInterest(std::span<const double> tier_rates);
+    // Puts an account in a rate tier (0 when created); tiers are not journaled
+    Status setRateTier(int account_number, uint8_t tier);
     void displayTransactions(int account_number);
-    void deleteAccount(int account_number);
+    // Streams the records of an account's history that match query, without copying them:
+    // consume gets runs of consecutive matching records, each oldest first, and the runs
+    // come in the order asked for. The spans are only valid during the call to consume,
+    // which must not call back into the bank. Pages never skip or repeat a record, however
+    // many are appended between them.
+    HistoryPage queryHistory(int account_number, const HistoryQuery &query,
+                             const std::function<void(std::span<const Transaction>)> &consume);
+    Status deleteAccount(int account_number);
     void displayAccountDetails(int account_number);
     void displayAllAccounts();
     void searchAccountsByOwner(const std::string &owner_name);
+    // Account numbers whose owner matches query, in ascending order. Served from an index
+    // kept up to date by create and delete, so it costs the same for any size of bank.
+    std::vector<int32_t> findAccountsByOwner(std::string_view query, OwnerMatch match = OwnerMatch::Exact);
+    // Applies operations in order as if by the single-operation methods, but resolves each
+    // account once, locks every account involved for the whole batch and prints nothing
+    BatchResult applyBatch(std::span<const Operation> operations);
+    // Starts a multi-account transaction; nothing is locked until it commits
+    BankTransaction begin() { return BankTransaction(*this); }
+    // Builds a transaction with body and commits it, starting over with a fresh transaction
+    // on Conflict up to max_attempts times. A status other than Ok from body abandons the
+    // transaction and is returned as it is.
+    Status runTransaction(const std::function<Status(BankTransaction &)> &body, int max_attempts = 16);
+    // Switches an account's deposits and withdrawals to (or back from) the lock-free path
+    Status setLockFreeFastPath(int account_number, bool enabled);
+    // Journals every later change to journal, or stops journaling when it is null; the
+    // journal is not owned and must outlive its use here
+    void attachJournal(Journal *journal) { this->journal.store(journal, std::memory_order_release); }
+    // Rebuilds accounts, balances and histories from a journal file; call on an empty system
+    // before attaching a journal. Returns the number of records replayed, or nullopt if the
+    // journal holds a record this version cannot read (see Journal::replay).
+    std::optional<std::size_t> recover(const std::string &journal_path);
+    // Rebuilds from a snapshot plus the journal records written after it; falls back to
+    // replaying the whole journal if the snapshot is missing or fails verification.
+    // Returns the number of journal records replayed, or nullopt as above.
+    std::optional<std::size_t> recover(const std::string &snapshot_path, const std::string &journal_path);
+    // Writes every account, balance and history to a snapshot file at path, tagged with
+    // the journal position it corresponds to; returns false on I/O errors
+    bool writeSnapshot(const std::string &path);
+    // Adds every account in a snapshot; call on an empty system. Returns the number loaded.
+    std::size_t loadSnapshot(const SnapshotView &snapshot);
+    // Passes a consistent cut of every account, and the journal position it corresponds
+    // to, to write, which may read the owners and histories it names until it returns.
+    // Other operations, deletions included, carry on meanwhile. Returns what write returns.
+    bool withConsistentCut(const std::function<bool(std::span<const SnapshotEntry>, uint64_t)> &write);
+    // Creates the accounts in records, in order, taking the index locks once for the whole
+    // load rather than once per account. Records whose number is taken or whose balance is
+    // negative are skipped. Loads are not journaled; write a snapshot afterwards to make
+    // them durable. Returns the number created.
+    std::size_t loadAccounts(std::span<const AccountRecord> records);
+    // Appends records, in order, to the histories of existing accounts without changing any
+    // balance, e.g. to carry over history along with balances from loadAccounts. Records
+    // for missing accounts are skipped; nothing is journaled. Returns the number appended.
+    std::size_t loadHistory(std::span<const HistoryRecord> records);
+    // Routes operation messages to sink, or stops them when sink is null; the sink is not owned
+    void setLogSink(LogSink *sink) { log_sink.store(sink, std::memory_order_release); }
+    // Calls, rejections by Status and latency histograms for each operation since the bank
+    // was created, summed across threads; all zero unless built with BANKING_METRICS
+    MetricsSnapshot metricsSnapshot() const { return metrics.snapshot(); }
+    // Point-in-time views for reports; see BankView. The first covers every account, the
+    // second the accounts of owners matching query (as findAccountsByOwner), and the third
+    // one account, or none if it does not exist.
+    std::unique_ptr<BankView> openView();
+    std::unique_ptr<BankView> openView(std::string_view owner_query, OwnerMatch match = OwnerMatch::Exact);
+    std::unique_ptr<BankView> openView(int account_number);
+    // Sum of every balance, i.e. what the bank owes its customers. Like the other totals it
+    // is exact while no operation is in flight and may be part-way through one otherwise.
+    Money totalBalance() const { return totals.balance(); }
+    // Records of one type in the histories of the accounts that currently exist
+    TypeTotals transactionTotals(TransactionType type) const { return totals.records(type); }
+    // Sum of the balances of the accounts held by exactly owner
+    Money ownerBalance(std::string_view owner);
+    // Moves all but the newest hot_records or so records of every history into compressed
+    // cold storage (see ColdHistory), which every history read decodes transparently.
+    // Works one stripe at a time, pausing only operations on that stripe's accounts; open
+    // views keep reading what they saw. Returns the number of records moved.
+    std::size_t compactHistory(std::size_t hot_records);
 
-    Account accounts[MAX_ACCOUNTS];
-    int num_accounts;
+    // Grows in chunks; handles stay valid until the account is deleted. A deleted account
+    // stays here, retired, while an open BankView might still read it.
+    SlabStore<Account> accounts;
+    TransactionArena transaction_arena; // segments backing every account's history
 
+    // Looks up an account without keeping any lock; the pointer is only safe to use
+    // while no other thread can delete the account
     Account *findAccount(int account_number);
+
+private:
+    friend class BankTransaction;
+    friend class BankView;
+
+    // Slice of the account index. Operations hold the shared lock for as long as they use
+    // an account from this stripe; create and delete take it exclusively.
+    struct IndexStripe
+    {
+        std::shared_mutex mutex;
+        AccountIndex index; // account number -> handle in accounts
+    };
+
+    IndexStripe &stripeFor(int account_number)
+    {
+        return stripes[static_cast<uint32_t>(account_number) % NUM_INDEX_STRIPES];
+    }
+    // Caller holds the stripe's lock
+    Account *lookup(IndexStripe &stripe, int account_number);
+    void printHistory(const BankView &view, const SnapshotEntry &entry);
+    // Waits for a journal position according to the commit mode, or hands it to the
+    // thread's DeferredCommit; called after unlocking
+    Status commit(Journal *active_journal, uint64_t position);
+    void applyJournalRecord(const JournalRecord &record);
+    Status applyInterest(const RateTable &rates);
+    // Counts and reports a rate that validInterestRate refuses
+    Status rejectInterestRate();
+    Status commitTransaction(BankTransaction &transaction);
+    // Adds an account for a bulk load; caller holds every stripe exclusively and owner_mutex.
+    // Returns null if the number is taken or the store is full.
+    Account *insertLoaded(int32_t account_number, std::string_view owner, Money balance);
+    // Adds a change in an account's balance to the bank-wide and owner totals
+    void addToTotals(Account &account, Money delta);
+    // Appends to an account's history and counts the record in the per-type totals
+    void appendHistory(Account &account, TransactionType type, Money amount, int32_t counterparty, uint32_t timestamp);
+    // Formats the arguments into one message for the log sink, if there is one
+    template <typename... Args>
+    void log(const Args &...args);
+    // Shared locks on every stripe, which keeps accounts from being created or deleted
+    std::vector<std::shared_lock<std::shared_mutex>> lockAllStripes();
+    // Exclusive locks on every stripe, which waits for every running operation to finish
+    std::vector<std::unique_lock<std::shared_mutex>> lockAllStripesExclusive();
+    // Exclusive locks on the stripes whose bits are set, in array order
+    std::vector<std::unique_lock<std::shared_mutex>> lockStripesExclusive(uint64_t stripe_mask);
+    // Caller holds the account's stripe exclusively
+    void addToView(BankView &view, Account &account);
+    // Caller holds the stripes of every account in the view exclusively
+    void setViewJournalPosition(BankView &view);
+
+    IndexStripe stripes[NUM_INDEX_STRIPES];
+    BalanceColumn balance_column; // balances and rate tiers by account handle
+    // Seeds each new account's balance version, so a recreated account never repeats one
+    std::atomic<uint32_t> next_incarnation{0};
+    std::atomic<LogSink *> log_sink{nullptr};
+    std::atomic<Journal *> journal{nullptr};
+    // Updated under a stripe's exclusive lock; owner_mutex is taken after the stripe
+    std::shared_mutex owner_mutex;
+    OwnerIndex owner_index;
+    BankTotals totals;
+    // Deleted accounts and compacted history, held back while views are open. Reclaim with
+    // some stripe held exclusively, which keeps out accounts.forEach, run under every stripe.
+    EpochReclaimer reclaimer;
+    // Sweeps of banks with at least PARALLEL_INTEREST_CHUNKS balance chunks run on these
+    WorkerPool interest_workers;
+    [[no_unique_address]] Metrics metrics;
 };
 
 #endif /* BANKING_SYSTEM_H */
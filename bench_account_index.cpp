@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "account_index.h"
+
+// Lookup latency of AccountIndex at 1K, 1M and 10M accounts. Queries are shuffled so the
+// table is probed in random order rather than streamed through the cache.
+
+namespace
+{
+constexpr int FIRST_ACCOUNT_NUMBER = 1000;
+constexpr size_t NUM_QUERIES = 1 << 16;
+
+std::vector<int> shuffledQueries(int num_accounts, int offset)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(0, num_accounts - 1);
+    std::vector<int> queries(NUM_QUERIES);
+    for (int &query : queries)
+    {
+        query = FIRST_ACCOUNT_NUMBER + offset + pick(rng);
+    }
+    return queries;
+}
+
+void fillIndex(AccountIndex &index, int num_accounts)
+{
+    index.reserve(num_accounts);
+    for (int i = 0; i < num_accounts; ++i)
+    {
+        index.insert(FIRST_ACCOUNT_NUMBER + i, i);
+    }
+}
+} // namespace
+
+static void BM_AccountIndexHit(benchmark::State &state)
+{
+    int num_accounts = static_cast<int>(state.range(0));
+    AccountIndex index;
+    fillIndex(index, num_accounts);
+    std::vector<int> queries = shuffledQueries(num_accounts, 0);
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(index.find(queries[i++ & (NUM_QUERIES - 1)]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AccountIndexHit)->Arg(1000)->Arg(1000000)->Arg(10000000);
+
+static void BM_AccountIndexMiss(benchmark::State &state)
+{
+    int num_accounts = static_cast<int>(state.range(0));
+    AccountIndex index;
+    fillIndex(index, num_accounts);
+    std::vector<int> queries = shuffledQueries(num_accounts, num_accounts);
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(index.find(queries[i++ & (NUM_QUERIES - 1)]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AccountIndexMiss)->Arg(1000)->Arg(1000000)->Arg(10000000);
+
+// Lookups on a table that has been churned by deletes, so probes have to skip tombstones
+static void BM_AccountIndexHitAfterChurn(benchmark::State &state)
+{
+    int num_accounts = static_cast<int>(state.range(0));
+    AccountIndex index;
+    fillIndex(index, num_accounts);
+    for (int i = 0; i < num_accounts; i += 3)
+    {
+        index.erase(FIRST_ACCOUNT_NUMBER + i);
+        index.insert(FIRST_ACCOUNT_NUMBER + num_accounts + i, i);
+    }
+    std::vector<int> queries = shuffledQueries(num_accounts, num_accounts / 2);
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(index.find(queries[i++ & (NUM_QUERIES - 1)]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AccountIndexHitAfterChurn)->Arg(1000)->Arg(1000000)->Arg(10000000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "async_bank.h"
+
+// Durable deposits through AsyncBank with 1 to 1024 coroutines in flight on two workers,
+// against a synchronous journal. Workers never wait for fsync, so throughput grows with
+// the number of coroutines the way bench_journal's grows with the number of threads,
+// without a thread per request. syncs_per_op shows how many deposits each fsync covered.
+
+namespace
+{
+constexpr int NUM_ACCOUNTS = 1000;
+constexpr int DEPOSITS_PER_ITERATION = 4096;
+constexpr std::size_t NUM_WORKERS = 2;
+
+std::string journalPath()
+{
+    return (std::filesystem::temp_directory_path() / "bench_async_bank.wal").string();
+}
+
+struct DetachedCoroutine
+{
+    struct promise_type
+    {
+        DetachedCoroutine get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+DetachedCoroutine depositLoop(AsyncBank &async_bank, int first_account, int num_deposits,
+                              std::atomic<int> &num_finished)
+{
+    for (int i = 0; i < num_deposits; ++i)
+    {
+        co_await async_bank.deposit((first_account + i) % NUM_ACCOUNTS, Money::fromUnits(1));
+    }
+    num_finished.fetch_add(1, std::memory_order_acq_rel);
+    num_finished.notify_one();
+}
+
+void durableDeposits(benchmark::State &state)
+{
+    std::filesystem::remove(journalPath());
+    std::unique_ptr<Journal> journal = Journal::open(journalPath());
+    BankingSystem bank;
+    for (int i = 0; i < NUM_ACCOUNTS; ++i)
+    {
+        bank.createAccount(i, "Owner", Money::fromUnits(1000));
+    }
+    bank.attachJournal(journal.get());
+    // Declared first so it outlives the workers, which may still be notifying it
+    std::atomic<int> num_finished{0};
+    AsyncBank async_bank(bank, NUM_WORKERS);
+
+    int num_coroutines = static_cast<int>(state.range(0));
+    std::size_t syncs_before = journal->syncCount();
+    for (auto _ : state)
+    {
+        num_finished.store(0);
+        for (int i = 0; i < num_coroutines; ++i)
+        {
+            depositLoop(async_bank, i, DEPOSITS_PER_ITERATION / num_coroutines, num_finished);
+        }
+        for (int finished = num_finished.load(); finished < num_coroutines; finished = num_finished.load())
+        {
+            num_finished.wait(finished);
+        }
+    }
+    int64_t num_deposits = state.iterations() * (DEPOSITS_PER_ITERATION / num_coroutines) * num_coroutines;
+    state.SetItemsProcessed(num_deposits);
+    state.counters["syncs_per_op"] =
+        static_cast<double>(journal->syncCount() - syncs_before) / static_cast<double>(num_deposits);
+    bank.attachJournal(nullptr);
+    journal.reset();
+    std::filesystem::remove(journalPath());
+}
+} // namespace
+
+BENCHMARK(durableDeposits)->RangeMultiplier(4)->Range(1, 1024)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
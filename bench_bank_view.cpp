@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "banking_system.h"
+
+// Cost of BankView reports. openView times the pause writers see while a view of every
+// account is captured, for banks of 16K and 1M accounts. depositsDuringReports runs
+// deposits while another thread keeps opening views and reading every balance and
+// history in them (argument 1) or not at all (argument 0); reports only pause writers
+// while they capture, so deposit throughput should barely move.
+
+namespace
+{
+constexpr int REPORT_ACCOUNTS = 1 << 14;
+
+void fillBank(BankingSystem &bank, int num_accounts)
+{
+    for (int i = 0; i < num_accounts; ++i)
+    {
+        bank.createAccount(i, "Owner" + std::to_string(i % 1000), Money::fromUnits(1000));
+    }
+}
+
+void openView(benchmark::State &state)
+{
+    BankingSystem bank;
+    fillBank(bank, static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bank.openView());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void depositsDuringReports(benchmark::State &state)
+{
+    BankingSystem bank;
+    fillBank(bank, REPORT_ACCOUNTS);
+    std::atomic<bool> stop(false);
+    std::atomic<int64_t> num_reports(0);
+    std::thread reporter;
+    if (state.range(0) != 0)
+    {
+        reporter = std::thread([&bank, &stop, &num_reports] {
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                std::unique_ptr<BankView> view = bank.openView();
+                int64_t total = 0;
+                for (const SnapshotEntry &entry : view->accounts())
+                {
+                    total += entry.balance.minorUnits();
+                    view->forEachTransaction(entry, [&total](const Transaction &transaction) {
+                        total += transaction.amount.minorUnits();
+                    });
+                }
+                benchmark::DoNotOptimize(total);
+                num_reports.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> pick_account(0, REPORT_ACCOUNTS - 1);
+    for (auto _ : state)
+    {
+        bank.deposit(pick_account(rng), Money::fromUnits(1));
+    }
+    stop.store(true);
+    if (reporter.joinable())
+    {
+        reporter.join();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["reports"] = static_cast<double>(num_reports.load());
+}
+} // namespace
+
+BENCHMARK(openView)->Arg(REPORT_ACCOUNTS)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK(depositsDuringReports)->ArgName("reporting")->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_MAIN();
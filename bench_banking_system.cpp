@@ -0,0 +1,349 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "banking_system.h"
+#include "workload.h"
+
+// Every BankingSystem operation, across bank sizes and history lengths. Arguments are
+// {accounts, postings already in each account's history}. Accounts are picked from a
+// Zipf distribution with skew 0.99, so a few hot accounts take most of the traffic the
+// way real payment flows do; the mixed workload also runs uniform for comparison.
+//
+// Results are written as JSON to banking_system_benchmarks.json unless --benchmark_out
+// names another file, so runs from two releases can be compared with Google Benchmark's
+// tools/compare.py.
+
+namespace
+{
+constexpr double HOT_SKEW = 0.99;
+constexpr std::size_t STREAM_LENGTH = 1 << 16;
+// Account and owner changes are timed in groups, so pausing the timer to undo them is
+// spread over many operations
+constexpr int GROUP_SIZE = 1024;
+constexpr int ACCOUNTS_PER_OWNER = 4;
+
+std::string ownerName(int account_number)
+{
+    return "Owner" + std::to_string(account_number / ACCOUNTS_PER_OWNER);
+}
+
+void postHistory(BankingSystem &bank, int first_account, int num_accounts, int history_length)
+{
+    std::vector<Operation> deposits;
+    for (int i = 0; i < num_accounts; ++i)
+    {
+        for (int h = 0; h < history_length; ++h)
+        {
+            deposits.push_back({OperationType::Deposit, first_account + i, 0, Money::fromMinorUnits(1)});
+        }
+        if (deposits.size() >= 1 << 16)
+        {
+            bank.applyBatch(deposits);
+            deposits.clear();
+        }
+    }
+    bank.applyBatch(deposits);
+}
+
+// Banks are built once per size and shared by the benchmarks that leave the set of
+// accounts as they found it
+BankingSystem &sharedBank(int num_accounts, int history_length)
+{
+    static std::map<std::pair<int, int>, std::unique_ptr<BankingSystem>> banks;
+    std::unique_ptr<BankingSystem> &bank = banks[{num_accounts, history_length}];
+    if (bank == nullptr)
+    {
+        bank = std::make_unique<BankingSystem>();
+        for (int i = 0; i < num_accounts; ++i)
+        {
+            bank->createAccount(i, ownerName(i), Money::fromUnits(1000000));
+        }
+        postHistory(*bank, 0, num_accounts, history_length);
+    }
+    return *bank;
+}
+
+int numAccounts(const benchmark::State &state)
+{
+    return static_cast<int>(state.range(0));
+}
+
+int historyLength(const benchmark::State &state)
+{
+    return static_cast<int>(state.range(1));
+}
+
+void createAccount(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    int first_new = numAccounts(state);
+    for (auto _ : state)
+    {
+        for (int i = 0; i < GROUP_SIZE; ++i)
+        {
+            bank.createAccount(first_new + i, ownerName(first_new + i), Money::fromUnits(1000));
+        }
+        state.PauseTiming();
+        for (int i = 0; i < GROUP_SIZE; ++i)
+        {
+            bank.deleteAccount(first_new + i);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * GROUP_SIZE);
+}
+
+void deleteAccount(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    int first_new = numAccounts(state);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        for (int i = 0; i < GROUP_SIZE; ++i)
+        {
+            bank.createAccount(first_new + i, ownerName(first_new + i), Money::fromUnits(1000));
+        }
+        postHistory(bank, first_new, GROUP_SIZE, historyLength(state));
+        state.ResumeTiming();
+        for (int i = 0; i < GROUP_SIZE; ++i)
+        {
+            bank.deleteAccount(first_new + i);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * GROUP_SIZE);
+}
+
+void findAccount(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    std::vector<int32_t> stream = generateAccountStream(STREAM_LENGTH, 0, numAccounts(state), HOT_SKEW);
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bank.findAccount(stream[next++ & (STREAM_LENGTH - 1)]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void deposit(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    std::vector<int32_t> stream = generateAccountStream(STREAM_LENGTH, 0, numAccounts(state), HOT_SKEW);
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        bank.deposit(stream[next++ & (STREAM_LENGTH - 1)], Money::fromMinorUnits(1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void withdraw(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    std::vector<int32_t> stream = generateAccountStream(STREAM_LENGTH, 0, numAccounts(state), HOT_SKEW);
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        bank.withdraw(stream[next++ & (STREAM_LENGTH - 1)], Money::fromMinorUnits(1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void transfer(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    std::vector<int32_t> stream = generateAccountStream(STREAM_LENGTH, 0, numAccounts(state), HOT_SKEW);
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        int from = stream[next++ & (STREAM_LENGTH - 1)];
+        int to = stream[next++ & (STREAM_LENGTH - 1)];
+        bank.transfer(from, to, Money::fromMinorUnits(1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void calculateInterest(benchmark::State &state)
+{
+    // Every run posts to every account, so it gets a bank of its own
+    BankingSystem bank;
+    for (int i = 0; i < numAccounts(state); ++i)
+    {
+        bank.createAccount(i, ownerName(i), Money::fromUnits(1000));
+    }
+    postHistory(bank, 0, numAccounts(state), historyLength(state));
+    for (auto _ : state)
+    {
+        bank.calculateInterest(0.01);
+    }
+    state.SetItemsProcessed(state.iterations() * numAccounts(state));
+}
+
+void searchAccountsByOwner(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    std::vector<int32_t> stream = generateAccountStream(STREAM_LENGTH, 0, numAccounts(state), HOT_SKEW);
+    std::vector<std::string> owners;
+    for (int32_t account_number : stream)
+    {
+        owners.push_back(ownerName(account_number));
+    }
+    // The listing goes to std::cout; format it into a discarded buffer instead
+    std::ostringstream discarded;
+    std::streambuf *console = std::cout.rdbuf(discarded.rdbuf());
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        bank.searchAccountsByOwner(owners[next++ & (STREAM_LENGTH - 1)]);
+        if ((next & 1023) == 0)
+        {
+            discarded.str(std::string());
+        }
+    }
+    std::cout.rdbuf(console);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// One page of the newest deposits, as a statement service would pull it
+void queryHistory(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    std::vector<int32_t> stream = generateAccountStream(STREAM_LENGTH, 0, numAccounts(state), HOT_SKEW);
+    HistoryQuery query;
+    query.newest_first = true;
+    query.types = transactionTypeBit(TransactionType::Deposit);
+    query.limit = 20;
+    std::size_t next = 0;
+    std::size_t records = 0;
+    for (auto _ : state)
+    {
+        bank.queryHistory(stream[next++ & (STREAM_LENGTH - 1)], query,
+                          [&records](std::span<const Transaction> run) { records += run.size(); });
+    }
+    benchmark::DoNotOptimize(records);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Kept up to date by every operation, so reading them should not grow with the bank
+void totalBalance(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bank.totalBalance());
+        benchmark::DoNotOptimize(bank.transactionTotals(TransactionType::Deposit));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void ownerBalance(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    std::vector<int32_t> stream = generateAccountStream(STREAM_LENGTH, 0, numAccounts(state), HOT_SKEW);
+    std::vector<std::string> owners;
+    for (int32_t account_number : stream)
+    {
+        owners.push_back(ownerName(account_number));
+    }
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bank.ownerBalance(owners[next++ & (STREAM_LENGTH - 1)]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Generated mix of deposits, withdrawals and transfers; the third argument is the skew
+// in hundredths
+void mixedWorkload(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank(numAccounts(state), historyLength(state));
+    std::vector<Operation> operations = generateWorkload(STREAM_LENGTH, 0, numAccounts(state),
+                                                         static_cast<double>(state.range(2)) / 100);
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        const Operation &operation = operations[next++ & (STREAM_LENGTH - 1)];
+        switch (operation.type)
+        {
+        case OperationType::Deposit:
+            bank.deposit(operation.account_number, operation.amount);
+            break;
+        case OperationType::Withdrawal:
+            bank.withdraw(operation.account_number, operation.amount);
+            break;
+        case OperationType::Transfer:
+            bank.transfer(operation.account_number, operation.to_account_number, operation.amount);
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void bankSizes(benchmark::internal::Benchmark *benchmark)
+{
+    benchmark->ArgNames({"accounts", "history"});
+    for (int num_accounts : {1 << 10, 1 << 14, 1 << 17})
+    {
+        for (int history_length : {0, 64})
+        {
+            benchmark->Args({num_accounts, history_length});
+        }
+    }
+}
+} // namespace
+
+BENCHMARK(createAccount)->Apply(bankSizes);
+BENCHMARK(deleteAccount)->Apply(bankSizes);
+BENCHMARK(findAccount)->Apply(bankSizes);
+BENCHMARK(deposit)->Apply(bankSizes);
+BENCHMARK(withdraw)->Apply(bankSizes);
+BENCHMARK(transfer)->Apply(bankSizes);
+BENCHMARK(calculateInterest)->Apply(bankSizes)->Unit(benchmark::kMillisecond)->Iterations(4);
+BENCHMARK(searchAccountsByOwner)->Apply(bankSizes);
+BENCHMARK(queryHistory)->Apply(bankSizes);
+BENCHMARK(totalBalance)->Apply(bankSizes);
+BENCHMARK(ownerBalance)->Apply(bankSizes);
+BENCHMARK(mixedWorkload)
+    ->ArgNames({"accounts", "history", "skew"})
+    ->ArgsProduct({{1 << 10, 1 << 17}, {0}, {0, 99}});
+
+int main(int argc, char **argv)
+{
+    std::vector<char *> args(argv, argv + argc);
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        has_out |= std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+    }
+    char out_flag[] = "--benchmark_out=banking_system_benchmarks.json";
+    char format_flag[] = "--benchmark_out_format=json";
+    if (!has_out)
+    {
+        args.push_back(out_flag);
+        args.push_back(format_flag);
+    }
+    int num_args = static_cast<int>(args.size());
+    benchmark::Initialize(&num_args, args.data());
+    if (benchmark::ReportUnrecognizedArguments(num_args, args.data()))
+    {
+        return 1;
+    }
+    benchmark::AddCustomContext("zipf_skew", std::to_string(HOT_SKEW));
+    benchmark::AddCustomContext("interest_kernel", bestInterestKernel() == InterestKernel::Avx512 ? "avx512"
+                                                   : bestInterestKernel() == InterestKernel::Avx2 ? "avx2"
+                                                                                                  : "scalar");
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "banking_system.h"
+
+// A settlement file of random postings over 10K accounts, applied one call at a time and
+// with one applyBatch call. The logged single calls write their messages to /dev/null,
+// either through a StreamLogSink (formatting and a flush per message on the calling thread)
+// or through an AsyncLogSink (formatting only; the writes happen on its drainer thread).
+
+namespace
+{
+constexpr int NUM_ACCOUNTS = 10000;
+
+std::vector<Operation> settlementFile(std::size_t num_operations)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick_account(1, NUM_ACCOUNTS);
+    std::uniform_int_distribution<int> pick_type(0, 2);
+    std::uniform_int_distribution<int64_t> pick_amount(1, 10000);
+    std::vector<Operation> operations(num_operations);
+    for (Operation &operation : operations)
+    {
+        operation.type = static_cast<OperationType>(pick_type(rng));
+        operation.account_number = pick_account(rng);
+        operation.to_account_number = pick_account(rng);
+        operation.amount = Money::fromMinorUnits(pick_amount(rng));
+    }
+    return operations;
+}
+
+void openAccounts(BankingSystem &bank)
+{
+    for (int i = 1; i <= NUM_ACCOUNTS; ++i)
+    {
+        bank.createAccount(i, "Owner", Money::fromUnits(1000000));
+    }
+}
+
+enum class Logging
+{
+    None,
+    Stream,
+    Async,
+};
+
+void applySingleCalls(benchmark::State &state, Logging logging)
+{
+    std::ofstream null_output("/dev/null");
+    std::vector<Operation> operations = settlementFile(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto bank = std::make_unique<BankingSystem>();
+        openAccounts(*bank);
+        std::unique_ptr<LogSink> sink;
+        if (logging == Logging::Stream)
+        {
+            sink = std::make_unique<StreamLogSink>(null_output);
+        }
+        else if (logging == Logging::Async)
+        {
+            sink = std::make_unique<AsyncLogSink>(null_output, 1 << 16);
+        }
+        bank->setLogSink(sink.get());
+        state.ResumeTiming();
+        for (const Operation &operation : operations)
+        {
+            switch (operation.type)
+            {
+            case OperationType::Deposit:
+                bank->deposit(operation.account_number, operation.amount);
+                break;
+            case OperationType::Withdrawal:
+                bank->withdraw(operation.account_number, operation.amount);
+                break;
+            case OperationType::Transfer:
+                bank->transfer(operation.account_number, operation.to_account_number, operation.amount);
+                break;
+            }
+        }
+        state.PauseTiming();
+        bank.reset();
+        sink.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+} // namespace
+
+static void BM_SettlementSingleCallsLogged(benchmark::State &state)
+{
+    applySingleCalls(state, Logging::Stream);
+}
+BENCHMARK(BM_SettlementSingleCallsLogged)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_SettlementSingleCallsAsyncLogged(benchmark::State &state)
+{
+    applySingleCalls(state, Logging::Async);
+}
+BENCHMARK(BM_SettlementSingleCallsAsyncLogged)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_SettlementSingleCalls(benchmark::State &state)
+{
+    applySingleCalls(state, Logging::None);
+}
+BENCHMARK(BM_SettlementSingleCalls)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_SettlementBatch(benchmark::State &state)
+{
+    std::vector<Operation> operations = settlementFile(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto bank = std::make_unique<BankingSystem>();
+        openAccounts(*bank);
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(bank->applyBatch(operations));
+        state.PauseTiming();
+        bank.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SettlementBatch)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "bulk_io.h"
+
+// Throughput of CSV import of 1M accounts and 1M postings with 1, 2 and 4 parsing
+// threads, and of exporting the same bank back to CSV.
+
+namespace
+{
+constexpr int NUM_ACCOUNTS = 1 << 20;
+
+std::string csvPath(const char *name)
+{
+    return (std::filesystem::temp_directory_path() / (std::string("bench_bulk_io.") + name)).string();
+}
+
+// Writes both files once, with one deposit per account, and reuses them afterwards
+void ensureCsv()
+{
+    if (std::filesystem::exists(csvPath("transactions")))
+    {
+        return;
+    }
+    std::ofstream accounts(csvPath("accounts"), std::ios::binary);
+    std::ofstream transactions(csvPath("transactions"), std::ios::binary);
+    accounts << "account_number,owner,balance\n";
+    transactions << "account_number,type,amount,counterparty,timestamp\n";
+    for (int i = 0; i < NUM_ACCOUNTS; ++i)
+    {
+        accounts << i << ",\"Owner, " << i % 1000 << "\"," << 1000 + i % 100 << ".25\n";
+        transactions << i << ",deposit," << 1000 + i % 100 << ".25,," << 1700000000 + i << '\n';
+    }
+}
+
+void importAccounts(benchmark::State &state)
+{
+    ensureCsv();
+    for (auto _ : state)
+    {
+        std::unique_ptr<BankingSystem> bank = std::make_unique<BankingSystem>();
+        benchmark::DoNotOptimize(importAccountsCsv(*bank, csvPath("accounts"), static_cast<unsigned>(state.range(0))));
+        state.PauseTiming();
+        bank.reset();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(std::filesystem::file_size(csvPath("accounts"))));
+}
+
+void importTransactions(benchmark::State &state)
+{
+    ensureCsv();
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::unique_ptr<BankingSystem> bank = std::make_unique<BankingSystem>();
+        importAccountsCsv(*bank, csvPath("accounts"));
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(
+            importTransactionsCsv(*bank, csvPath("transactions"), static_cast<unsigned>(state.range(0))));
+        state.PauseTiming();
+        bank.reset();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(std::filesystem::file_size(csvPath("transactions"))));
+}
+
+void exportBank(benchmark::State &state)
+{
+    ensureCsv();
+    BankingSystem bank;
+    importAccountsCsv(bank, csvPath("accounts"));
+    importTransactionsCsv(bank, csvPath("transactions"));
+    std::string accounts_path = csvPath("accounts.written");
+    std::string transactions_path = csvPath("transactions.written");
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(exportCsv(bank, accounts_path, transactions_path));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(std::filesystem::file_size(accounts_path) +
+                                                                      std::filesystem::file_size(transactions_path)));
+    std::filesystem::remove(accounts_path);
+    std::filesystem::remove(transactions_path);
+    // Registered last, so the shared files are no longer needed
+    std::filesystem::remove(csvPath("accounts"));
+    std::filesystem::remove(csvPath("transactions"));
+}
+} // namespace
+
+BENCHMARK(importAccounts)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(importTransactions)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(exportBank)->Unit(benchmark::kMillisecond)->Iterations(3);
+
+BENCHMARK_MAIN();
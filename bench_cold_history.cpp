@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "banking_system.h"
+
+// Payoff and cost of cold history. scanHistory reads every record of 1K accounts with 2K
+// records each, from the hot segments (tier 0) or decoded from the cold part after
+// compactHistory (tier 1). Bytes count decoded Transactions, so its rate is the scan
+// speed, and bytes_per_record is what a record takes in that tier. compactHistory times
+// moving the same histories into the cold tier.
+
+namespace
+{
+constexpr int HISTORY_ACCOUNTS = 1 << 10;
+constexpr int RECORDS_PER_ACCOUNT = 1 << 11;
+
+// Histories of a record every hour or so, amounts spread evenly over orders of magnitude
+// and mostly in whole units, and transfers with other accounts of the bank
+void fillBank(BankingSystem &bank)
+{
+    for (int i = 0; i < HISTORY_ACCOUNTS; ++i)
+    {
+        bank.createAccount(i, "Owner" + std::to_string(i), Money::fromUnits(1000));
+    }
+    std::mt19937 rng(1);
+    std::exponential_distribution<double> gap(1.0 / 3600);
+    std::uniform_int_distribution<int> pick_type(0, 3);
+    std::uniform_int_distribution<int> pick_account(0, HISTORY_ACCOUNTS - 1);
+    std::uniform_real_distribution<double> log_units(0, 7.6); // 1 to 2000 units
+    std::uniform_int_distribution<int64_t> cents(0, 99);
+    std::vector<HistoryRecord> records;
+    records.reserve(static_cast<size_t>(HISTORY_ACCOUNTS) * RECORDS_PER_ACCOUNT);
+    for (int i = 0; i < HISTORY_ACCOUNTS; ++i)
+    {
+        double timestamp = 1.7e9;
+        for (int n = 0; n < RECORDS_PER_ACCOUNT; ++n)
+        {
+            timestamp += gap(rng);
+            TransactionType type = static_cast<TransactionType>(pick_type(rng));
+            bool transfer = type == TransactionType::TransferIn || type == TransactionType::TransferOut;
+            int64_t amount = static_cast<int64_t>(std::exp(log_units(rng))) * Money::MINOR_UNITS_PER_UNIT;
+            amount += n % 4 == 0 ? cents(rng) : 0;
+            records.push_back({i, type, Money::fromMinorUnits(amount), transfer ? pick_account(rng) : NO_COUNTERPARTY,
+                               static_cast<uint32_t>(timestamp)});
+        }
+    }
+    bank.loadHistory(records);
+}
+
+size_t coldBytes(BankingSystem &bank)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < HISTORY_ACCOUNTS; ++i)
+    {
+        bytes += bank.findAccount(i)->transactions.coldBytes();
+    }
+    return bytes;
+}
+
+void scanHistory(benchmark::State &state)
+{
+    BankingSystem bank;
+    fillBank(bank);
+    if (state.range(0) != 0)
+    {
+        bank.compactHistory(0);
+    }
+    size_t num_records = static_cast<size_t>(HISTORY_ACCOUNTS) * RECORDS_PER_ACCOUNT;
+    size_t memory = coldBytes(bank) + bank.transaction_arena.segmentsInUse() * sizeof(TransactionSegment);
+    for (auto _ : state)
+    {
+        int64_t total = 0;
+        for (int i = 0; i < HISTORY_ACCOUNTS; ++i)
+        {
+            bank.findAccount(i)->transactions.forEach(
+                [&total](const Transaction &transaction) { total += transaction.amount.minorUnits(); });
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * num_records * sizeof(Transaction)));
+    state.counters["bytes_per_record"] = static_cast<double>(memory) / num_records;
+}
+
+void compactHistory(benchmark::State &state)
+{
+    std::unique_ptr<BankingSystem> bank;
+    for (auto _ : state)
+    {
+        // Building, and tearing down the previous bank, are left out of the time
+        state.PauseTiming();
+        bank = std::make_unique<BankingSystem>();
+        fillBank(*bank);
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(bank->compactHistory(0));
+    }
+    state.SetItemsProcessed(state.iterations() * HISTORY_ACCOUNTS * RECORDS_PER_ACCOUNT);
+}
+} // namespace
+
+BENCHMARK(scanHistory)->ArgName("tier")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(compactHistory)->Iterations(3)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include "banking_system.h"
+
+// Throughput of concurrent deposits and transfers as the number of threads grows.
+// Each thread works on its own random accounts, so contention comes only from collisions.
+
+namespace
+{
+constexpr int NUM_ACCOUNTS = 10000;
+
+BankingSystem *shared_bank = nullptr;
+
+void setUpBank(const benchmark::State &state)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    shared_bank = new BankingSystem;
+    for (int i = 0; i < NUM_ACCOUNTS; ++i)
+    {
+        shared_bank->createAccount(i, "Owner", Money::fromUnits(1000000));
+    }
+}
+
+void tearDownBank(const benchmark::State &state)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    delete shared_bank;
+    shared_bank = nullptr;
+}
+} // namespace
+
+static void BM_ConcurrentDeposit(benchmark::State &state)
+{
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> pick(0, NUM_ACCOUNTS - 1);
+    for (auto _ : state)
+    {
+        shared_bank->deposit(pick(rng), Money::fromUnits(1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConcurrentDeposit)->Setup(setUpBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_ConcurrentTransfer(benchmark::State &state)
+{
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> pick(0, NUM_ACCOUNTS - 1);
+    for (auto _ : state)
+    {
+        shared_bank->transfer(pick(rng), pick(rng), Money::fromUnits(1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConcurrentTransfer)->Setup(setUpBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
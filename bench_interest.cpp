@@ -0,0 +1,140 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "banking_system.h"
+#include "interest_kernel.h"
+
+// Interest accrual over 10M balances: each kernel sweeping the balance column chunk by
+// chunk, against the same exact scaling done account by account through an
+// array-of-structs at the stride of a whole Account. calculateInterest is timed at 1M
+// accounts, where posting an Interest transaction to every account dominates.
+
+namespace
+{
+constexpr size_t NUM_BALANCES = 10000000;
+constexpr int NUM_BANK_ACCOUNTS = 1000000;
+
+struct Balances
+{
+    std::vector<int64_t> balances;
+    std::vector<uint8_t> tiers;
+};
+
+const Balances &randomBalances()
+{
+    static const Balances balances = [] {
+        std::mt19937_64 rng(42);
+        Balances result{std::vector<int64_t>(NUM_BALANCES), std::vector<uint8_t>(NUM_BALANCES)};
+        for (size_t i = 0; i < NUM_BALANCES; ++i)
+        {
+            result.balances[i] = static_cast<int64_t>(rng() % 100000000);
+            result.tiers[i] = static_cast<uint8_t>(rng() % 4);
+        }
+        return result;
+    }();
+    return balances;
+}
+
+RateTable tieredRates()
+{
+    RateTable rates = {};
+    rates.rates[0] = 10000000; // 1%
+    rates.rates[1] = 25000000;
+    rates.rates[2] = 5000000;
+    return rates;
+}
+
+void sweepColumn(benchmark::State &state, InterestKernel kernel)
+{
+    if (!interestKernelSupported(kernel))
+    {
+        state.SkipWithError("kernel not supported on this CPU");
+        return;
+    }
+    std::vector<int64_t> balances = randomBalances().balances;
+    const std::vector<uint8_t> &tiers = randomBalances().tiers;
+    std::vector<int64_t> credited(BalanceColumn::CHUNK_SIZE);
+    RateTable rates = tieredRates();
+    for (auto _ : state)
+    {
+        for (size_t offset = 0; offset < NUM_BALANCES; offset += BalanceColumn::CHUNK_SIZE)
+        {
+            size_t count = std::min(BalanceColumn::CHUNK_SIZE, NUM_BALANCES - offset);
+            accrueInterest(balances.data() + offset, tiers.data() + offset, count, rates, credited.data(), kernel);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_BALANCES);
+}
+
+void scalarColumn(benchmark::State &state)
+{
+    sweepColumn(state, InterestKernel::Scalar);
+}
+
+void avx2Column(benchmark::State &state)
+{
+    sweepColumn(state, InterestKernel::Avx2);
+}
+
+void avx512Column(benchmark::State &state)
+{
+    sweepColumn(state, InterestKernel::Avx512);
+}
+
+// One balance per Account-sized record, the layout the sweep used to walk
+struct PaddedBalance
+{
+    int64_t balance;
+    uint8_t tier;
+    char rest[sizeof(Account) - sizeof(int64_t) - sizeof(uint8_t)];
+};
+
+void arrayOfStructs(benchmark::State &state)
+{
+    std::unique_ptr<PaddedBalance[]> accounts(new PaddedBalance[NUM_BALANCES]);
+    for (size_t i = 0; i < NUM_BALANCES; ++i)
+    {
+        accounts[i].balance = randomBalances().balances[i];
+        accounts[i].tier = randomBalances().tiers[i];
+    }
+    RateTable rates = tieredRates();
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < NUM_BALANCES; ++i)
+        {
+            int64_t credited;
+            accrueInterest(&accounts[i].balance, &accounts[i].tier, 1, rates, &credited, InterestKernel::Scalar);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_BALANCES);
+}
+
+void calculateInterest(benchmark::State &state)
+{
+    BankingSystem bank;
+    for (int i = 0; i < NUM_BANK_ACCOUNTS; ++i)
+    {
+        bank.createAccount(i, "Owner", Money::fromUnits(1000));
+        bank.setRateTier(i, static_cast<uint8_t>(i % 4));
+    }
+    std::vector<double> tier_rates = {0.01, 0.025, 0.005};
+    for (auto _ : state)
+    {
+        bank.calculateInterest(tier_rates);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_BANK_ACCOUNTS);
+}
+} // namespace
+
+BENCHMARK(scalarColumn)->Unit(benchmark::kMillisecond);
+BENCHMARK(avx2Column)->Unit(benchmark::kMillisecond);
+BENCHMARK(avx512Column)->Unit(benchmark::kMillisecond);
+BENCHMARK(arrayOfStructs)->Unit(benchmark::kMillisecond);
+BENCHMARK(calculateInterest)->Unit(benchmark::kMillisecond)->Iterations(8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "banking_system.h"
+
+// Cost of journaling deposits from 1 to 64 threads. In synchronous mode concurrent
+// deposits share fsyncs (group commit); syncs_per_op shows how many transactions each
+// fsync ended up covering.
+
+namespace
+{
+constexpr int NUM_ACCOUNTS = 1000;
+
+BankingSystem *shared_bank = nullptr;
+std::unique_ptr<Journal> shared_journal;
+
+std::string journalPath()
+{
+    return (std::filesystem::temp_directory_path() / "bench_journal.wal").string();
+}
+
+void setUpBank(const benchmark::State &state, CommitMode mode)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    std::filesystem::remove(journalPath());
+    shared_journal = Journal::open(journalPath(), mode);
+    shared_bank = new BankingSystem;
+    for (int i = 0; i < NUM_ACCOUNTS; ++i)
+    {
+        shared_bank->createAccount(i, "Owner", Money::fromUnits(1000));
+    }
+    shared_bank->attachJournal(shared_journal.get());
+}
+
+void setUpSynchronousBank(const benchmark::State &state)
+{
+    setUpBank(state, CommitMode::Synchronous);
+}
+
+void setUpBackgroundBank(const benchmark::State &state)
+{
+    setUpBank(state, CommitMode::Background);
+}
+
+void setUpUnjournaledBank(const benchmark::State &state)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    shared_bank = new BankingSystem;
+    for (int i = 0; i < NUM_ACCOUNTS; ++i)
+    {
+        shared_bank->createAccount(i, "Owner", Money::fromUnits(1000));
+    }
+}
+
+void tearDownBank(const benchmark::State &state)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    delete shared_bank;
+    shared_bank = nullptr;
+    shared_journal.reset();
+    std::filesystem::remove(journalPath());
+}
+
+void randomDeposits(benchmark::State &state)
+{
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> pick_account(0, NUM_ACCOUNTS - 1);
+    std::size_t syncs_before = shared_journal != nullptr ? shared_journal->syncCount() : 0;
+    for (auto _ : state)
+    {
+        shared_bank->deposit(pick_account(rng), Money::fromUnits(1));
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (shared_journal != nullptr && state.thread_index() == 0)
+    {
+        state.counters["syncs_per_op"] = benchmark::Counter(
+            static_cast<double>(shared_journal->syncCount() - syncs_before) / state.iterations() / state.threads());
+    }
+}
+} // namespace
+
+static void BM_DepositUnjournaled(benchmark::State &state)
+{
+    randomDeposits(state);
+}
+BENCHMARK(BM_DepositUnjournaled)->Setup(setUpUnjournaledBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_DepositSynchronousCommit(benchmark::State &state)
+{
+    randomDeposits(state);
+}
+BENCHMARK(BM_DepositSynchronousCommit)->Setup(setUpSynchronousBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_DepositBackgroundCommit(benchmark::State &state)
+{
+    randomDeposits(state);
+}
+BENCHMARK(BM_DepositBackgroundCommit)->Setup(setUpBackgroundBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+// A single thread posting 1000 deposits per applyBatch call, which waits for one fsync per batch
+static void BM_DepositBatchSynchronousCommit(benchmark::State &state)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick_account(0, NUM_ACCOUNTS - 1);
+    std::vector<Operation> operations(1000);
+    for (Operation &operation : operations)
+    {
+        operation = Operation{OperationType::Deposit, pick_account(rng), 0, Money::fromUnits(1)};
+    }
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(shared_bank->applyBatch(operations));
+    }
+    state.SetItemsProcessed(state.iterations() * operations.size());
+}
+BENCHMARK(BM_DepositBatchSynchronousCommit)->Setup(setUpSynchronousBank)->Teardown(tearDownBank)->UseRealTime();
+
+BENCHMARK_MAIN();
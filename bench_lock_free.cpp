@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+
+#include "banking_system.h"
+
+// Deposits and withdrawals on a single hot account from 1 to 64 threads, comparing the
+// per-account mutex with the lock-free CAS fast path.
+
+namespace
+{
+constexpr int HOT_ACCOUNT = 1;
+
+BankingSystem *shared_bank = nullptr;
+
+void setUpBank(const benchmark::State &state, bool lock_free)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    shared_bank = new BankingSystem;
+    shared_bank->createAccount(HOT_ACCOUNT, "Merchant", Money::fromUnits(1000000));
+    shared_bank->setLockFreeFastPath(HOT_ACCOUNT, lock_free);
+}
+
+void setUpMutexBank(const benchmark::State &state)
+{
+    setUpBank(state, false);
+}
+
+void setUpLockFreeBank(const benchmark::State &state)
+{
+    setUpBank(state, true);
+}
+
+void tearDownBank(const benchmark::State &state)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    delete shared_bank;
+    shared_bank = nullptr;
+}
+
+void hotAccountDeposits(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        shared_bank->deposit(HOT_ACCOUNT, Money::fromUnits(1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void hotAccountMixed(benchmark::State &state)
+{
+    bool deposit = true;
+    for (auto _ : state)
+    {
+        if (deposit)
+        {
+            shared_bank->deposit(HOT_ACCOUNT, Money::fromUnits(1));
+        }
+        else
+        {
+            shared_bank->withdraw(HOT_ACCOUNT, Money::fromUnits(1));
+        }
+        deposit = !deposit;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+} // namespace
+
+static void BM_HotAccountDepositMutex(benchmark::State &state)
+{
+    hotAccountDeposits(state);
+}
+BENCHMARK(BM_HotAccountDepositMutex)->Setup(setUpMutexBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_HotAccountDepositLockFree(benchmark::State &state)
+{
+    hotAccountDeposits(state);
+}
+BENCHMARK(BM_HotAccountDepositLockFree)->Setup(setUpLockFreeBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_HotAccountMixedMutex(benchmark::State &state)
+{
+    hotAccountMixed(state);
+}
+BENCHMARK(BM_HotAccountMixedMutex)->Setup(setUpMutexBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_HotAccountMixedLockFree(benchmark::State &state)
+{
+    hotAccountMixed(state);
+}
+BENCHMARK(BM_HotAccountMixedLockFree)->Setup(setUpLockFreeBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
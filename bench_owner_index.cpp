@@ -0,0 +1,106 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "banking_system.h"
+
+// Owner-name searches on a book of 1M accounts spread over 100K names, through the owner
+// index against the full scan searchAccountsByOwner used to do.
+
+namespace
+{
+constexpr int NUM_ACCOUNTS = 1000000;
+constexpr int NUM_OWNERS = 100000;
+
+std::string ownerName(int i)
+{
+    return "Customer" + std::to_string(i);
+}
+
+BankingSystem &sharedBank()
+{
+    static BankingSystem *bank = [] {
+        BankingSystem *bank = new BankingSystem;
+        for (int i = 0; i < NUM_ACCOUNTS; ++i)
+        {
+            bank->createAccount(i, ownerName(i % NUM_OWNERS), Money::fromUnits(100));
+        }
+        return bank;
+    }();
+    return *bank;
+}
+
+std::vector<std::string> randomQueries(size_t count)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> owner(0, NUM_OWNERS - 1);
+    std::vector<std::string> queries(count);
+    for (std::string &query : queries)
+    {
+        query = ownerName(owner(rng));
+    }
+    return queries;
+}
+
+void indexedSearch(benchmark::State &state, OwnerMatch match)
+{
+    BankingSystem &bank = sharedBank();
+    std::vector<std::string> queries = randomQueries(1024);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bank.findAccountsByOwner(queries[i++ & 1023], match));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void exactSearch(benchmark::State &state)
+{
+    indexedSearch(state, OwnerMatch::Exact);
+}
+
+void caseInsensitiveSearch(benchmark::State &state)
+{
+    indexedSearch(state, OwnerMatch::IgnoreCase);
+}
+
+void prefixSearch(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank();
+    for (auto _ : state)
+    {
+        // "customer1234" matches 11 owners: itself and Customer12340..Customer12349
+        benchmark::DoNotOptimize(bank.findAccountsByOwner("customer1234", OwnerMatch::PrefixIgnoreCase));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void fullScan(benchmark::State &state)
+{
+    BankingSystem &bank = sharedBank();
+    std::vector<std::string> queries = randomQueries(1024);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        const std::string &query = queries[i++ & 1023];
+        std::vector<int32_t> account_numbers;
+        bank.accounts.forEach([&](int32_t, Account &account) {
+            if (account.owner == query)
+            {
+                account_numbers.push_back(account.account_number);
+            }
+        });
+        benchmark::DoNotOptimize(account_numbers);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+} // namespace
+
+BENCHMARK(exactSearch);
+BENCHMARK(caseInsensitiveSearch);
+BENCHMARK(prefixSearch);
+BENCHMARK(fullScan)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
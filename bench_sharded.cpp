@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "banking_system.h"
+#include "sharded_bank.h"
+
+// Transfers through the share-nothing ShardedBank against the locking BankingSystem.
+// One call at a time pays for a round trip to a worker, so the sharded runs also submit
+// whole batches, which keeps every shard busy at once; the argument is the shard count.
+
+namespace
+{
+constexpr int NUM_ACCOUNTS = 10000;
+constexpr int BATCH_SIZE = 1024;
+
+std::vector<Operation> randomTransfers(int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, NUM_ACCOUNTS - 1);
+    std::vector<Operation> operations(BATCH_SIZE);
+    for (Operation &operation : operations)
+    {
+        operation = {OperationType::Transfer, pick(rng), pick(rng), Money::fromUnits(1)};
+    }
+    return operations;
+}
+
+template <typename Bank>
+void openAccounts(Bank &bank)
+{
+    for (int i = 0; i < NUM_ACCOUNTS; ++i)
+    {
+        bank.createAccount(i, "Owner", Money::fromUnits(1000000));
+    }
+}
+
+void lockedTransfers(benchmark::State &state)
+{
+    BankingSystem bank;
+    openAccounts(bank);
+    std::vector<Operation> operations = randomTransfers(0);
+    for (auto _ : state)
+    {
+        for (const Operation &operation : operations)
+        {
+            bank.transfer(operation.account_number, operation.to_account_number, operation.amount);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+
+void lockedBatch(benchmark::State &state)
+{
+    BankingSystem bank;
+    openAccounts(bank);
+    std::vector<Operation> operations = randomTransfers(0);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bank.applyBatch(operations));
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+
+void shardedTransfers(benchmark::State &state)
+{
+    ShardedBank bank(static_cast<size_t>(state.range(0)));
+    openAccounts(bank);
+    std::vector<Operation> operations = randomTransfers(0);
+    for (auto _ : state)
+    {
+        for (const Operation &operation : operations)
+        {
+            bank.transfer(operation.account_number, operation.to_account_number, operation.amount);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+
+void shardedBatch(benchmark::State &state)
+{
+    ShardedBank bank(static_cast<size_t>(state.range(0)));
+    openAccounts(bank);
+    std::vector<Operation> operations = randomTransfers(0);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bank.applyBatch(operations));
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+} // namespace
+
+BENCHMARK(lockedTransfers)->UseRealTime();
+BENCHMARK(lockedBatch)->UseRealTime();
+BENCHMARK(shardedTransfers)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK(shardedBatch)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "banking_system.h"
+
+// Time to get a bank of 1M and 10M accounts queryable: mapping a snapshot and looking up
+// accounts in place, bulk-loading it into a BankingSystem, or rebuilding from scratch
+// with createAccount as replaying a journal of account openings would. Also times
+// writing the snapshot.
+
+namespace
+{
+constexpr int NUM_LOOKUPS = 1000;
+
+std::string snapshotPath(int64_t num_accounts)
+{
+    return (std::filesystem::temp_directory_path() / ("bench_snapshot." + std::to_string(num_accounts))).string();
+}
+
+void fillBank(BankingSystem &bank, int64_t num_accounts)
+{
+    for (int i = 0; i < num_accounts; ++i)
+    {
+        bank.createAccount(i, "Owner" + std::to_string(i % 1000), Money::fromUnits(1000));
+    }
+}
+
+// Writes the snapshot for a bank of num_accounts once and reuses it afterwards
+void ensureSnapshot(int64_t num_accounts)
+{
+    if (std::filesystem::exists(snapshotPath(num_accounts)))
+    {
+        return;
+    }
+    BankingSystem bank;
+    fillBank(bank, num_accounts);
+    bank.writeSnapshot(snapshotPath(num_accounts));
+}
+
+void openAndLookUp(benchmark::State &state)
+{
+    ensureSnapshot(state.range(0));
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> account(0, static_cast<int>(state.range(0)) - 1);
+    for (auto _ : state)
+    {
+        std::unique_ptr<SnapshotView> snapshot = SnapshotView::open(snapshotPath(state.range(0)));
+        int64_t total = 0;
+        for (int i = 0; i < NUM_LOOKUPS; ++i)
+        {
+            total += snapshot->find(account(rng))->balance;
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetLabel(std::to_string(NUM_LOOKUPS) + " lookups");
+}
+
+void loadIntoBank(benchmark::State &state)
+{
+    ensureSnapshot(state.range(0));
+    std::unique_ptr<SnapshotView> snapshot = SnapshotView::open(snapshotPath(state.range(0)));
+    for (auto _ : state)
+    {
+        std::unique_ptr<BankingSystem> bank = std::make_unique<BankingSystem>();
+        benchmark::DoNotOptimize(bank->loadSnapshot(*snapshot));
+        state.PauseTiming();
+        bank.reset();
+        state.ResumeTiming();
+    }
+}
+
+void rebuildWithCreateAccount(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        std::unique_ptr<BankingSystem> bank = std::make_unique<BankingSystem>();
+        fillBank(*bank, state.range(0));
+        state.PauseTiming();
+        bank.reset();
+        state.ResumeTiming();
+    }
+}
+
+void writeSnapshot(benchmark::State &state)
+{
+    BankingSystem bank;
+    fillBank(bank, state.range(0));
+    std::string path = snapshotPath(state.range(0)) + ".written";
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(bank.writeSnapshot(path));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(std::filesystem::file_size(path)));
+    std::filesystem::remove(path);
+    // Registered last, so the shared snapshot is no longer needed
+    std::filesystem::remove(snapshotPath(state.range(0)));
+}
+} // namespace
+
+BENCHMARK(openAndLookUp)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(loadIntoBank)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond)->Iterations(1);
+BENCHMARK(rebuildWithCreateAccount)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond)->Iterations(1);
+BENCHMARK(writeSnapshot)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond)->Iterations(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include "banking_system.h"
+
+// Multi-account transactions paying from one account to four others, as the number of
+// threads grows. In the disjoint runs each thread stays within its own block of accounts,
+// so commits never share an account; in the shared runs every thread draws from a few
+// hundred accounts, so some reads go stale and are retried.
+
+namespace
+{
+constexpr int NUM_ACCOUNTS = 10000;
+constexpr int SHARED_ACCOUNTS = 256;
+constexpr int ACCOUNTS_PER_THREAD = 128;
+constexpr int NUM_PAYEES = 4;
+
+BankingSystem *shared_bank = nullptr;
+
+void setUpBank(const benchmark::State &state)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    shared_bank = new BankingSystem;
+    for (int i = 0; i < NUM_ACCOUNTS; ++i)
+    {
+        shared_bank->createAccount(i, "Owner", Money::fromUnits(1000000));
+    }
+}
+
+void tearDownBank(const benchmark::State &state)
+{
+    if (state.thread_index() != 0)
+    {
+        return;
+    }
+    delete shared_bank;
+    shared_bank = nullptr;
+}
+
+void payFromOneToMany(benchmark::State &state, int first_account, int num_accounts)
+{
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> pick(first_account, first_account + num_accounts - 1);
+    Money amount = Money::fromUnits(1);
+    Money total = Money::fromUnits(NUM_PAYEES);
+    int64_t attempts = 0;
+    for (auto _ : state)
+    {
+        int payer = pick(rng);
+        int payees[NUM_PAYEES];
+        for (int &payee : payees)
+        {
+            payee = pick(rng);
+        }
+        Status status = shared_bank->runTransaction([&](BankTransaction &transaction) {
+            attempts++;
+            if (*transaction.balance(payer) < total)
+            {
+                return Status::InsufficientFunds;
+            }
+            transaction.debit(payer, total);
+            for (int payee : payees)
+            {
+                transaction.credit(payee, amount);
+            }
+            return Status::Ok;
+        });
+        benchmark::DoNotOptimize(status);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["retries"] =
+        benchmark::Counter(static_cast<double>(attempts - state.iterations()), benchmark::Counter::kAvgThreads);
+}
+} // namespace
+
+static void BM_DisjointTransactions(benchmark::State &state)
+{
+    payFromOneToMany(state, state.thread_index() * ACCOUNTS_PER_THREAD, ACCOUNTS_PER_THREAD);
+}
+BENCHMARK(BM_DisjointTransactions)->Setup(setUpBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_SharedTransactions(benchmark::State &state)
+{
+    payFromOneToMany(state, 0, SHARED_ACCOUNTS);
+}
+BENCHMARK(BM_SharedTransactions)->Setup(setUpBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+// The same payments as single transfers, which is what these flows did before, each leg
+// committed on its own
+static void BM_DisjointTransfers(benchmark::State &state)
+{
+    std::mt19937 rng(state.thread_index());
+    int first_account = state.thread_index() * ACCOUNTS_PER_THREAD;
+    std::uniform_int_distribution<int> pick(first_account, first_account + ACCOUNTS_PER_THREAD - 1);
+    for (auto _ : state)
+    {
+        int payer = pick(rng);
+        for (int i = 0; i < NUM_PAYEES; ++i)
+        {
+            shared_bank->transfer(payer, pick(rng), Money::fromUnits(1));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DisjointTransfers)->Setup(setUpBank)->Teardown(tearDownBank)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,708 @@
+#include "bulk_io.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+// Below this much input per thread, starting another thread costs more than it saves
+constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+constexpr size_t MAX_FIELDS = 5;
+constexpr size_t BLOCK_SIZE = 64;
+
+constexpr TransactionType TRANSACTION_TYPES[] = {
+    TransactionType::Deposit,  TransactionType::Withdrawal, TransactionType::TransferOut, TransactionType::TransferIn,
+    TransactionType::Interest, TransactionType::Debit,      TransactionType::Credit,
+};
+
+// Read-only mapping of a whole file
+struct MappedFile
+{
+    explicit MappedFile(const string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        struct stat status;
+        if (fstat(fd, &status) == 0)
+        {
+            length = static_cast<size_t>(status.st_size);
+            if (length == 0)
+            {
+                ok = true;
+            }
+            else
+            {
+                void *base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (base != MAP_FAILED)
+                {
+                    // Every byte is read once, front to back
+                    madvise(base, length, MADV_SEQUENTIAL);
+                    data = static_cast<const char *>(base);
+                    ok = true;
+                }
+            }
+        }
+        ::close(fd);
+    }
+    ~MappedFile()
+    {
+        if (data != nullptr)
+        {
+            munmap(const_cast<char *>(data), length);
+        }
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data = nullptr;
+    size_t length = 0;
+    bool ok = false;
+};
+
+// Bit i set when data[i] is a comma or a line feed; length is at most BLOCK_SIZE
+uint64_t separatorMaskScalar(const char *data, size_t length)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        mask |= uint64_t(data[i] == ',' || data[i] == '\n') << i;
+    }
+    return mask;
+}
+
+#if defined(__x86_64__)
+// Same as separatorMaskScalar for a full block
+__attribute__((target("avx2"))) uint64_t separatorMaskAvx2(const char *data)
+{
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 32));
+    uint32_t low_mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(low, comma), _mm256_cmpeq_epi8(low, newline))));
+    uint32_t high_mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(high, comma), _mm256_cmpeq_epi8(high, newline))));
+    return uint64_t(low_mask) | uint64_t(high_mask) << 32;
+}
+#endif
+
+bool hasAvx2()
+{
+#if defined(__x86_64__)
+    static const bool supported = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// Yields the positions of every comma and line feed in order, classifying a block of
+// BLOCK_SIZE bytes at a time into a bitmask and then popping one bit per separator
+class SeparatorScanner
+{
+public:
+    SeparatorScanner(const char *data, size_t length) : data(data), length(length), use_avx2(hasAvx2())
+    {
+        load(0);
+    }
+
+    // Position of the next separator, or length if there is none
+    size_t next()
+    {
+        while (mask == 0)
+        {
+            if (block + BLOCK_SIZE >= length)
+            {
+                return length;
+            }
+            load(block + BLOCK_SIZE);
+        }
+        size_t position = block + static_cast<size_t>(countr_zero(mask));
+        mask &= mask - 1;
+        return position;
+    }
+
+    // Forgets any separators before position, e.g. commas inside a quoted field
+    void skipTo(size_t position)
+    {
+        load(position - position % BLOCK_SIZE);
+        mask &= ~uint64_t(0) << (position % BLOCK_SIZE);
+    }
+
+private:
+    void load(size_t start)
+    {
+        block = start;
+        if (start >= length)
+        {
+            mask = 0;
+            return;
+        }
+        size_t n = min(BLOCK_SIZE, length - start);
+#if defined(__x86_64__)
+        if (n == BLOCK_SIZE && use_avx2)
+        {
+            mask = separatorMaskAvx2(data + start);
+            return;
+        }
+#endif
+        mask = separatorMaskScalar(data + start, n);
+    }
+
+    const char *data;
+    size_t length;
+    bool use_avx2;
+    size_t block = 0; // start of the block mask describes
+    uint64_t mask = 0; // separators in the block not yet returned
+};
+
+struct CsvRow
+{
+    array<string_view, MAX_FIELDS> fields;
+    size_t num_fields = 0; // may exceed MAX_FIELDS; only the first MAX_FIELDS are kept
+    bool malformed = false;
+
+    bool blank() const { return num_fields == 1 && fields[0].empty(); }
+};
+
+// Splits one chunk of a CSV file into rows, one per line
+class CsvReader
+{
+public:
+    // Fields with doubled quotes cannot point into the file; they are unescaped into unescaped
+    CsvReader(const char *data, size_t length, deque<string> &unescaped)
+        : data(data), length(length), scanner(data, length), unescaped(unescaped)
+    {
+    }
+
+    // Reads the next line into row; returns false at the end of the chunk
+    bool next(CsvRow &row)
+    {
+        if (position >= length)
+        {
+            return false;
+        }
+        row.num_fields = 0;
+        row.malformed = false;
+        while (true)
+        {
+            string_view field;
+            size_t end;
+            if (position < length && data[position] == '"')
+            {
+                size_t closing_end;
+                if (!readQuoted(field, closing_end))
+                {
+                    row.malformed = true;
+                    skipLine(closing_end);
+                    return true;
+                }
+                scanner.skipTo(closing_end);
+                end = scanner.next();
+                // Only a separator, or the CR of a CRLF, may follow the closing quote
+                if (end != closing_end && !(end == closing_end + 1 && data[closing_end] == '\r'))
+                {
+                    row.malformed = true;
+                    if (end < length && data[end] == ',')
+                    {
+                        skipLine(end);
+                        return true;
+                    }
+                }
+            }
+            else
+            {
+                end = scanner.next();
+                field = string_view(data + position, end - position);
+            }
+            if (row.num_fields < MAX_FIELDS)
+            {
+                row.fields[row.num_fields] = field;
+            }
+            row.num_fields++;
+            position = end + 1;
+            if (end >= length || data[end] == '\n')
+            {
+                break;
+            }
+        }
+        string_view &last = row.fields[min(row.num_fields, MAX_FIELDS) - 1];
+        if (row.num_fields <= MAX_FIELDS && !last.empty() && last.back() == '\r')
+        {
+            last.remove_suffix(1);
+        }
+        return true;
+    }
+
+private:
+    // Reads the quoted field at position; end is set just past the closing quote. Fails
+    // if the line ends first, leaving end at the line feed.
+    bool readQuoted(string_view &field, size_t &end)
+    {
+        size_t start = position + 1;
+        size_t i = start;
+        bool escaped = false;
+        while (true)
+        {
+            const void *found = i < length ? memchr(data + i, '"', length - i) : nullptr;
+            size_t quote = found != nullptr ? static_cast<size_t>(static_cast<const char *>(found) - data) : length;
+            const void *line_feed = memchr(data + i, '\n', quote - i);
+            if (line_feed != nullptr || quote == length)
+            {
+                end = line_feed != nullptr ? static_cast<size_t>(static_cast<const char *>(line_feed) - data) : length;
+                return false;
+            }
+            if (quote + 1 < length && data[quote + 1] == '"')
+            {
+                escaped = true;
+                i = quote + 2;
+                continue;
+            }
+            end = quote + 1;
+            field = string_view(data + start, quote - start);
+            break;
+        }
+        if (escaped)
+        {
+            string &unescaped_field = unescaped.emplace_back();
+            for (size_t i = 0; i < field.size(); ++i)
+            {
+                unescaped_field.push_back(field[i]);
+                i += field[i] == '"';
+            }
+            field = unescaped_field;
+        }
+        return true;
+    }
+
+    // Moves past the line feed at or after from
+    void skipLine(size_t from)
+    {
+        const void *line_feed = from < length ? memchr(data + from, '\n', length - from) : nullptr;
+        position = line_feed != nullptr ? static_cast<size_t>(static_cast<const char *>(line_feed) - data) + 1 : length;
+        scanner.skipTo(position);
+    }
+
+    const char *data;
+    size_t length;
+    SeparatorScanner scanner;
+    size_t position = 0;
+    deque<string> &unescaped;
+};
+
+template <typename T>
+bool parseInteger(string_view text, T &value)
+{
+    from_chars_result result = from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == errc() && result.ptr == text.data() + text.size();
+}
+
+bool parseAccountRow(const CsvRow &row, AccountRecord &record)
+{
+    optional<Money> balance;
+    if (row.num_fields != 3 || !parseInteger(row.fields[0], record.account_number) ||
+        !(balance = parseCsvAmount(row.fields[2])))
+    {
+        return false;
+    }
+    record.owner = row.fields[1];
+    record.balance = *balance;
+    return true;
+}
+
+bool parseTransactionRow(const CsvRow &row, HistoryRecord &record)
+{
+    optional<TransactionType> type;
+    optional<Money> amount;
+    record.counterparty = NO_COUNTERPARTY;
+    if (row.num_fields != 5 || !parseInteger(row.fields[0], record.account_number) ||
+        !(type = parseTransactionTypeCode(row.fields[1])) || !(amount = parseCsvAmount(row.fields[2])) ||
+        (!row.fields[3].empty() && !parseInteger(row.fields[3], record.counterparty)) ||
+        !parseInteger(row.fields[4], record.timestamp))
+    {
+        return false;
+    }
+    record.type = *type;
+    record.amount = *amount;
+    return true;
+}
+
+template <typename Record>
+struct ParsedChunk
+{
+    vector<Record> records;
+    deque<string> unescaped; // fields the records refer to that are not in the file as they are
+    size_t lines = 0;
+    size_t rows = 0;
+    size_t malformed = 0;
+    size_t first_malformed_line = 0; // within the chunk, 1-based
+};
+
+template <typename Record>
+void parseChunk(const char *data, size_t length, bool first_chunk, bool (*parse_row)(const CsvRow &, Record &),
+                ParsedChunk<Record> &chunk)
+{
+    CsvReader reader(data, length, chunk.unescaped);
+    CsvRow row;
+    Record record;
+    while (reader.next(row))
+    {
+        chunk.lines++;
+        if (row.blank())
+        {
+            continue;
+        }
+        // A header is told apart by its first field not being an account number
+        int32_t account_number;
+        if (first_chunk && chunk.lines == 1 && !row.malformed && !parseInteger(row.fields[0], account_number))
+        {
+            continue;
+        }
+        chunk.rows++;
+        if (!row.malformed && parse_row(row, record))
+        {
+            chunk.records.push_back(record);
+        }
+        else if (chunk.malformed++ == 0)
+        {
+            chunk.first_malformed_line = chunk.lines;
+        }
+    }
+}
+
+// Parses the file in chunks on num_threads threads and loads each chunk, in file order,
+// as soon as it and every chunk before it are parsed
+template <typename Record>
+CsvImportResult importCsv(const string &path, unsigned num_threads, bool (*parse_row)(const CsvRow &, Record &),
+                          const function<size_t(span<const Record>)> &load)
+{
+    CsvImportResult result;
+    MappedFile file(path);
+    if (!file.ok)
+    {
+        return result;
+    }
+    result.ok = true;
+    if (num_threads == 0)
+    {
+        num_threads = max(thread::hardware_concurrency(), 1u);
+        num_threads = static_cast<unsigned>(min<size_t>(num_threads, file.length / MIN_CHUNK_SIZE + 1));
+    }
+
+    // Chunks end just after a line feed, so no row is split between two of them
+    vector<size_t> boundaries = {0};
+    for (unsigned t = 1; t < num_threads; ++t)
+    {
+        size_t boundary = max(file.length / num_threads * t, boundaries.back());
+        const void *line_feed =
+            boundary < file.length ? memchr(file.data + boundary, '\n', file.length - boundary) : nullptr;
+        boundaries.push_back(line_feed != nullptr ? static_cast<size_t>(static_cast<const char *>(line_feed) - file.data) + 1
+                                                  : file.length);
+    }
+    boundaries.push_back(file.length);
+
+    vector<ParsedChunk<Record>> chunks(num_threads);
+    auto parse = [&](unsigned t) {
+        parseChunk(file.data + boundaries[t], boundaries[t + 1] - boundaries[t], t == 0, parse_row, chunks[t]);
+    };
+    vector<thread> parsers;
+    for (unsigned t = 1; t < num_threads; ++t)
+    {
+        parsers.emplace_back(parse, t);
+    }
+    parse(0);
+
+    size_t lines_before = 0;
+    for (unsigned t = 0; t < num_threads; ++t)
+    {
+        if (t > 0)
+        {
+            parsers[t - 1].join();
+        }
+        ParsedChunk<Record> &chunk = chunks[t];
+        result.rows += chunk.rows;
+        result.malformed += chunk.malformed;
+        if (result.first_malformed_line == 0 && chunk.first_malformed_line != 0)
+        {
+            result.first_malformed_line = lines_before + chunk.first_malformed_line;
+        }
+        lines_before += chunk.lines;
+        result.loaded += load(chunk.records);
+        chunk.records = vector<Record>();
+        chunk.unescaped = deque<string>();
+    }
+    result.skipped = result.rows - result.malformed - result.loaded;
+    return result;
+}
+
+// Buffered output to a file written beside path and renamed over it by finish
+class CsvWriter
+{
+public:
+    explicit CsvWriter(const string &path)
+        : path(path), temporary_path(path + ".tmp"),
+          fd(::open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)), ok(fd >= 0)
+    {
+        buffer.reserve(WRITE_BUFFER_SIZE);
+    }
+    ~CsvWriter()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            unlink(temporary_path.c_str());
+        }
+    }
+    CsvWriter(const CsvWriter &) = delete;
+    CsvWriter &operator=(const CsvWriter &) = delete;
+
+    void text(string_view value)
+    {
+        buffer.append(value);
+        flushIfFull();
+    }
+
+    // Quotes value if it holds a comma, quote or line break
+    void field(string_view value)
+    {
+        if (value.find_first_of(",\"\r\n") == string_view::npos)
+        {
+            text(value);
+            return;
+        }
+        buffer.push_back('"');
+        for (char c : value)
+        {
+            buffer.append(c == '"' ? 2 : 1, c);
+        }
+        buffer.push_back('"');
+        flushIfFull();
+    }
+
+    template <typename T>
+    void integer(T value)
+    {
+        char digits[24];
+        to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+        flushIfFull();
+    }
+
+    // Always two decimal places, e.g. -12.05
+    void amount(Money amount)
+    {
+        int64_t minor_units = amount.minorUnits();
+        uint64_t magnitude = minor_units < 0 ? 0 - static_cast<uint64_t>(minor_units) : static_cast<uint64_t>(minor_units);
+        if (minor_units < 0)
+        {
+            buffer.push_back('-');
+        }
+        integer(magnitude / Money::MINOR_UNITS_PER_UNIT);
+        uint64_t cents = magnitude % Money::MINOR_UNITS_PER_UNIT;
+        buffer.push_back('.');
+        buffer.push_back(static_cast<char>('0' + cents / 10));
+        buffer.push_back(static_cast<char>('0' + cents % 10));
+    }
+
+    bool finish()
+    {
+        flush();
+        ok = ::close(fd) == 0 && ok;
+        fd = -1;
+        if (!ok || rename(temporary_path.c_str(), path.c_str()) != 0)
+        {
+            unlink(temporary_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void flushIfFull()
+    {
+        if (buffer.size() >= WRITE_BUFFER_SIZE - 64)
+        {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        const char *data = buffer.data();
+        size_t length = buffer.size();
+        while (ok && length > 0)
+        {
+            ssize_t written = ::write(fd, data, length);
+            if (written < 0 && errno != EINTR)
+            {
+                ok = false;
+            }
+            else if (written > 0)
+            {
+                data += written;
+                length -= static_cast<size_t>(written);
+            }
+        }
+        buffer.clear();
+    }
+
+    string path;
+    string temporary_path;
+    int fd;
+    bool ok;
+    string buffer;
+};
+} // namespace
+
+const char *transactionTypeCode(TransactionType type)
+{
+    switch (type)
+    {
+    case TransactionType::Deposit:
+        return "deposit";
+    case TransactionType::Withdrawal:
+        return "withdrawal";
+    case TransactionType::TransferOut:
+        return "transfer_out";
+    case TransactionType::TransferIn:
+        return "transfer_in";
+    case TransactionType::Interest:
+        return "interest";
+    case TransactionType::Debit:
+        return "debit";
+    case TransactionType::Credit:
+        return "credit";
+    }
+    return "unknown";
+}
+
+optional<TransactionType> parseTransactionTypeCode(string_view code)
+{
+    for (TransactionType type : TRANSACTION_TYPES)
+    {
+        if (code == transactionTypeCode(type))
+        {
+            return type;
+        }
+    }
+    return nullopt;
+}
+
+optional<Money> parseCsvAmount(string_view text)
+{
+    bool negative = !text.empty() && text[0] == '-';
+    if (!text.empty() && (text[0] == '-' || text[0] == '+'))
+    {
+        text.remove_prefix(1);
+    }
+    size_t point = text.find('.');
+    string_view units = text.substr(0, point);
+    string_view fraction = point == string_view::npos ? string_view() : text.substr(point + 1);
+    if ((units.empty() && fraction.empty()) || fraction.size() > 2)
+    {
+        return nullopt;
+    }
+    __int128 minor_units = 0;
+    for (char c : units)
+    {
+        if (c < '0' || c > '9' || minor_units > INT64_MAX)
+        {
+            return nullopt;
+        }
+        minor_units = minor_units * 10 + (c - '0');
+    }
+    for (size_t i = 0; i < 2; ++i)
+    {
+        char c = i < fraction.size() ? fraction[i] : '0';
+        if (c < '0' || c > '9')
+        {
+            return nullopt;
+        }
+        minor_units = minor_units * 10 + (c - '0');
+    }
+    if (minor_units > INT64_MAX)
+    {
+        return nullopt;
+    }
+    return Money::fromMinorUnits(static_cast<int64_t>(negative ? -minor_units : minor_units));
+}
+
+CsvImportResult importAccountsCsv(BankingSystem &bank, const string &path, unsigned num_threads)
+{
+    return importCsv<AccountRecord>(path, num_threads, parseAccountRow,
+                                    [&bank](span<const AccountRecord> records) { return bank.loadAccounts(records); });
+}
+
+CsvImportResult importTransactionsCsv(BankingSystem &bank, const string &path, unsigned num_threads)
+{
+    return importCsv<HistoryRecord>(path, num_threads, parseTransactionRow,
+                                    [&bank](span<const HistoryRecord> records) { return bank.loadHistory(records); });
+}
+
+bool exportCsv(BankingSystem &bank, const string &accounts_path, const string &transactions_path)
+{
+    return bank.withConsistentCut([&](span<const SnapshotEntry> entries, uint64_t) {
+        CsvWriter accounts_file(accounts_path);
+        accounts_file.text("account_number,owner,balance\n");
+        for (const SnapshotEntry &entry : entries)
+        {
+            accounts_file.integer(entry.account_number);
+            accounts_file.text(",");
+            accounts_file.field(entry.owner);
+            accounts_file.text(",");
+            accounts_file.amount(entry.balance);
+            accounts_file.text("\n");
+        }
+
+        CsvWriter transactions_file(transactions_path);
+        transactions_file.text("account_number,type,amount,counterparty,timestamp\n");
+        for (const SnapshotEntry &entry : entries)
+        {
+            entry.transactions->forEachRun(entry.num_transactions, [&](const Transaction *records, size_t n) {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    transactions_file.integer(entry.account_number);
+                    transactions_file.text(",");
+                    transactions_file.text(transactionTypeCode(records[i].type));
+                    transactions_file.text(",");
+                    transactions_file.amount(records[i].amount);
+                    transactions_file.text(",");
+                    if (records[i].counterparty != NO_COUNTERPARTY)
+                    {
+                        transactions_file.integer(records[i].counterparty);
+                    }
+                    transactions_file.text(",");
+                    transactions_file.integer(records[i].timestamp);
+                    transactions_file.text("\n");
+                }
+            });
+        }
+        return accounts_file.finish() && transactions_file.finish();
+    });
+}
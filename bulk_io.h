@@ -0,0 +1,52 @@
+#ifndef BULK_IO_H
+#define BULK_IO_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "banking_system.h"
+
+// Bulk loading and export of accounts and histories as CSV, for migrations. (Snapshots
+// are the binary form: writeSnapshot and loadSnapshot.) Two files, one row per line,
+// comma-separated, with an optional header line:
+//   accounts      account_number,owner,balance
+//   transactions  account_number,type,amount,counterparty,timestamp
+// Amounts are decimals with at most two places, e.g. 1500.25 or -3.5; types are the
+// names transactionTypeCode gives; the counterparty is empty for postings without one;
+// timestamps are seconds since the Unix epoch. Owners containing a comma, quote or line
+// break are quoted, with quotes doubled, as in RFC 4180. Lines may end in CRLF.
+//
+// Import maps the file, splits it into chunks at line boundaries and parses the chunks on
+// separate threads, finding field separators 64 bytes at a time with AVX2 when the CPU
+// has it. Parsed rows refer into the mapping rather than being copied, and are then
+// loaded with BankingSystem::loadAccounts or loadHistory, in file order.
+
+struct CsvImportResult
+{
+    bool ok = false;            // false if the file could not be read; nothing was loaded
+    std::size_t rows = 0;       // data rows, not counting a header or blank lines
+    std::size_t loaded = 0;     // accounts created or postings appended
+    std::size_t malformed = 0;  // rows that could not be parsed
+    std::size_t skipped = 0;    // well-formed rows the bank did not take, e.g. duplicate accounts
+    std::size_t first_malformed_line = 0; // 1-based, or 0 if every row parsed
+};
+
+// Short snake_case name used in CSV files, e.g. "transfer_out"
+const char *transactionTypeCode(TransactionType type);
+std::optional<TransactionType> parseTransactionTypeCode(std::string_view code);
+// Parses a decimal amount with at most two places exactly; nullopt if malformed or out of range
+std::optional<Money> parseCsvAmount(std::string_view text);
+
+// Loads accounts from a CSV file with num_threads parsing threads (0 picks one per core,
+// fewer for small files). Accounts already in the bank are skipped; see loadAccounts.
+CsvImportResult importAccountsCsv(BankingSystem &bank, const std::string &path, unsigned num_threads = 0);
+// Appends postings from a CSV file to the histories of existing accounts; see loadHistory
+CsvImportResult importTransactionsCsv(BankingSystem &bank, const std::string &path, unsigned num_threads = 0);
+// Writes every account and every history from one consistent cut of the bank, in a form
+// the two imports read back. Each file is written beside its path and renamed over it
+// once complete. Returns false on I/O errors.
+bool exportCsv(BankingSystem &bank, const std::string &accounts_path, const std::string &transactions_path);
+
+#endif /* BULK_IO_H */
@@ -0,0 +1,78 @@
+#include "checksum.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+constexpr array<uint32_t, 256> makeCrcTable()
+{
+    array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+constexpr array<uint32_t, 256> CRC_TABLE = makeCrcTable();
+
+uint32_t crc32cPortable(const unsigned char *data, size_t length, uint32_t crc)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc = (crc >> 8) ^ CRC_TABLE[(crc ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t crc32cHardware(const unsigned char *data, size_t length, uint32_t crc)
+{
+    uint64_t wide = crc;
+    for (; length >= 8; data += 8, length -= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = static_cast<uint32_t>(wide);
+    for (; length > 0; ++data, --length)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+bool detectSse42()
+{
+    // Static initializers can run before the runtime's own CPU detection
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+const bool HAS_SSE42 = detectSse42();
+#endif
+} // namespace
+
+uint32_t crc32c(const void *data, size_t length, uint32_t crc)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (HAS_SSE42)
+    {
+        return ~crc32cHardware(bytes, length, crc);
+    }
+#endif
+    return ~crc32cPortable(bytes, length, crc);
+}
@@ -0,0 +1,11 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli) of length bytes. Pass a previous result as crc to continue a
+// checksum across several buffers. Uses the SSE4.2 crc32 instruction when the CPU has it.
+uint32_t crc32c(const void *data, std::size_t length, uint32_t crc = 0);
+
+#endif /* CHECKSUM_H */
@@ -0,0 +1,77 @@
+#ifndef EPOCH_RECLAIMER_H
+#define EPOCH_RECLAIMER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+
+// Epoch-based reclamation of memory that readers may still be using after it has been
+// unlinked, such as the slots of deleted accounts or compacted history segments. A reader
+// pins the current epoch for as long as it holds on to what it found; retiring tags the
+// action that frees the memory with the epoch and moves the epoch on, and reclaim runs
+// it once every reader pinned at or before that epoch has unpinned, so readers
+// never wait for writers or the other way round. Pinning and retiring take a mutex,
+// which suits a few long-lived readers such as report views rather than every operation.
+class EpochReclaimer
+{
+public:
+    EpochReclaimer() = default;
+    EpochReclaimer(const EpochReclaimer &) = delete;
+    EpochReclaimer &operator=(const EpochReclaimer &) = delete;
+
+    // Returns the epoch to pass to unpin
+    uint64_t pin()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pins[epoch]++;
+        return epoch;
+    }
+    // Returns whether anything retired is waiting to be reclaimed
+    bool unpin(uint64_t pinned_epoch)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pins.find(pinned_epoch);
+        if (--it->second == 0)
+        {
+            pins.erase(it);
+        }
+        return !retired.empty();
+    }
+
+    void retire(std::function<void()> free)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        retired.emplace_back(epoch, std::move(free));
+        epoch++;
+    }
+    // Runs the free action of everything retired that no pinned reader can still reach,
+    // oldest first, and forgets them
+    void reclaim()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t oldest_pin = pins.empty() ? UINT64_MAX : pins.begin()->first;
+        while (!retired.empty() && retired.front().first < oldest_pin)
+        {
+            retired.front().second();
+            retired.pop_front();
+        }
+    }
+
+    std::size_t retiredCount() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return retired.size();
+    }
+
+private:
+    mutable std::mutex mutex;
+    uint64_t epoch = 1;
+    std::map<uint64_t, std::size_t> pins;                           // epoch -> readers pinned at it
+    std::deque<std::pair<uint64_t, std::function<void()>>> retired; // (epoch, free), oldest first
+};
+
+#endif /* EPOCH_RECLAIMER_H */
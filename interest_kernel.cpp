@@ -0,0 +1,223 @@
+#include "interest_kernel.h"
+
+#include <cstring>
+#include <optional>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "money.h"
+
+using namespace std;
+
+namespace
+{
+// Reference computation for one balance, used by the scalar kernel and for any lane
+// outside the range the vector kernels compute exactly
+int64_t scaleBalance(int64_t balance, int64_t rate)
+{
+    int64_t factor;
+    if (__builtin_add_overflow(RATE_SCALE, rate, &factor) || factor < 0)
+    {
+        return balance;
+    }
+    optional<Money> scaled = Money::fromMinorUnits(balance).checkedScale(factor, RATE_SCALE, RoundingMode::HalfEven);
+    return scaled ? scaled->minorUnits() : balance;
+}
+
+void accrueScalar(int64_t *balances, const uint8_t *tiers, size_t count, const RateTable &rates, int64_t *credited)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        int64_t balance = balances[i];
+        balances[i] = scaleBalance(balance, rates.rates[tiers[i]]);
+        credited[i] = balances[i] - balance;
+    }
+}
+
+#if defined(__x86_64__)
+// The vector kernels compute balance + rate * balance / RATE_SCALE in doubles. With
+// |balance| < 2^51 and |balance * rate| < 2^52 every intermediate is an integer below 2^53,
+// so the product, the floored quotient's remainder and the rounding decision are exact.
+constexpr int64_t EXACT_BALANCE_LIMIT = int64_t(1) << 51;
+constexpr double EXACT_PRODUCT_LIMIT = 4503599627370496.0; // 2^52
+// Adding 2^52 + 2^51 moves an integer below 2^51 in magnitude into the mantissa bits
+constexpr int64_t CONVERSION_MAGIC = 0x4338000000000000;
+
+__attribute__((target("avx2"))) void accrueAvx2(int64_t *balances, const uint8_t *tiers, size_t count,
+                                                 const RateTable &rates, const double *rates_d, int64_t *credited)
+{
+    const __m256i magic_i = _mm256_set1_epi64x(CONVERSION_MAGIC);
+    const __m256d magic_d = _mm256_castsi256_pd(magic_i);
+    const __m256i upper = _mm256_set1_epi64x(EXACT_BALANCE_LIMIT);
+    const __m256i lower = _mm256_set1_epi64x(-EXACT_BALANCE_LIMIT);
+    const __m256d product_limit = _mm256_set1_pd(EXACT_PRODUCT_LIMIT);
+    const __m256d scale = _mm256_set1_pd(static_cast<double>(RATE_SCALE));
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one_d = _mm256_set1_pd(1.0);
+    const __m256i one_i = _mm256_set1_epi64x(1);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i balance = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(balances + i));
+        int32_t tier_bytes;
+        memcpy(&tier_bytes, tiers + i, sizeof(tier_bytes));
+        __m256d rate = _mm256_mask_i32gather_pd(zero, rates_d, _mm_cvtepu8_epi32(_mm_cvtsi32_si128(tier_bytes)),
+                                                _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+
+        __m256i in_range = _mm256_and_si256(_mm256_cmpgt_epi64(balance, lower), _mm256_cmpgt_epi64(upper, balance));
+        __m256d balance_d = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(balance, magic_i)), magic_d);
+        __m256d product = _mm256_mul_pd(balance_d, rate);
+        __m256d small = _mm256_cmp_pd(_mm256_andnot_pd(sign, product), product_limit, _CMP_LT_OQ);
+        int exact = _mm256_movemask_pd(_mm256_and_pd(small, _mm256_castsi256_pd(in_range)));
+
+        // The quotient's floor can be one off either way; the remainder shows which
+        __m256d quotient = _mm256_floor_pd(_mm256_div_pd(product, scale));
+        __m256d remainder = _mm256_sub_pd(product, _mm256_mul_pd(quotient, scale));
+        __m256d low = _mm256_cmp_pd(remainder, zero, _CMP_LT_OQ);
+        quotient = _mm256_sub_pd(quotient, _mm256_and_pd(low, one_d));
+        remainder = _mm256_add_pd(remainder, _mm256_and_pd(low, scale));
+        __m256d high = _mm256_cmp_pd(remainder, scale, _CMP_GE_OQ);
+        quotient = _mm256_add_pd(quotient, _mm256_and_pd(high, one_d));
+        remainder = _mm256_sub_pd(remainder, _mm256_and_pd(high, scale));
+
+        __m256i truncated =
+            _mm256_add_epi64(balance, _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(quotient, magic_d)), magic_i));
+        __m256d twice_remainder = _mm256_add_pd(remainder, remainder);
+        __m256i above_half = _mm256_castpd_si256(_mm256_cmp_pd(twice_remainder, scale, _CMP_GT_OQ));
+        __m256i half = _mm256_castpd_si256(_mm256_cmp_pd(twice_remainder, scale, _CMP_EQ_OQ));
+        __m256i odd = _mm256_cmpeq_epi64(_mm256_and_si256(truncated, one_i), one_i);
+        // Masks are -1 where true, so subtracting rounds up
+        __m256i result = _mm256_sub_epi64(truncated, _mm256_or_si256(above_half, _mm256_and_si256(half, odd)));
+
+        alignas(32) int64_t original[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(original), balance);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(balances + i), result);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(credited + i), _mm256_sub_epi64(result, balance));
+        for (int lane = 0; exact != 0xF && lane < 4; ++lane)
+        {
+            if ((exact & (1 << lane)) == 0)
+            {
+                balances[i + lane] = scaleBalance(original[lane], rates.rates[tiers[i + lane]]);
+                credited[i + lane] = balances[i + lane] - original[lane];
+            }
+        }
+    }
+    accrueScalar(balances + i, tiers + i, count - i, rates, credited + i);
+}
+
+__attribute__((target("avx512f,avx512dq"))) void accrueAvx512(int64_t *balances, const uint8_t *tiers, size_t count,
+                                                               const RateTable &rates, const double *rates_d,
+                                                               int64_t *credited)
+{
+    const __m512i upper = _mm512_set1_epi64(EXACT_BALANCE_LIMIT);
+    const __m512i lower = _mm512_set1_epi64(-EXACT_BALANCE_LIMIT);
+    const __m512d product_limit = _mm512_set1_pd(EXACT_PRODUCT_LIMIT);
+    const __m512d scale = _mm512_set1_pd(static_cast<double>(RATE_SCALE));
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one_d = _mm512_set1_pd(1.0);
+    const __m512i one_i = _mm512_set1_epi64(1);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512i balance = _mm512_loadu_si512(balances + i);
+        __m256i tier_index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(tiers + i)));
+        __m512d rate = _mm512_mask_i32gather_pd(zero, 0xFF, tier_index, rates_d, 8);
+
+        __m512d product = _mm512_mul_pd(_mm512_cvtepi64_pd(balance), rate);
+        __mmask8 exact = _mm512_cmpgt_epi64_mask(balance, lower) & _mm512_cmpgt_epi64_mask(upper, balance) &
+                         _mm512_cmp_pd_mask(_mm512_abs_pd(product), product_limit, _CMP_LT_OQ);
+
+        // The quotient's floor can be one off either way; the remainder shows which
+        __m512d quotient = _mm512_floor_pd(_mm512_div_pd(product, scale));
+        __m512d remainder = _mm512_sub_pd(product, _mm512_mul_pd(quotient, scale));
+        __mmask8 low = _mm512_cmp_pd_mask(remainder, zero, _CMP_LT_OQ);
+        quotient = _mm512_mask_sub_pd(quotient, low, quotient, one_d);
+        remainder = _mm512_mask_add_pd(remainder, low, remainder, scale);
+        __mmask8 high = _mm512_cmp_pd_mask(remainder, scale, _CMP_GE_OQ);
+        quotient = _mm512_mask_add_pd(quotient, high, quotient, one_d);
+        remainder = _mm512_mask_sub_pd(remainder, high, remainder, scale);
+
+        __m512i truncated = _mm512_add_epi64(balance, _mm512_cvtpd_epi64(quotient));
+        __m512d twice_remainder = _mm512_add_pd(remainder, remainder);
+        __mmask8 round_up = _mm512_cmp_pd_mask(twice_remainder, scale, _CMP_GT_OQ) |
+                            (_mm512_cmp_pd_mask(twice_remainder, scale, _CMP_EQ_OQ) &
+                             _mm512_test_epi64_mask(truncated, one_i));
+        __m512i result = _mm512_mask_add_epi64(truncated, round_up, truncated, one_i);
+
+        alignas(64) int64_t original[8];
+        _mm512_store_si512(original, balance);
+        _mm512_storeu_si512(balances + i, result);
+        _mm512_storeu_si512(credited + i, _mm512_sub_epi64(result, balance));
+        for (int lane = 0; exact != 0xFF && lane < 8; ++lane)
+        {
+            if ((exact & (1 << lane)) == 0)
+            {
+                balances[i + lane] = scaleBalance(original[lane], rates.rates[tiers[i + lane]]);
+                credited[i + lane] = balances[i + lane] - original[lane];
+            }
+        }
+    }
+    accrueScalar(balances + i, tiers + i, count - i, rates, credited + i);
+}
+
+InterestKernel detectInterestKernel()
+{
+    // Static initializers can run before the runtime's own CPU detection
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+    {
+        return InterestKernel::Avx512;
+    }
+    return __builtin_cpu_supports("avx2") ? InterestKernel::Avx2 : InterestKernel::Scalar;
+}
+#else
+InterestKernel detectInterestKernel()
+{
+    return InterestKernel::Scalar;
+}
+#endif
+
+const InterestKernel BEST_KERNEL = detectInterestKernel();
+} // namespace
+
+InterestKernel bestInterestKernel()
+{
+    return BEST_KERNEL;
+}
+
+bool interestKernelSupported(InterestKernel kernel)
+{
+    return kernel == InterestKernel::Scalar || kernel == BEST_KERNEL ||
+           (kernel == InterestKernel::Avx2 && BEST_KERNEL == InterestKernel::Avx512);
+}
+
+void accrueInterest(int64_t *balances, const uint8_t *tiers, size_t count, const RateTable &rates,
+                    int64_t *credited, InterestKernel kernel)
+{
+#if defined(__x86_64__)
+    if (kernel != InterestKernel::Scalar)
+    {
+        double rates_d[NUM_RATE_TIERS];
+        for (size_t tier = 0; tier < NUM_RATE_TIERS; ++tier)
+        {
+            // A rate of 0 in its place leaves the balance as scaleBalance does
+            rates_d[tier] = rates.rates[tier] < -RATE_SCALE ? 0.0 : static_cast<double>(rates.rates[tier]);
+        }
+        if (kernel == InterestKernel::Avx512)
+        {
+            accrueAvx512(balances, tiers, count, rates, rates_d, credited);
+        }
+        else
+        {
+            accrueAvx2(balances, tiers, count, rates, rates_d, credited);
+        }
+        return;
+    }
+#endif
+    accrueScalar(balances, tiers, count, rates, credited);
+}
@@ -0,0 +1,47 @@
+#ifndef INTEREST_KERNEL_H
+#define INTEREST_KERNEL_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Interest rates are applied in parts per billion
+constexpr int64_t RATE_SCALE = 1000000000;
+constexpr std::size_t NUM_RATE_TIERS = 256;
+// Range of a rate, as a fraction. Below -1 the factor 1 + rate is negative and would flip
+// the sign of every balance; the top is far past any real rate
+constexpr double MIN_INTEREST_RATE = -1.0;
+constexpr double MAX_INTEREST_RATE = 10.0;
+
+inline bool validInterestRate(double rate)
+{
+    return std::isfinite(rate) && rate >= MIN_INTEREST_RATE && rate <= MAX_INTEREST_RATE;
+}
+
+// Per-tier rates in parts per billion, indexed by an account's rate tier
+struct RateTable
+{
+    int64_t rates[NUM_RATE_TIERS];
+};
+
+enum class InterestKernel
+{
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
+// Fastest kernel the CPU supports
+InterestKernel bestInterestKernel();
+bool interestKernelSupported(InterestKernel kernel);
+
+// Multiplies balances[i] by (RATE_SCALE + rates[tiers[i]]) / RATE_SCALE, rounding half to
+// even, and stores the change in credited[i]. A balance that would overflow, or that a
+// rate below -RATE_SCALE would flip the sign of, is left as it is with nothing credited.
+// Every kernel gives exactly Money::checkedScale's result:
+// lanes are computed in double precision only when the product is small enough to be
+// exact, and fall back to 128-bit integer arithmetic otherwise.
+void accrueInterest(int64_t *balances, const uint8_t *tiers, std::size_t count, const RateTable &rates,
+                    int64_t *credited, InterestKernel kernel = bestInterestKernel());
+
+#endif /* INTEREST_KERNEL_H */
@@ -0,0 +1,442 @@
+#include "journal.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "checksum.h"
+
+using namespace std;
+
+namespace
+{
+constexpr char MAGIC[8] = {'B', 'A', 'N', 'K', 'J', 'N', 'L', '1'};
+constexpr size_t HEADER_SIZE = 12;
+constexpr size_t LEG_SIZE = 12;
+// Every record is built in one stack buffer sized for the longest owner name
+constexpr size_t MAX_PAYLOAD_LENGTH = 14 + MAX_OWNER_LENGTH;
+static_assert(2 + MAX_JOURNAL_LEGS * LEG_SIZE <= MAX_PAYLOAD_LENGTH, "MultiLeg records must fit the record buffer");
+
+// Header layout: crc (4 bytes), payload length (2), type (1), reserved (1), timestamp (4).
+// The CRC covers everything after itself, so a torn header is caught as well.
+struct RecordHeader
+{
+    uint32_t crc;
+    uint16_t length;
+    JournalRecordType type;
+    uint8_t reserved;
+    uint32_t timestamp;
+};
+static_assert(sizeof(RecordHeader) == HEADER_SIZE, "RecordHeader must match the on-disk layout");
+
+template <typename T>
+void put(char *&out, T value)
+{
+    memcpy(out, &value, sizeof(value));
+    out += sizeof(value);
+}
+
+template <typename T>
+T get(const char *&in)
+{
+    T value;
+    memcpy(&value, in, sizeof(value));
+    in += sizeof(value);
+    return value;
+}
+
+bool writeAll(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool decode(JournalRecordType type, const char *payload, size_t length, JournalRecord &record)
+{
+    const char *in = payload;
+    switch (type)
+    {
+    case JournalRecordType::CreateAccount:
+    {
+        if (length < 14)
+        {
+            return false;
+        }
+        record.account_number = get<int32_t>(in);
+        record.amount = Money::fromMinorUnits(get<int64_t>(in));
+        uint16_t owner_length = get<uint16_t>(in);
+        if (length != 14u + owner_length)
+        {
+            return false;
+        }
+        record.owner.assign(in, owner_length);
+        return true;
+    }
+    case JournalRecordType::DeleteAccount:
+        if (length != 4)
+        {
+            return false;
+        }
+        record.account_number = get<int32_t>(in);
+        return true;
+    case JournalRecordType::Deposit:
+    case JournalRecordType::Withdrawal:
+    case JournalRecordType::Interest:
+        if (length != 12)
+        {
+            return false;
+        }
+        record.account_number = get<int32_t>(in);
+        record.amount = Money::fromMinorUnits(get<int64_t>(in));
+        return true;
+    case JournalRecordType::Transfer:
+        if (length != 16)
+        {
+            return false;
+        }
+        record.account_number = get<int32_t>(in);
+        record.to_account_number = get<int32_t>(in);
+        record.amount = Money::fromMinorUnits(get<int64_t>(in));
+        return true;
+    case JournalRecordType::MultiLeg:
+    {
+        if (length < 2)
+        {
+            return false;
+        }
+        uint16_t num_legs = get<uint16_t>(in);
+        if (num_legs > MAX_JOURNAL_LEGS || length != 2 + num_legs * LEG_SIZE)
+        {
+            return false;
+        }
+        record.legs.resize(num_legs);
+        for (JournalLeg &leg : record.legs)
+        {
+            leg.account_number = get<int32_t>(in);
+            leg.amount = Money::fromMinorUnits(get<int64_t>(in));
+        }
+        return true;
+    }
+    }
+    return false;
+}
+} // namespace
+
+unique_ptr<Journal> Journal::open(const string &path, CommitMode mode)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    uint64_t end_position = static_cast<uint64_t>(status.st_size);
+    if (end_position == 0)
+    {
+        if (!writeAll(fd, MAGIC, sizeof(MAGIC)) || fdatasync(fd) != 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        end_position = sizeof(MAGIC);
+    }
+    else
+    {
+        char magic[sizeof(MAGIC)];
+        if (pread(fd, magic, sizeof(magic), 0) != static_cast<ssize_t>(sizeof(magic)) ||
+            memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+    }
+    return unique_ptr<Journal>(new Journal(fd, end_position, mode));
+}
+
+optional<size_t> Journal::replay(const string &path, const function<void(const JournalRecord &)> &f,
+                                 uint64_t from_position)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    struct stat status;
+    vector<char> contents;
+    if (fstat(fd, &status) == 0)
+    {
+        contents.resize(static_cast<size_t>(status.st_size));
+    }
+    size_t loaded = 0;
+    while (loaded < contents.size())
+    {
+        ssize_t n = pread(fd, contents.data() + loaded, contents.size() - loaded, static_cast<off_t>(loaded));
+        if (n <= 0)
+        {
+            break;
+        }
+        loaded += static_cast<size_t>(n);
+    }
+    contents.resize(loaded);
+    if (contents.size() < sizeof(MAGIC) || memcmp(contents.data(), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        ::close(fd);
+        return 0;
+    }
+
+    size_t num_records = 0;
+    size_t offset = sizeof(MAGIC);
+    JournalRecord record;
+    while (contents.size() - offset >= HEADER_SIZE)
+    {
+        RecordHeader header;
+        memcpy(&header, contents.data() + offset, HEADER_SIZE);
+        if (contents.size() - offset - HEADER_SIZE < header.length ||
+            crc32c(contents.data() + offset + sizeof(uint32_t), HEADER_SIZE - sizeof(uint32_t) + header.length) !=
+                header.crc)
+        {
+            break;
+        }
+        record = JournalRecord{header.type, header.timestamp, 0, 0, Money(), string(), {}};
+        if (!decode(header.type, contents.data() + offset + HEADER_SIZE, header.length, record))
+        {
+            // Written whole by some writer, so truncating here would destroy good records
+            ::close(fd);
+            return nullopt;
+        }
+        offset += HEADER_SIZE + header.length;
+        if (offset > from_position)
+        {
+            f(record);
+            num_records++;
+        }
+    }
+
+    // Drop the torn tail left by a crash mid-write
+    if (offset < contents.size())
+    {
+        if (ftruncate(fd, static_cast<off_t>(offset)) == 0)
+        {
+            fdatasync(fd);
+        }
+    }
+    ::close(fd);
+    return num_records;
+}
+
+Journal::Journal(int fd, uint64_t end_position, CommitMode mode)
+    : fd(fd), mode(mode), appended_position(end_position), stopping(false), failed(false),
+      durable_position(end_position), num_syncs(0)
+{
+    flusher = thread(&Journal::flushLoop, this);
+}
+
+Journal::~Journal()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_one();
+    flusher.join();
+    ::close(fd);
+}
+
+uint64_t Journal::append(JournalRecordType type, uint32_t timestamp, const void *payload, size_t length)
+{
+    char record[HEADER_SIZE + MAX_PAYLOAD_LENGTH];
+    RecordHeader header{0, static_cast<uint16_t>(length), type, 0, timestamp};
+    memcpy(record, &header, HEADER_SIZE);
+    memcpy(record + HEADER_SIZE, payload, length);
+    header.crc = crc32c(record + sizeof(uint32_t), HEADER_SIZE - sizeof(uint32_t) + length);
+    memcpy(record, &header.crc, sizeof(uint32_t));
+
+    uint64_t position;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        pending.insert(pending.end(), record, record + HEADER_SIZE + length);
+        appended_position += HEADER_SIZE + length;
+        position = appended_position;
+    }
+    work_ready.notify_one();
+    return position;
+}
+
+uint64_t Journal::appendCreateAccount(int account_number, string_view owner, Money initial_balance)
+{
+    char payload[MAX_PAYLOAD_LENGTH];
+    char *out = payload;
+    // createAccount refuses longer owners; the clamp only guards the buffer
+    uint16_t owner_length = static_cast<uint16_t>(min(owner.size(), MAX_OWNER_LENGTH));
+    put<int32_t>(out, account_number);
+    put<int64_t>(out, initial_balance.minorUnits());
+    put<uint16_t>(out, owner_length);
+    memcpy(out, owner.data(), owner_length);
+    return append(JournalRecordType::CreateAccount, 0, payload, 14u + owner_length);
+}
+
+uint64_t Journal::appendDeleteAccount(int account_number)
+{
+    char payload[4];
+    char *out = payload;
+    put<int32_t>(out, account_number);
+    return append(JournalRecordType::DeleteAccount, 0, payload, sizeof(payload));
+}
+
+uint64_t Journal::appendDeposit(int account_number, Money amount, uint32_t timestamp)
+{
+    char payload[12];
+    char *out = payload;
+    put<int32_t>(out, account_number);
+    put<int64_t>(out, amount.minorUnits());
+    return append(JournalRecordType::Deposit, timestamp, payload, sizeof(payload));
+}
+
+uint64_t Journal::appendWithdrawal(int account_number, Money amount, uint32_t timestamp)
+{
+    char payload[12];
+    char *out = payload;
+    put<int32_t>(out, account_number);
+    put<int64_t>(out, amount.minorUnits());
+    return append(JournalRecordType::Withdrawal, timestamp, payload, sizeof(payload));
+}
+
+uint64_t Journal::appendTransfer(int from_account_number, int to_account_number, Money amount, uint32_t timestamp)
+{
+    char payload[16];
+    char *out = payload;
+    put<int32_t>(out, from_account_number);
+    put<int32_t>(out, to_account_number);
+    put<int64_t>(out, amount.minorUnits());
+    return append(JournalRecordType::Transfer, timestamp, payload, sizeof(payload));
+}
+
+uint64_t Journal::appendInterest(int account_number, Money credited, uint32_t timestamp)
+{
+    char payload[12];
+    char *out = payload;
+    put<int32_t>(out, account_number);
+    put<int64_t>(out, credited.minorUnits());
+    return append(JournalRecordType::Interest, timestamp, payload, sizeof(payload));
+}
+
+uint64_t Journal::appendLegs(span<const JournalLeg> legs, uint32_t timestamp)
+{
+    char payload[MAX_PAYLOAD_LENGTH];
+    char *out = payload;
+    uint16_t num_legs = static_cast<uint16_t>(min(legs.size(), MAX_JOURNAL_LEGS));
+    put<uint16_t>(out, num_legs);
+    for (size_t i = 0; i < num_legs; ++i)
+    {
+        put<int32_t>(out, legs[i].account_number);
+        put<int64_t>(out, legs[i].amount.minorUnits());
+    }
+    return append(JournalRecordType::MultiLeg, timestamp, payload, 2 + num_legs * LEG_SIZE);
+}
+
+uint64_t Journal::endPosition()
+{
+    lock_guard<std::mutex> lock(mutex);
+    return appended_position;
+}
+
+bool Journal::waitDurable(uint64_t position)
+{
+    if (durable_position.load(memory_order_acquire) >= position)
+    {
+        return true;
+    }
+    unique_lock<std::mutex> lock(mutex);
+    durable_advanced.wait(lock, [this, position] {
+        return failed || durable_position.load(memory_order_relaxed) >= position;
+    });
+    return durable_position.load(memory_order_relaxed) >= position;
+}
+
+void Journal::whenDurable(uint64_t position, function<void(bool)> on_durable)
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (!failed && durable_position.load(memory_order_relaxed) < position)
+        {
+            durable_callbacks.emplace(position, move(on_durable));
+            return;
+        }
+    }
+    on_durable(durable_position.load(memory_order_acquire) >= position);
+}
+
+void Journal::flushLoop()
+{
+    vector<char> writing;
+    vector<function<void(bool)>> callbacks;
+    unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        work_ready.wait(lock, [this] { return !pending.empty() || stopping; });
+        if (pending.empty())
+        {
+            break;
+        }
+        // Everything that queued up during the previous sync goes out in this one
+        swap(pending, writing);
+        uint64_t target = appended_position;
+        lock.unlock();
+
+        bool ok = !failed && writeAll(fd, writing.data(), writing.size()) && fdatasync(fd) == 0;
+        num_syncs.fetch_add(1, memory_order_relaxed);
+        writing.clear();
+
+        lock.lock();
+        if (ok)
+        {
+            durable_position.store(target, memory_order_release);
+        }
+        else
+        {
+            failed = true;
+        }
+        durable_advanced.notify_all();
+
+        // Every callback is due once writing has failed
+        auto due = failed ? durable_callbacks.end() : durable_callbacks.upper_bound(target);
+        for (auto callback = durable_callbacks.begin(); callback != due; ++callback)
+        {
+            callbacks.push_back(move(callback->second));
+        }
+        durable_callbacks.erase(durable_callbacks.begin(), due);
+        if (!callbacks.empty())
+        {
+            lock.unlock();
+            for (function<void(bool)> &callback : callbacks)
+            {
+                callback(ok);
+            }
+            callbacks.clear();
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "money.h"
+
+enum class JournalRecordType : uint8_t
+{
+    CreateAccount = 1,
+    DeleteAccount,
+    Deposit,
+    Withdrawal,
+    Transfer,
+    Interest, // amount is the interest credited (negative for a negative rate)
+    MultiLeg, // every leg of one multi-account transaction, applied together
+};
+
+// Most legs one MultiLeg record can hold
+constexpr std::size_t MAX_JOURNAL_LEGS = 64;
+// Longest owner name a CreateAccount record holds; createAccount refuses longer ones
+constexpr std::size_t MAX_OWNER_LENGTH = 1024;
+
+// One account's share of a multi-account transaction: positive amounts are credits,
+// negative amounts debits
+struct JournalLeg
+{
+    int32_t account_number;
+    Money amount;
+};
+
+// One decoded journal record; fields a record type does not use are zero
+struct JournalRecord
+{
+    JournalRecordType type;
+    uint32_t timestamp;
+    int32_t account_number;
+    int32_t to_account_number;
+    Money amount;
+    std::string owner;
+    std::vector<JournalLeg> legs; // MultiLeg only
+};
+
+// Whether operations wait for their journal record to reach the disk before returning
+enum class CommitMode
+{
+    Synchronous, // durable on return; concurrent callers share one fsync (group commit)
+    Background,  // returns at once; the flusher makes the record durable shortly after
+};
+
+// Write-ahead journal of every change to a BankingSystem.
+// The file is an 8-byte magic number followed by records, each a 12-byte header
+// (CRC-32C of the rest of the record, payload length, type, timestamp) and a small
+// fixed-layout payload. Records describe applied changes rather than requests, so
+// replay never has to re-run a funds check.
+//
+// Appending only copies the record into an in-memory buffer. A flusher thread writes
+// whatever has accumulated and fdatasyncs it, so every transaction that arrives while
+// one sync is in progress is made durable by the next one.
+class Journal
+{
+public:
+    // Opens path for appending, creating it if needed; returns null if the file cannot be
+    // opened or is not a journal. Run replay first if the file may hold records.
+    static std::unique_ptr<Journal> open(const std::string &path, CommitMode mode = CommitMode::Synchronous);
+    // Calls f for every intact record that ends after from_position, in order, and returns
+    // the number of records passed to f. Replay stops at the first torn or corrupt record,
+    // and the file is truncated there so later appends follow the last good record.
+    // A record with a good checksum that this version cannot decode, such as one of an
+    // unknown type, is not a torn write: replay then returns nullopt and leaves the file
+    // as it is, and the journal must not be opened for appending.
+    static std::optional<std::size_t> replay(const std::string &path, const std::function<void(const JournalRecord &)> &f,
+                              uint64_t from_position = 0);
+
+    // Makes everything appended so far durable, then closes the file
+    ~Journal();
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    // Each append returns the journal position just past its record, for waitDurable
+    uint64_t appendCreateAccount(int account_number, std::string_view owner, Money initial_balance);
+    uint64_t appendDeleteAccount(int account_number);
+    uint64_t appendDeposit(int account_number, Money amount, uint32_t timestamp);
+    uint64_t appendWithdrawal(int account_number, Money amount, uint32_t timestamp);
+    uint64_t appendTransfer(int from_account_number, int to_account_number, Money amount, uint32_t timestamp);
+    uint64_t appendInterest(int account_number, Money credited, uint32_t timestamp);
+    // Writes every leg as a single record, so replay applies all of them or none
+    uint64_t appendLegs(std::span<const JournalLeg> legs, uint32_t timestamp);
+
+    // Blocks until everything up to position is on disk; returns false if writing failed
+    bool waitDurable(uint64_t position);
+    // Calls on_durable(true) once everything up to position is on disk, or on_durable(false)
+    // if writing fails first. Runs it at once if that is already decided, and otherwise on
+    // the flusher thread, which it holds up, so it should only hand the news on.
+    void whenDurable(uint64_t position, std::function<void(bool)> on_durable);
+
+    CommitMode commitMode() const { return mode; }
+    // Journal position just past the last record appended so far
+    uint64_t endPosition();
+    uint64_t durablePosition() const { return durable_position.load(std::memory_order_acquire); }
+    std::size_t syncCount() const { return num_syncs.load(std::memory_order_relaxed); }
+
+private:
+    Journal(int fd, uint64_t end_position, CommitMode mode);
+
+    uint64_t append(JournalRecordType type, uint32_t timestamp, const void *payload, std::size_t length);
+    void flushLoop();
+
+    int fd;
+    CommitMode mode;
+    std::thread flusher;
+
+    std::mutex mutex;
+    std::condition_variable work_ready;       // records are waiting to be written
+    std::condition_variable durable_advanced; // durable_position moved or writing failed
+    std::vector<char> pending;                // appended but not yet handed to the flusher
+    uint64_t appended_position;               // journal position at the end of pending
+    bool stopping;
+    bool failed;
+    std::multimap<uint64_t, std::function<void(bool)>> durable_callbacks; // by position
+
+    std::atomic<uint64_t> durable_position;
+    std::atomic<std::size_t> num_syncs;
+};
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,270 @@
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bank_client.h"
+#include "bank_server.h"
+#include "metrics.h"
+#include "workload.h"
+
+using namespace std;
+
+// Load generator for BankServer. Each connection runs on its own thread and keeps up to
+// --depth requests in flight, topping the window up whenever half of it has been
+// answered, so requests go out and responses come back in batches. Postings follow the
+// Zipf-skewed mix of generateWorkload. Prints throughput and latency percentiles, where a
+// request's latency runs from the flush that sent it to the arrival of its response.
+
+namespace
+{
+struct Options
+{
+    string address = "127.0.0.1:7878";
+    size_t connections = 4;
+    size_t depth = 32;
+    double seconds = 5.0;
+    int accounts = 10000;
+    double skew = 0.0;
+    int balance_percent = 10; // share of requests that are balance reads
+    bool embedded = false;    // start a server in this process instead of connecting to one
+    size_t server_threads = 0;
+};
+
+struct ConnectionResult
+{
+    bool ok = true;
+    uint64_t requests = 0;
+    uint64_t rejected = 0;
+    LatencyHistogram latency; // nanoseconds
+};
+
+void usage()
+{
+    cerr << "usage: banking_loadgen [--address host:port|unix:path] [--connections N] [--depth N]\n"
+            "                       [--seconds S] [--accounts N] [--skew Z] [--balance-percent P]\n"
+            "                       [--embedded [--server-threads N]]\n";
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        string name = argv[i];
+        if (name == "--embedded")
+        {
+            options.embedded = true;
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            return false;
+        }
+        const char *value = argv[++i];
+        if (name == "--address")
+        {
+            options.address = value;
+        }
+        else if (name == "--connections")
+        {
+            options.connections = strtoul(value, nullptr, 10);
+        }
+        else if (name == "--depth")
+        {
+            options.depth = strtoul(value, nullptr, 10);
+        }
+        else if (name == "--seconds")
+        {
+            options.seconds = strtod(value, nullptr);
+        }
+        else if (name == "--accounts")
+        {
+            options.accounts = atoi(value);
+        }
+        else if (name == "--skew")
+        {
+            options.skew = strtod(value, nullptr);
+        }
+        else if (name == "--balance-percent")
+        {
+            options.balance_percent = atoi(value);
+        }
+        else if (name == "--server-threads")
+        {
+            options.server_threads = strtoul(value, nullptr, 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return options.connections > 0 && options.depth > 0 && options.accounts > 0 && options.seconds > 0 &&
+           options.balance_percent >= 0 && options.balance_percent <= 100;
+}
+
+// Opens every account the workload uses, pipelining the whole set; accounts left by an
+// earlier run are kept
+bool createAccounts(const string &address, int num_accounts)
+{
+    unique_ptr<BankClient> client = BankClient::connect(address);
+    if (!client)
+    {
+        return false;
+    }
+    for (int i = 0; i < num_accounts; ++i)
+    {
+        Request request;
+        request.opcode = RequestOpcode::CreateAccount;
+        request.account_number = i;
+        request.amount = Money::fromUnits(1000000);
+        request.owner = "loadgen";
+        client->send(request);
+    }
+    while (client->inFlight() > 0)
+    {
+        optional<Response> response = client->receive();
+        if (!response || (response->status != Status::Ok && response->status != Status::AccountExists))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void runConnection(const Options &options, size_t index, chrono::steady_clock::time_point deadline,
+                   ConnectionResult &result)
+{
+    using namespace chrono;
+    unique_ptr<BankClient> client = BankClient::connect(options.address);
+    if (!client)
+    {
+        result.ok = false;
+        return;
+    }
+    vector<Operation> workload = generateWorkload(1 << 16, 0, options.accounts, options.skew, WorkloadMix(), index + 1);
+    size_t next = 0;
+    deque<steady_clock::time_point> sent_at; // of the requests in flight, oldest first
+
+    auto topUp = [&]
+    {
+        while (client->inFlight() < options.depth)
+        {
+            const Operation &operation = workload[next++ % workload.size()];
+            Request request;
+            request.opcode = RequestOpcode::Balance;
+            request.account_number = operation.account_number;
+            // balance_percent requests in every hundred read a balance instead of posting
+            if (static_cast<int>(next % 100) >= options.balance_percent)
+            {
+                request.opcode = operation.type == OperationType::Deposit      ? RequestOpcode::Deposit
+                                 : operation.type == OperationType::Withdrawal ? RequestOpcode::Withdraw
+                                                                               : RequestOpcode::Transfer;
+                request.to_account_number = operation.to_account_number;
+                request.amount = operation.amount;
+            }
+            client->send(request);
+        }
+        steady_clock::time_point now = steady_clock::now();
+        sent_at.resize(client->inFlight(), now);
+        return client->flush();
+    };
+
+    bool sending = topUp();
+    while (sending || client->inFlight() > 0)
+    {
+        optional<Response> response = client->receive();
+        if (!response)
+        {
+            result.ok = false;
+            return;
+        }
+        steady_clock::time_point now = steady_clock::now();
+        result.latency.record(static_cast<uint64_t>(duration_cast<nanoseconds>(now - sent_at.front()).count()));
+        result.requests++;
+        result.rejected += response->status != Status::Ok;
+        sent_at.pop_front();
+        if (now >= deadline)
+        {
+            sending = false;
+        }
+        else if (client->inFlight() <= options.depth / 2 && !topUp())
+        {
+            result.ok = false;
+            return;
+        }
+    }
+}
+
+long long toMicroseconds(uint64_t nanoseconds)
+{
+    return static_cast<long long>(nanoseconds / 1000);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        usage();
+        return 2;
+    }
+
+    BankingSystem bank;
+    unique_ptr<BankServer> server;
+    if (options.embedded)
+    {
+        server = BankServer::start(bank, "127.0.0.1:0", options.server_threads);
+        if (!server)
+        {
+            cerr << "Could not start the embedded server\n";
+            return 1;
+        }
+        options.address = "127.0.0.1:" + to_string(server->port());
+    }
+    if (!createAccounts(options.address, options.accounts))
+    {
+        cerr << "Could not open accounts on " << options.address << '\n';
+        return 1;
+    }
+
+    using namespace chrono;
+    vector<ConnectionResult> results(options.connections);
+    vector<thread> threads;
+    steady_clock::time_point start = steady_clock::now();
+    steady_clock::time_point deadline = start + duration_cast<steady_clock::duration>(duration<double>(options.seconds));
+    for (size_t i = 0; i < options.connections; ++i)
+    {
+        threads.emplace_back(runConnection, cref(options), i, deadline, ref(results[i]));
+    }
+    for (thread &connection_thread : threads)
+    {
+        connection_thread.join();
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    ConnectionResult total;
+    for (const ConnectionResult &result : results)
+    {
+        total.ok = total.ok && result.ok;
+        total.requests += result.requests;
+        total.rejected += result.rejected;
+        total.latency.merge(result.latency);
+    }
+    if (!total.ok)
+    {
+        cerr << "A connection to " << options.address << " failed\n";
+        return 1;
+    }
+    cout << total.requests << " requests in " << elapsed << " s over " << options.connections
+         << " connections, depth " << options.depth << ": " << static_cast<long long>(total.requests / elapsed)
+         << " requests/s, " << total.rejected << " rejected\n"
+         << "latency us: p50 " << toMicroseconds(total.latency.percentile(0.5)) << " p99 "
+         << toMicroseconds(total.latency.percentile(0.99)) << " p999 " << toMicroseconds(total.latency.percentile(0.999))
+         << " max " << toMicroseconds(total.latency.maximum) << '\n';
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "log_sink.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <ostream>
+
+using namespace std;
+
+void StreamLogSink::write(string_view message)
+{
+    lock_guard<std::mutex> lock(mutex);
+    out << message << endl;
+}
+
+AsyncLogSink::AsyncLogSink(ostream &out, size_t capacity)
+    : out(out), mask(bit_ceil(max<size_t>(capacity, 2)) - 1), slots(new Slot[mask + 1]), enqueue_position(0),
+      dequeue_position(0), num_dropped(0), stopping(false)
+{
+    for (size_t i = 0; i <= mask; ++i)
+    {
+        slots[i].sequence.store(i, memory_order_relaxed);
+    }
+    drainer = thread(&AsyncLogSink::drain, this);
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+    stopping.store(true, memory_order_release);
+    wake.notify_one();
+    drainer.join();
+}
+
+void AsyncLogSink::write(string_view message)
+{
+    // Bounded multi-producer queue: a slot is free for position p when its sequence is p
+    uint64_t position = enqueue_position.load(memory_order_relaxed);
+    Slot *slot;
+    while (true)
+    {
+        slot = &slots[position & mask];
+        uint64_t sequence = slot->sequence.load(memory_order_acquire);
+        if (sequence == position)
+        {
+            if (enqueue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (sequence < position)
+        {
+            // The drainer has not freed this slot yet, so the ring is full
+            num_dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            position = enqueue_position.load(memory_order_relaxed);
+        }
+    }
+
+    size_t length = min(message.size(), MAX_MESSAGE_LENGTH);
+    memcpy(slot->text, message.data(), length);
+    slot->length = static_cast<uint8_t>(length);
+    slot->sequence.store(position + 1, memory_order_release);
+
+    // Writers only signal the drainer when the ring is filling up; otherwise it picks the
+    // message up on its next periodic wake-up
+    if (position - dequeue_position.load(memory_order_relaxed) == (mask + 1) / 2)
+    {
+        wake.notify_one();
+    }
+}
+
+bool AsyncLogSink::messageReady(uint64_t position) const
+{
+    return slots[position & mask].sequence.load(memory_order_acquire) == position + 1;
+}
+
+bool AsyncLogSink::writeReady()
+{
+    bool wrote = false;
+    uint64_t position = dequeue_position.load(memory_order_relaxed);
+    while (true)
+    {
+        if (!messageReady(position))
+        {
+            break;
+        }
+        Slot &slot = slots[position & mask];
+        out.write(slot.text, slot.length);
+        out.put('\n');
+        slot.sequence.store(position + mask + 1, memory_order_release);
+        dequeue_position.store(++position, memory_order_release);
+        wrote = true;
+    }
+    return wrote;
+}
+
+void AsyncLogSink::drain()
+{
+    while (true)
+    {
+        if (writeReady())
+        {
+            continue;
+        }
+        // Only flush the stream once the queue is empty, so a burst costs one flush
+        out.flush();
+        if (stopping.load(memory_order_acquire))
+        {
+            break;
+        }
+        unique_lock<std::mutex> lock(wake_mutex);
+        wake.wait_for(lock, DRAIN_INTERVAL);
+    }
+    // Messages written just before the destructor ran
+    writeReady();
+    out.flush();
+}
+
+void AsyncLogSink::flush()
+{
+    uint64_t target = enqueue_position.load(memory_order_acquire);
+    while (dequeue_position.load(memory_order_acquire) < target)
+    {
+        this_thread::yield();
+    }
+}
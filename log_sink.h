@@ -0,0 +1,86 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+// Destination for the human-readable messages produced by BankingSystem
+class LogSink
+{
+public:
+    virtual ~LogSink() = default;
+    // Called with one message (without a trailing newline); may be called from any thread
+    virtual void write(std::string_view message) = 0;
+};
+
+// Writes and flushes every message on the calling thread, one per line
+class StreamLogSink : public LogSink
+{
+public:
+    explicit StreamLogSink(std::ostream &out) : out(out) {}
+
+    void write(std::string_view message) override;
+
+private:
+    std::mutex mutex;
+    std::ostream &out;
+};
+
+// Copies messages into a bounded ring buffer that a background thread drains to a stream,
+// so writers never block on I/O. The drainer wakes every DRAIN_INTERVAL, or early once the
+// ring is half full, and flushes the stream once per burst. When the ring is full new
+// messages are dropped and counted rather than making the writer wait. Messages longer
+// than MAX_MESSAGE_LENGTH are truncated.
+class AsyncLogSink : public LogSink
+{
+public:
+    static constexpr std::size_t MAX_MESSAGE_LENGTH = 120;
+    static constexpr std::chrono::milliseconds DRAIN_INTERVAL{1};
+
+    // capacity is rounded up to a power of two
+    explicit AsyncLogSink(std::ostream &out, std::size_t capacity = 4096);
+    // Writes out everything already queued before returning
+    ~AsyncLogSink() override;
+    AsyncLogSink(const AsyncLogSink &) = delete;
+    AsyncLogSink &operator=(const AsyncLogSink &) = delete;
+
+    void write(std::string_view message) override;
+    // Waits until every message queued so far has been handed to the stream
+    void flush();
+
+    std::size_t dropped() const { return num_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence; // position this slot expects next; +1 once it holds a message
+        uint8_t length;
+        char text[MAX_MESSAGE_LENGTH];
+    };
+
+    void drain();
+    bool messageReady(uint64_t position) const;
+    // Writes every message that is ready; returns false if there was none
+    bool writeReady();
+
+    std::ostream &out;
+    std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<uint64_t> enqueue_position;
+    alignas(64) std::atomic<uint64_t> dequeue_position; // only advanced by the drainer
+    std::mutex wake_mutex;
+    std::condition_variable wake; // signalled when the ring is half full or the sink is closing
+    std::atomic<std::size_t> num_dropped;
+    std::atomic<bool> stopping;
+    std::thread drainer;
+};
+
+#endif /* LOG_SINK_H */
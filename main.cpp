@@ -0,0 +1,37 @@
+#include <iostream>
+
+#include "banking_system.h"
+#include "log_sink.h"
+
+using namespace std;
+
+int main()
+{
+    BankingSystem bank;
+    StreamLogSink console(cout);
+    bank.setLogSink(&console);
+
+    // Creating accounts
+    bank.createAccount(1001, "Alice", Money::fromUnits(5000));
+    bank.createAccount(1002, "Bob", Money::fromUnits(3000));
+
+    // Performing transactions
+    bank.deposit(1001, Money::fromUnits(1000));
+    bank.withdraw(1002, Money::fromUnits(500));
+    bank.transfer(1001, 1002, Money::fromUnits(200));
+
+    // Displaying account details
+    bank.displayAccountDetails(1001);
+    bank.displayAccountDetails(1002);
+
+    // Displaying all accounts
+    bank.displayAllAccounts();
+
+    // Searching accounts by owner name
+    bank.searchAccountsByOwner("Alice");
+
+    // Deleting an account
+    bank.deleteAccount(1002);
+
+    return 0;
+}
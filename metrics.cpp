@@ -0,0 +1,300 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <ostream>
+
+using namespace std;
+
+namespace
+{
+struct Percentile
+{
+    const char *name;
+    double fraction;
+};
+
+constexpr Percentile REPORTED_PERCENTILES[] = {{"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999}};
+
+uint64_t bucketEnd(size_t bucket)
+{
+    return bucket + 1 < LatencyHistogram::NUM_BUCKETS ? LatencyHistogram::bucketStart(bucket + 1) - 1 : UINT64_MAX;
+}
+
+long long toNanoseconds(uint64_t ticks, const MetricsSnapshot &snapshot)
+{
+    return llround(static_cast<double>(ticks) * snapshot.nanoseconds_per_tick);
+}
+} // namespace
+
+const char *metricOperationName(MetricOperation operation)
+{
+    switch (operation)
+    {
+    case MetricOperation::CreateAccount:
+        return "create_account";
+    case MetricOperation::DeleteAccount:
+        return "delete_account";
+    case MetricOperation::FindAccount:
+        return "find_account";
+    case MetricOperation::Deposit:
+        return "deposit";
+    case MetricOperation::Withdraw:
+        return "withdraw";
+    case MetricOperation::Transfer:
+        return "transfer";
+    case MetricOperation::Interest:
+        return "interest";
+    case MetricOperation::Batch:
+        return "batch";
+    case MetricOperation::Transaction:
+        return "transaction";
+    }
+    return "unknown";
+}
+
+size_t LatencyHistogram::bucketFor(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+    {
+        return value;
+    }
+    unsigned magnitude = bit_width(value) - 1;
+    return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucketStart(size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    return (SUB_BUCKETS + bucket % SUB_BUCKETS) << (bucket / SUB_BUCKETS - 1);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+    {
+        buckets[bucket] += other.buckets[bucket];
+    }
+    total += other.total;
+    maximum = max(maximum, other.maximum);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    uint64_t count = 0;
+    for (uint64_t bucket_count : buckets)
+    {
+        count += bucket_count;
+    }
+    return count;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const
+{
+    uint64_t rank = max<uint64_t>(static_cast<uint64_t>(ceil(fraction * static_cast<double>(count()))), 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+    {
+        seen += buckets[bucket];
+        if (seen >= rank)
+        {
+            return min(bucketEnd(bucket), maximum);
+        }
+    }
+    return 0;
+}
+
+uint64_t LatencyHistogram::minimum() const
+{
+    for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+    {
+        if (buckets[bucket] != 0)
+        {
+            return bucketStart(bucket);
+        }
+    }
+    return 0;
+}
+
+uint64_t OperationMetrics::calls() const
+{
+    uint64_t calls = 0;
+    for (uint64_t outcome_count : outcomes)
+    {
+        calls += outcome_count;
+    }
+    return calls;
+}
+
+void writeMetricsText(ostream &out, const MetricsSnapshot &snapshot)
+{
+    if (!snapshot.enabled)
+    {
+        out << "Metrics are not compiled in.\n";
+        return;
+    }
+    for (size_t op = 0; op < NUM_METRIC_OPERATIONS; ++op)
+    {
+        const OperationMetrics &metrics = snapshot.operations[op];
+        uint64_t calls = metrics.calls();
+        if (calls == 0)
+        {
+            continue;
+        }
+        out << metricOperationName(static_cast<MetricOperation>(op)) << ": calls " << calls << ", rejected "
+            << metrics.rejections();
+        const char *separator = " (";
+        for (size_t status = 1; status < NUM_STATUSES; ++status)
+        {
+            if (metrics.outcomes[status] != 0)
+            {
+                out << separator << statusName(static_cast<Status>(status)) << ' ' << metrics.outcomes[status];
+                separator = ", ";
+            }
+        }
+        if (metrics.rejections() != 0)
+        {
+            out << ')';
+        }
+        const LatencyHistogram &latency = metrics.latency;
+        out << ", latency ns: min " << toNanoseconds(latency.minimum(), snapshot);
+        for (const Percentile &percentile : REPORTED_PERCENTILES)
+        {
+            out << ' ' << percentile.name << ' ' << toNanoseconds(latency.percentile(percentile.fraction), snapshot);
+        }
+        out << " max " << toNanoseconds(latency.maximum, snapshot) << " mean "
+            << toNanoseconds(latency.total / calls, snapshot) << '\n';
+    }
+}
+
+void writeMetricsJson(ostream &out, const MetricsSnapshot &snapshot)
+{
+    out << "{\"enabled\":" << (snapshot.enabled ? "true" : "false") << ",\"operations\":{";
+    for (size_t op = 0; op < NUM_METRIC_OPERATIONS; ++op)
+    {
+        const OperationMetrics &metrics = snapshot.operations[op];
+        uint64_t calls = metrics.calls();
+        out << (op == 0 ? "" : ",") << '"' << metricOperationName(static_cast<MetricOperation>(op))
+            << "\":{\"calls\":" << calls << ",\"outcomes\":{";
+        for (size_t status = 0; status < NUM_STATUSES; ++status)
+        {
+            out << (status == 0 ? "" : ",") << '"' << statusName(static_cast<Status>(status))
+                << "\":" << metrics.outcomes[status];
+        }
+        const LatencyHistogram &latency = metrics.latency;
+        out << "},\"latency_ns\":{\"min\":" << toNanoseconds(latency.minimum(), snapshot);
+        for (const Percentile &percentile : REPORTED_PERCENTILES)
+        {
+            out << ",\"" << percentile.name << "\":"
+                << toNanoseconds(latency.percentile(percentile.fraction), snapshot);
+        }
+        out << ",\"max\":" << toNanoseconds(latency.maximum, snapshot)
+            << ",\"mean\":" << toNanoseconds(calls == 0 ? 0 : latency.total / calls, snapshot) << "}}";
+    }
+    out << "}}";
+}
+
+#ifdef BANKING_METRICS
+
+namespace
+{
+atomic<uint64_t> next_metrics_id{1};
+
+// Measured once, the first time metrics are exported, against steady_clock
+double nanosecondsPerTick()
+{
+    static const double nanoseconds_per_tick = []
+    {
+        using namespace chrono;
+#if defined(__x86_64__) || defined(__i386__)
+        steady_clock::time_point start_time = steady_clock::now();
+        uint64_t start_ticks = Metrics::now();
+        this_thread::sleep_for(milliseconds(5));
+        uint64_t end_ticks = Metrics::now();
+        steady_clock::time_point end_time = steady_clock::now();
+        return static_cast<double>(duration_cast<nanoseconds>(end_time - start_time).count()) /
+               static_cast<double>(end_ticks - start_ticks);
+#else
+        return static_cast<double>(steady_clock::period::num) * 1e9 / static_cast<double>(steady_clock::period::den);
+#endif
+    }();
+    return nanoseconds_per_tick;
+}
+} // namespace
+
+Metrics::Metrics() : id(next_metrics_id.fetch_add(1, memory_order_relaxed)) {}
+
+Metrics::ThreadBlock &Metrics::localBlock()
+{
+    // One thread-local object, so the fast path costs a single TLS access
+    struct Cache
+    {
+        uint64_t id = 0;
+        ThreadBlock *block = nullptr;
+    };
+    thread_local Cache cache;
+    if (cache.id == id)
+    {
+        return *cache.block;
+    }
+
+    // First use from this thread, or this thread last recorded into another bank
+    lock_guard<std::mutex> lock(blocks_mutex);
+    thread::id self = this_thread::get_id();
+    auto block = find_if(blocks.begin(), blocks.end(),
+                         [self](const unique_ptr<ThreadBlock> &candidate) { return candidate->owner == self; });
+    if (block == blocks.end())
+    {
+        blocks.push_back(make_unique<ThreadBlock>());
+        blocks.back()->owner = self;
+        block = prev(blocks.end());
+    }
+    cache.id = id;
+    cache.block = block->get();
+    return *cache.block;
+}
+
+void Metrics::record(MetricOperation operation, Status status, uint64_t ticks)
+{
+    OperationBlock &block = localBlock().operations[static_cast<size_t>(operation)];
+    block.outcomes[static_cast<size_t>(status)].add(1);
+    block.buckets[LatencyHistogram::bucketFor(ticks)].add(1);
+    block.total.add(ticks);
+    if (ticks > block.maximum.load())
+    {
+        block.maximum.value.store(ticks, memory_order_relaxed);
+    }
+}
+
+MetricsSnapshot Metrics::snapshot() const
+{
+    MetricsSnapshot snapshot;
+    snapshot.enabled = true;
+    snapshot.nanoseconds_per_tick = nanosecondsPerTick();
+    lock_guard<std::mutex> lock(blocks_mutex);
+    for (const unique_ptr<ThreadBlock> &block : blocks)
+    {
+        for (size_t op = 0; op < NUM_METRIC_OPERATIONS; ++op)
+        {
+            const OperationBlock &recorded = block->operations[op];
+            OperationMetrics &metrics = snapshot.operations[op];
+            for (size_t status = 0; status < NUM_STATUSES; ++status)
+            {
+                metrics.outcomes[status] += recorded.outcomes[status].load();
+            }
+            for (size_t bucket = 0; bucket < LatencyHistogram::NUM_BUCKETS; ++bucket)
+            {
+                metrics.latency.buckets[bucket] += recorded.buckets[bucket].load();
+            }
+            metrics.latency.total += recorded.total.load();
+            metrics.latency.maximum = max(metrics.latency.maximum, recorded.maximum.load());
+        }
+    }
+    return snapshot;
+}
+
+#endif /* BANKING_METRICS */
@@ -0,0 +1,200 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(BANKING_METRICS) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+#include "status.h"
+
+// Operations BankingSystem keeps metrics for
+enum class MetricOperation : uint8_t
+{
+    CreateAccount,
+    DeleteAccount,
+    FindAccount,
+    Deposit,
+    Withdraw,
+    Transfer,
+    Interest,
+    Batch,       // one per applyBatch call; only a journal failure counts as a rejection
+    Transaction, // one per commit, so each retry of runTransaction counts
+};
+
+constexpr std::size_t NUM_METRIC_OPERATIONS = static_cast<std::size_t>(MetricOperation::Transaction) + 1;
+
+// Short snake_case name, e.g. "create_account"
+const char *metricOperationName(MetricOperation operation);
+
+// Log-linear histogram in the style of HdrHistogram: every power of two is split into
+// SUB_BUCKETS equal buckets, so any recorded value is known to within 1/SUB_BUCKETS of
+// itself (12.5%) across the whole uint64_t range, in a fixed 4 KB.
+struct LatencyHistogram
+{
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr std::size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static std::size_t bucketFor(uint64_t value);
+    // Smallest value that falls in bucket
+    static uint64_t bucketStart(std::size_t bucket);
+
+    void record(uint64_t value)
+    {
+        buckets[bucketFor(value)]++;
+        total += value;
+        maximum = value > maximum ? value : maximum;
+    }
+    // Adds every value recorded in other
+    void merge(const LatencyHistogram &other);
+
+    uint64_t count() const;
+    // Value below which fraction (0 to 1) of the recorded values fall, as the end of the
+    // bucket it lands in; 0 when empty
+    uint64_t percentile(double fraction) const;
+    uint64_t minimum() const;
+
+    std::array<uint64_t, NUM_BUCKETS> buckets{};
+    uint64_t total = 0;   // sum of every recorded value
+    uint64_t maximum = 0; // exact
+};
+
+// Everything recorded for one operation
+struct OperationMetrics
+{
+    uint64_t calls() const;
+    uint64_t rejections() const { return calls() - outcomes[static_cast<std::size_t>(Status::Ok)]; }
+
+    std::array<uint64_t, NUM_STATUSES> outcomes{}; // calls that returned each Status
+    LatencyHistogram latency;                      // in ticks of Metrics::now()
+};
+
+// Totals across every thread at one moment
+struct MetricsSnapshot
+{
+    bool enabled = false; // false when built without BANKING_METRICS; everything else is zero
+    double nanoseconds_per_tick = 1.0;
+    std::array<OperationMetrics, NUM_METRIC_OPERATIONS> operations{};
+
+    const OperationMetrics &operator[](MetricOperation operation) const
+    {
+        return operations[static_cast<std::size_t>(operation)];
+    }
+};
+
+// Writes one line per operation that has been called: calls, rejections by reason and
+// latency percentiles in nanoseconds
+void writeMetricsText(std::ostream &out, const MetricsSnapshot &snapshot);
+// Writes the same figures as one JSON object, listing every operation and status so the
+// shape never changes
+void writeMetricsJson(std::ostream &out, const MetricsSnapshot &snapshot);
+
+#ifdef BANKING_METRICS
+
+// Per-operation counters and latency histograms. Each thread records into a block of its
+// own, written only by that thread with plain relaxed stores, so recording takes no lock
+// and no locked instruction; snapshot adds up the blocks. Latencies are taken with rdtsc
+// on x86 and steady_clock elsewhere, and converted to nanoseconds only when exported.
+class Metrics
+{
+public:
+    Metrics();
+    Metrics(const Metrics &) = delete;
+    Metrics &operator=(const Metrics &) = delete;
+
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    void record(MetricOperation operation, Status status, uint64_t ticks);
+    MetricsSnapshot snapshot() const;
+
+private:
+    // A counter with one writer: increments are a relaxed load and store, which a
+    // concurrent snapshot may read slightly stale but never torn
+    struct Counter
+    {
+        std::atomic<uint64_t> value{0};
+
+        void add(uint64_t amount) { value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed); }
+        uint64_t load() const { return value.load(std::memory_order_relaxed); }
+    };
+    // Outcomes, total and maximum share two cache lines, so a record touches three
+    struct alignas(64) OperationBlock
+    {
+        std::array<Counter, NUM_STATUSES> outcomes;
+        Counter total;
+        Counter maximum;
+        std::array<Counter, LatencyHistogram::NUM_BUCKETS> buckets;
+    };
+    struct ThreadBlock
+    {
+        std::thread::id owner;
+        std::array<OperationBlock, NUM_METRIC_OPERATIONS> operations;
+    };
+
+    ThreadBlock &localBlock();
+
+    uint64_t id; // never reused, unlike the address, so a thread's cached block stays valid
+    mutable std::mutex blocks_mutex;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks;
+};
+
+// Times one operation from construction to finish
+class OperationTimer
+{
+public:
+    OperationTimer(Metrics &metrics, MetricOperation operation)
+        : metrics(metrics), operation(operation), start(Metrics::now())
+    {
+    }
+
+    // Records the operation with its outcome and passes the status through
+    Status finish(Status status)
+    {
+        metrics.record(operation, status, Metrics::now() - start);
+        return status;
+    }
+
+private:
+    Metrics &metrics;
+    MetricOperation operation;
+    uint64_t start;
+};
+
+#else
+
+// Built without BANKING_METRICS: nothing is recorded and every call compiles away
+class Metrics
+{
+public:
+    void record(MetricOperation, Status, uint64_t) {}
+    MetricsSnapshot snapshot() const { return MetricsSnapshot(); }
+};
+
+class OperationTimer
+{
+public:
+    OperationTimer(Metrics &, MetricOperation) {}
+    Status finish(Status status) { return status; }
+};
+
+#endif /* BANKING_METRICS */
+
+#endif /* METRICS_H */
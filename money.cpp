@@ -0,0 +1,123 @@
+#include "money.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <ostream>
+
+using namespace std;
+
+Money Money::fromDouble(double amount, RoundingMode mode)
+{
+    double scaled = amount * MINOR_UNITS_PER_UNIT;
+    switch (mode)
+    {
+    case RoundingMode::HalfEven:
+        scaled = nearbyint(scaled);
+        break;
+    case RoundingMode::HalfUp:
+        scaled = round(scaled);
+        break;
+    case RoundingMode::Down:
+        scaled = trunc(scaled);
+        break;
+    case RoundingMode::Floor:
+        scaled = floor(scaled);
+        break;
+    case RoundingMode::Ceiling:
+        scaled = ceil(scaled);
+        break;
+    }
+
+    // 2^63 is exactly representable as a double; anything at or beyond it saturates
+    constexpr double LIMIT = 9223372036854775808.0;
+    if (scaled >= LIMIT)
+    {
+        return Money(numeric_limits<int64_t>::max());
+    }
+    if (scaled < -LIMIT || std::isnan(scaled))
+    {
+        return Money(numeric_limits<int64_t>::min());
+    }
+    return Money(static_cast<int64_t>(scaled));
+}
+
+optional<Money> Money::checkedAdd(Money other) const
+{
+    int64_t result;
+    if (__builtin_add_overflow(minor_units, other.minor_units, &result))
+    {
+        return nullopt;
+    }
+    return Money(result);
+}
+
+optional<Money> Money::checkedSubtract(Money other) const
+{
+    int64_t result;
+    if (__builtin_sub_overflow(minor_units, other.minor_units, &result))
+    {
+        return nullopt;
+    }
+    return Money(result);
+}
+
+optional<Money> Money::checkedScale(int64_t numerator, int64_t denominator, RoundingMode mode) const
+{
+    // |minor_units * numerator| < 2^126, so the product itself cannot overflow
+    __int128 product = static_cast<__int128>(minor_units) * numerator;
+    __int128 result = roundedDivide(product, denominator, mode);
+    if (result > numeric_limits<int64_t>::max() || result < numeric_limits<int64_t>::min())
+    {
+        return nullopt;
+    }
+    return Money(static_cast<int64_t>(result));
+}
+
+__int128 roundedDivide(__int128 numerator, int64_t denominator, RoundingMode mode)
+{
+    __int128 quotient = numerator / denominator;
+    __int128 remainder = numerator % denominator;
+    if (remainder == 0)
+    {
+        return quotient;
+    }
+
+    bool negative = remainder < 0;
+    __int128 twice_remainder = (negative ? -remainder : remainder) * 2;
+    bool away = false; // move one unit away from zero
+    switch (mode)
+    {
+    case RoundingMode::HalfEven:
+        away = twice_remainder > denominator || (twice_remainder == denominator && (quotient & 1) != 0);
+        break;
+    case RoundingMode::HalfUp:
+        away = twice_remainder >= denominator;
+        break;
+    case RoundingMode::Down:
+        away = false;
+        break;
+    case RoundingMode::Floor:
+        away = negative;
+        break;
+    case RoundingMode::Ceiling:
+        away = !negative;
+        break;
+    }
+    if (away)
+    {
+        quotient += negative ? -1 : 1;
+    }
+    return quotient;
+}
+
+ostream &operator<<(ostream &os, Money amount)
+{
+    int64_t minor = amount.minorUnits();
+    uint64_t magnitude = minor < 0 ? 0 - static_cast<uint64_t>(minor) : static_cast<uint64_t>(minor);
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%s%llu.%02llu", minor < 0 ? "-" : "",
+             static_cast<unsigned long long>(magnitude / Money::MINOR_UNITS_PER_UNIT),
+             static_cast<unsigned long long>(magnitude % Money::MINOR_UNITS_PER_UNIT));
+    return os << buffer;
+}
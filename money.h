@@ -0,0 +1,65 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+
+// How a result that falls between two minor units is rounded
+enum class RoundingMode
+{
+    HalfEven, // nearest, ties to even (banker's rounding)
+    HalfUp,   // nearest, ties away from zero
+    Down,     // toward zero
+    Floor,    // toward negative infinity
+    Ceiling,  // toward positive infinity
+};
+
+// Monetary amount held as a signed 64-bit count of minor currency units (cents).
+// All arithmetic is exact; operations that could overflow are checked and return
+// std::nullopt instead of wrapping.
+class Money
+{
+public:
+    static constexpr int64_t MINOR_UNITS_PER_UNIT = 100;
+
+    constexpr Money() : minor_units(0) {}
+
+    static constexpr Money fromMinorUnits(int64_t minor_units) { return Money(minor_units); }
+    static constexpr Money fromUnits(int64_t units) { return Money(units * MINOR_UNITS_PER_UNIT); }
+    // Converts a decimal amount such as 12.345 to minor units. Values outside the
+    // representable range saturate at the smallest/largest amount.
+    static Money fromDouble(double amount, RoundingMode mode = RoundingMode::HalfEven);
+
+    constexpr int64_t minorUnits() const { return minor_units; }
+    double toDouble() const { return static_cast<double>(minor_units) / MINOR_UNITS_PER_UNIT; }
+
+    constexpr bool isPositive() const { return minor_units > 0; }
+    constexpr bool isNegative() const { return minor_units < 0; }
+
+    std::optional<Money> checkedAdd(Money other) const;
+    std::optional<Money> checkedSubtract(Money other) const;
+    // Multiplies by numerator / denominator (denominator > 0) with a 128-bit intermediate
+    std::optional<Money> checkedScale(int64_t numerator, int64_t denominator,
+                                      RoundingMode mode = RoundingMode::HalfEven) const;
+
+    friend constexpr bool operator==(Money a, Money b) { return a.minor_units == b.minor_units; }
+    friend constexpr bool operator!=(Money a, Money b) { return a.minor_units != b.minor_units; }
+    friend constexpr bool operator<(Money a, Money b) { return a.minor_units < b.minor_units; }
+    friend constexpr bool operator<=(Money a, Money b) { return a.minor_units <= b.minor_units; }
+    friend constexpr bool operator>(Money a, Money b) { return a.minor_units > b.minor_units; }
+    friend constexpr bool operator>=(Money a, Money b) { return a.minor_units >= b.minor_units; }
+
+private:
+    explicit constexpr Money(int64_t minor) : minor_units(minor) {}
+
+    int64_t minor_units;
+};
+
+// Divides numerator by denominator (denominator > 0) rounding the quotient with mode
+__int128 roundedDivide(__int128 numerator, int64_t denominator, RoundingMode mode);
+
+// Prints the amount with two decimals, e.g. "-12.05"
+std::ostream &operator<<(std::ostream &os, Money amount);
+
+#endif /* MONEY_H */
@@ -0,0 +1,96 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free queue for any number of producers and a single consumer, the same
+// ring AsyncLogSink uses for messages. Each slot carries a sequence number: a slot is free
+// for position p when its sequence is p and holds a value once it is p + 1, so producers
+// claim positions with one CAS and never touch a slot the consumer is still reading.
+// tryPush fails rather than waiting when the ring is full.
+template <typename T>
+class MpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscQueue(std::size_t capacity)
+        : mask(std::bit_ceil(capacity < 2 ? std::size_t(2) : capacity) - 1), slots(new Slot[mask + 1]),
+          enqueue_position(0), dequeue_position(0)
+    {
+        for (std::size_t i = 0; i <= mask; ++i)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // Moves value into the queue; returns false, leaving value alone, if the queue is full
+    bool tryPush(T &value)
+    {
+        uint64_t position = enqueue_position.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true)
+        {
+            slot = &slots[position & mask];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            if (sequence == position)
+            {
+                if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (sequence < position)
+            {
+                return false;
+            }
+            else
+            {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::move(value);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only: moves the oldest value into value; returns false if there is none
+    bool tryPop(T &value)
+    {
+        Slot &slot = slots[dequeue_position & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_position + 1)
+        {
+            return false;
+        }
+        value = std::move(slot.value);
+        slot.sequence.store(dequeue_position + mask + 1, std::memory_order_release);
+        dequeue_position++;
+        return true;
+    }
+
+    // Consumer only
+    bool empty() const
+    {
+        return slots[dequeue_position & mask].sequence.load(std::memory_order_acquire) != dequeue_position + 1;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<uint64_t> enqueue_position;
+    alignas(64) uint64_t dequeue_position; // only touched by the consumer
+};
+
+#endif /* MPSC_QUEUE_H */
@@ -0,0 +1,115 @@
+#include "owner_index.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+string foldCase(string_view name)
+{
+    string folded(name);
+    for (char &c : folded)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return folded;
+}
+} // namespace
+
+atomic<int64_t> &OwnerIndex::insert(string_view owner, int32_t account_number)
+{
+    auto it = owners.find(owner);
+    if (it == owners.end())
+    {
+        unique_ptr<Owner> entry(new Owner{string(owner), foldCase(owner), {}});
+        by_folded_name.emplace(entry->folded_name, entry.get());
+        it = owners.emplace(entry->name, move(entry)).first;
+    }
+    it->second->accounts.push_back(account_number);
+    return it->second->balance;
+}
+
+bool OwnerIndex::erase(string_view owner, int32_t account_number)
+{
+    auto it = owners.find(owner);
+    if (it == owners.end())
+    {
+        return false;
+    }
+    vector<int32_t> &accounts = it->second->accounts;
+    auto position = std::find(accounts.begin(), accounts.end(), account_number);
+    if (position == accounts.end())
+    {
+        return false;
+    }
+    *position = accounts.back();
+    accounts.pop_back();
+
+    if (accounts.empty())
+    {
+        // Drop the name once nobody holds an account under it
+        auto range = by_folded_name.equal_range(it->second->folded_name);
+        for (auto entry = range.first; entry != range.second; ++entry)
+        {
+            if (entry->second == it->second.get())
+            {
+                by_folded_name.erase(entry);
+                break;
+            }
+        }
+        owners.erase(it);
+    }
+    return true;
+}
+
+void OwnerIndex::clear()
+{
+    by_folded_name.clear();
+    owners.clear();
+}
+
+Money OwnerIndex::balance(string_view owner) const
+{
+    auto it = owners.find(owner);
+    return it == owners.end() ? Money() : Money::fromMinorUnits(it->second->balance.load(memory_order_relaxed));
+}
+
+span<const int32_t> OwnerIndex::find(string_view owner) const
+{
+    auto it = owners.find(owner);
+    if (it == owners.end())
+    {
+        return {};
+    }
+    return it->second->accounts;
+}
+
+void OwnerIndex::search(string_view query, OwnerMatch match, vector<int32_t> &out) const
+{
+    if (match == OwnerMatch::Exact)
+    {
+        span<const int32_t> accounts = find(query);
+        out.insert(out.end(), accounts.begin(), accounts.end());
+        return;
+    }
+
+    // Every match folds to a name that equals or starts with the folded query, and those
+    // names sort together starting at the query itself
+    string folded_query = foldCase(query);
+    bool prefix = match == OwnerMatch::Prefix || match == OwnerMatch::PrefixIgnoreCase;
+    for (auto it = by_folded_name.lower_bound(folded_query);
+         it != by_folded_name.end() && it->first.starts_with(folded_query); ++it)
+    {
+        const Owner &owner = *it->second;
+        if ((!prefix && owner.folded_name.size() != folded_query.size()) ||
+            (match == OwnerMatch::Prefix && !owner.name.starts_with(query)))
+        {
+            continue;
+        }
+        out.insert(out.end(), owner.accounts.begin(), owner.accounts.end());
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef OWNER_INDEX_H
+#define OWNER_INDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "money.h"
+
+// How an owner search compares names
+enum class OwnerMatch : uint8_t
+{
+    Exact,
+    IgnoreCase,       // ASCII letters compare equal regardless of case
+    Prefix,           // names starting with the query
+    PrefixIgnoreCase,
+};
+
+// Secondary index from owner name to the accounts it owns.
+// Each distinct name is stored once, with its accounts in a flat list. A hash table on the
+// exact name answers exact searches without copying; a tree ordered by the case-folded
+// name answers case-insensitive and prefix searches by walking one contiguous range.
+// Not thread-safe: callers serialize updates against each other and against searches.
+// The one exception is each owner's balance total, an atomic the caller adds to directly.
+class OwnerIndex
+{
+public:
+    OwnerIndex() = default;
+    OwnerIndex(const OwnerIndex &) = delete;
+    OwnerIndex &operator=(const OwnerIndex &) = delete;
+
+    // Returns the owner's balance total, which stays at the same address until the owner's
+    // last account is erased
+    std::atomic<int64_t> &insert(std::string_view owner, int32_t account_number);
+    // Removes account_number from owner's list; linear in the number of accounts the owner
+    // has. Returns false if it was not listed.
+    bool erase(std::string_view owner, int32_t account_number);
+    void clear();
+
+    // Accounts owned by exactly owner, in no particular order; valid until the next update
+    std::span<const int32_t> find(std::string_view owner) const;
+    // Appends the accounts of every owner matching query to out, in no particular order
+    void search(std::string_view query, OwnerMatch match, std::vector<int32_t> &out) const;
+    // Sum of the balances of owner's accounts, as kept through insert; 0 for an unknown owner
+    Money balance(std::string_view owner) const;
+
+    // Number of distinct owner names
+    std::size_t size() const { return owners.size(); }
+
+private:
+    struct Owner
+    {
+        std::string name;
+        std::string folded_name; // ASCII lowercase, the key in by_folded_name
+        std::vector<int32_t> accounts;
+        std::atomic<int64_t> balance{0}; // in minor units
+    };
+
+    // Keys view the names inside the Owner they map to
+    std::unordered_map<std::string_view, std::unique_ptr<Owner>> owners;
+    std::multimap<std::string_view, Owner *> by_folded_name;
+};
+
+#endif /* OWNER_INDEX_H */
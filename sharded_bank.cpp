@@ -0,0 +1,447 @@
+#include "sharded_bank.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+// Times an idle worker yields before going to sleep
+constexpr int SPIN_ROUNDS = 64;
+} // namespace
+
+ShardedBank::ShardedBank(size_t num_shards, size_t queue_capacity)
+{
+    if (num_shards == 0)
+    {
+        num_shards = max(thread::hardware_concurrency(), 1u);
+    }
+    shards.reserve(num_shards);
+    for (size_t i = 0; i < num_shards; ++i)
+    {
+        shards.push_back(make_unique<Shard>(queue_capacity));
+    }
+    // Workers start once every shard exists, since any of them may forward to any other
+    for (unique_ptr<Shard> &shard : shards)
+    {
+        shard->worker = thread(&ShardedBank::run, this, ref(*shard));
+    }
+}
+
+ShardedBank::~ShardedBank()
+{
+    stopping.store(true, memory_order_release);
+    for (unique_ptr<Shard> &shard : shards)
+    {
+        shard->wake_signal.fetch_add(1, memory_order_release);
+        shard->wake_signal.notify_one();
+    }
+    for (unique_ptr<Shard> &shard : shards)
+    {
+        shard->worker.join();
+    }
+}
+
+bool ShardedBank::trySend(Shard &target, Request &request)
+{
+    if (!target.inbox.tryPush(request))
+    {
+        return false;
+    }
+    // Pairs with the fence in run: either the worker sees this request before sleeping,
+    // or this sees it asleep and wakes it
+    atomic_thread_fence(memory_order_seq_cst);
+    if (target.sleeping.load(memory_order_relaxed))
+    {
+        target.wake_signal.fetch_add(1, memory_order_release);
+        target.wake_signal.notify_one();
+    }
+    return true;
+}
+
+void ShardedBank::submit(Request &request)
+{
+    Shard &shard = *shards[shardOf(request.account_number)];
+    while (!trySend(shard, request))
+    {
+        this_thread::yield();
+    }
+}
+
+void ShardedBank::forward(Shard &from, Shard &target, Request &request)
+{
+    // Anything already parked goes first so messages between two shards stay in order
+    if (!from.outbox.empty() || !trySend(target, request))
+    {
+        from.outbox.emplace_back(&target, move(request));
+    }
+}
+
+void ShardedBank::complete(Completion *completion, Status status)
+{
+    completion->status = status;
+    completion->done.store(true, memory_order_release);
+    completion->done.notify_one();
+}
+
+Status ShardedBank::call(RequestType type, int account_number, Money amount, Completion &completion)
+{
+    Request request{type, account_number, 0, amount, 0, 0, Status::Ok, &completion, string()};
+    submit(request);
+    completion.done.wait(false, memory_order_acquire);
+    return completion.status;
+}
+
+Status ShardedBank::createAccount(int account_number, const string &owner, Money initial_balance)
+{
+    // Same limit as BankingSystem, so the two report the same status
+    if (owner.size() > MAX_OWNER_LENGTH)
+    {
+        return Status::OwnerTooLong;
+    }
+    if (account_number == NO_COUNTERPARTY)
+    {
+        return Status::InvalidAccount;
+    }
+    Completion completion;
+    Request request{RequestType::CreateAccount, account_number, 0, initial_balance, 0, 0, Status::Ok, &completion,
+                    owner};
+    submit(request);
+    completion.done.wait(false, memory_order_acquire);
+    return completion.status;
+}
+
+Status ShardedBank::deposit(int account_number, Money amount)
+{
+    Completion completion;
+    return call(RequestType::Deposit, account_number, amount, completion);
+}
+
+Status ShardedBank::withdraw(int account_number, Money amount)
+{
+    Completion completion;
+    return call(RequestType::Withdrawal, account_number, amount, completion);
+}
+
+Status ShardedBank::transfer(int from_account_number, int to_account_number, Money amount)
+{
+    Completion completion;
+    Request request{RequestType::Transfer, from_account_number, to_account_number, amount, 0, 0, Status::Ok,
+                    &completion, string()};
+    submit(request);
+    completion.done.wait(false, memory_order_acquire);
+    return completion.status;
+}
+
+Status ShardedBank::deleteAccount(int account_number)
+{
+    Completion completion;
+    return call(RequestType::DeleteAccount, account_number, Money(), completion);
+}
+
+optional<Money> ShardedBank::balance(int account_number)
+{
+    Completion completion;
+    if (call(RequestType::Balance, account_number, Money(), completion) != Status::Ok)
+    {
+        return nullopt;
+    }
+    return completion.balance;
+}
+
+optional<size_t> ShardedBank::historySize(int account_number)
+{
+    Completion completion;
+    if (call(RequestType::HistorySize, account_number, Money(), completion) != Status::Ok)
+    {
+        return nullopt;
+    }
+    return completion.history_size;
+}
+
+BatchResult ShardedBank::applyBatch(span<const Operation> operations)
+{
+    unique_ptr<Completion[]> completions(new Completion[operations.size()]);
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        const Operation &operation = operations[i];
+        RequestType type = operation.type == OperationType::Deposit      ? RequestType::Deposit
+                           : operation.type == OperationType::Withdrawal ? RequestType::Withdrawal
+                                                                         : RequestType::Transfer;
+        Request request{type,      operation.account_number, operation.to_account_number, operation.amount, 0, 0,
+                        Status::Ok, &completions[i],         string()};
+        submit(request);
+    }
+
+    BatchResult result;
+    result.statuses.resize(operations.size());
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        completions[i].done.wait(false, memory_order_acquire);
+        result.statuses[i] = completions[i].status;
+        if (completions[i].status == Status::Ok)
+        {
+            result.succeeded++;
+        }
+        else
+        {
+            result.failed++;
+        }
+    }
+    return result;
+}
+
+void ShardedBank::run(Shard &shard)
+{
+    Request request;
+    int idle_rounds = 0;
+    while (true)
+    {
+        while (!shard.outbox.empty() && trySend(*shard.outbox.front().first, shard.outbox.front().second))
+        {
+            shard.outbox.pop_front();
+        }
+        if (shard.inbox.tryPop(request))
+        {
+            process(shard, request);
+            idle_rounds = 0;
+            continue;
+        }
+        // A parked message means another shard is busy, not that there is nothing to do
+        if (!shard.outbox.empty() || ++idle_rounds < SPIN_ROUNDS)
+        {
+            this_thread::yield();
+            continue;
+        }
+        if (stopping.load(memory_order_acquire))
+        {
+            break;
+        }
+
+        uint32_t signal = shard.wake_signal.load(memory_order_acquire);
+        shard.sleeping.store(true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (shard.inbox.empty() && !stopping.load(memory_order_acquire))
+        {
+            shard.wake_signal.wait(signal, memory_order_acquire);
+        }
+        shard.sleeping.store(false, memory_order_relaxed);
+        idle_rounds = 0;
+    }
+}
+
+void ShardedBank::process(Shard &shard, Request &request)
+{
+    int32_t handle = shard.index.find(request.account_number);
+    ShardAccount *account = handle == AccountIndex::NOT_FOUND ? nullptr : &shard.accounts[handle];
+    switch (request.type)
+    {
+    case RequestType::CreateAccount:
+    {
+        if (request.amount.isNegative())
+        {
+            complete(request.completion, Status::InvalidAmount);
+            return;
+        }
+        if (account != nullptr)
+        {
+            complete(request.completion, Status::AccountExists);
+            return;
+        }
+        handle = shard.accounts.allocate();
+        if (handle == SlabStore<ShardAccount>::FULL)
+        {
+            complete(request.completion, Status::TooManyAccounts);
+            return;
+        }
+        ShardAccount &new_account = shard.accounts[handle];
+        new_account.account_number = request.account_number;
+        new_account.incarnation = shard.next_incarnation++;
+        new_account.owner = move(request.owner);
+        new_account.balance = request.amount;
+        new_account.held = Money();
+        shard.index.insert(request.account_number, handle);
+        complete(request.completion, Status::Ok);
+        return;
+    }
+    case RequestType::DeleteAccount:
+        if (account == nullptr)
+        {
+            complete(request.completion, Status::AccountNotFound);
+            return;
+        }
+        account->transactions.clear(shard.transaction_arena);
+        shard.accounts.release(handle);
+        shard.index.erase(request.account_number);
+        complete(request.completion, Status::Ok);
+        return;
+    case RequestType::Deposit:
+    {
+        if (account == nullptr)
+        {
+            complete(request.completion, Status::AccountNotFound);
+            return;
+        }
+        optional<Money> new_balance;
+        if (!request.amount.isPositive() || !(new_balance = credited(*account, request.amount)))
+        {
+            complete(request.completion, Status::InvalidAmount);
+            return;
+        }
+        account->balance = *new_balance;
+        account->transactions.append(shard.transaction_arena, TransactionType::Deposit, request.amount,
+                                     NO_COUNTERPARTY, currentTimestamp());
+        complete(request.completion, Status::Ok);
+        return;
+    }
+    case RequestType::Withdrawal:
+        if (account == nullptr)
+        {
+            complete(request.completion, Status::AccountNotFound);
+            return;
+        }
+        if (!request.amount.isPositive())
+        {
+            complete(request.completion, Status::InvalidAmount);
+            return;
+        }
+        if (request.amount > account->balance)
+        {
+            complete(request.completion, Status::InsufficientFunds);
+            return;
+        }
+        account->balance = *account->balance.checkedSubtract(request.amount);
+        account->transactions.append(shard.transaction_arena, TransactionType::Withdrawal, request.amount,
+                                     NO_COUNTERPARTY, currentTimestamp());
+        complete(request.completion, Status::Ok);
+        return;
+    case RequestType::Transfer:
+    case RequestType::Credit:
+    case RequestType::Settle:
+        processTransfer(shard, request);
+        return;
+    case RequestType::Balance:
+        if (account != nullptr)
+        {
+            request.completion->balance = account->balance;
+        }
+        complete(request.completion, account == nullptr ? Status::AccountNotFound : Status::Ok);
+        return;
+    case RequestType::HistorySize:
+        if (account != nullptr)
+        {
+            request.completion->history_size = account->transactions.size();
+        }
+        complete(request.completion, account == nullptr ? Status::AccountNotFound : Status::Ok);
+        return;
+    }
+}
+
+optional<Money> ShardedBank::credited(const ShardAccount &account, Money amount)
+{
+    optional<Money> new_balance = account.balance.checkedAdd(amount);
+    if (!new_balance || !new_balance->checkedAdd(account.held))
+    {
+        return nullopt;
+    }
+    return new_balance;
+}
+
+void ShardedBank::processTransfer(Shard &shard, Request &request)
+{
+    uint32_t timestamp = currentTimestamp();
+    if (request.type == RequestType::Credit)
+    {
+        // Second phase, on the payee's shard; the reply goes back whatever happens
+        int32_t handle = shard.index.find(request.to_account_number);
+        Status status = Status::AccountNotFound;
+        if (handle != AccountIndex::NOT_FOUND)
+        {
+            ShardAccount &payee = shard.accounts[handle];
+            optional<Money> new_balance = credited(payee, request.amount);
+            status = new_balance ? Status::Ok : Status::InvalidAmount;
+            if (new_balance)
+            {
+                payee.balance = *new_balance;
+                payee.transactions.append(shard.transaction_arena, TransactionType::TransferIn, request.amount,
+                                          request.account_number, timestamp);
+            }
+        }
+        request.type = RequestType::Settle;
+        request.status = status;
+        forward(shard, *shards[shardOf(request.account_number)], request);
+        return;
+    }
+    if (request.type == RequestType::Settle)
+    {
+        // The payer may have been deleted meanwhile, taking the held amount with its balance
+        int32_t handle = request.source_handle;
+        if (shard.accounts.isLive(handle) && shard.accounts[handle].incarnation == request.source_incarnation)
+        {
+            ShardAccount &payer = shard.accounts[handle];
+            payer.held = *payer.held.checkedSubtract(request.amount);
+            if (request.status == Status::Ok)
+            {
+                payer.transactions.append(shard.transaction_arena, TransactionType::TransferOut, request.amount,
+                                          request.to_account_number, timestamp);
+            }
+            else
+            {
+                // Fits, since credits meanwhile left room for every held amount
+                payer.balance = *payer.balance.checkedAdd(request.amount);
+            }
+        }
+        complete(request.completion, request.status);
+        return;
+    }
+
+    int32_t handle = shard.index.find(request.account_number);
+    Shard &payee_shard = *shards[shardOf(request.to_account_number)];
+    int32_t payee_handle = &payee_shard == &shard ? shard.index.find(request.to_account_number) : 0;
+    if (handle == AccountIndex::NOT_FOUND || payee_handle == AccountIndex::NOT_FOUND)
+    {
+        complete(request.completion, Status::AccountNotFound);
+        return;
+    }
+    ShardAccount &payer = shard.accounts[handle];
+    if (!request.amount.isPositive())
+    {
+        complete(request.completion, Status::InvalidAmount);
+        return;
+    }
+    if (request.amount > payer.balance)
+    {
+        complete(request.completion, Status::InsufficientFunds);
+        return;
+    }
+
+    if (&payee_shard == &shard)
+    {
+        // Both accounts are here, so the transfer completes in one step
+        ShardAccount &payee = shard.accounts[payee_handle];
+        Money new_payer_balance = *payer.balance.checkedSubtract(request.amount);
+        optional<Money> new_payee_balance =
+            &payee == &payer ? new_payer_balance.checkedAdd(request.amount) : credited(payee, request.amount);
+        if (!new_payee_balance)
+        {
+            complete(request.completion, Status::InvalidAmount);
+            return;
+        }
+        payer.balance = new_payer_balance;
+        payee.balance = *new_payee_balance;
+        payer.transactions.append(shard.transaction_arena, TransactionType::TransferOut, request.amount,
+                                  request.to_account_number, timestamp);
+        payee.transactions.append(shard.transaction_arena, TransactionType::TransferIn, request.amount,
+                                  request.account_number, timestamp);
+        complete(request.completion, Status::Ok);
+        return;
+    }
+
+    // First phase: hold the amount by debiting it now, then ask the payee's shard to credit it
+    payer.balance = *payer.balance.checkedSubtract(request.amount);
+    payer.held = *payer.held.checkedAdd(request.amount);
+    request.type = RequestType::Credit;
+    request.source_handle = handle;
+    request.source_incarnation = payer.incarnation;
+    forward(shard, payee_shard, request);
+}
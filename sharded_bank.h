@@ -0,0 +1,156 @@
+#ifndef SHARDED_BANK_H
+#define SHARDED_BANK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "account_index.h"
+#include "banking_system.h"
+#include "money.h"
+#include "mpsc_queue.h"
+#include "slab_store.h"
+#include "transaction_log.h"
+
+// Share-nothing execution mode. Accounts are partitioned by a hash of the account number
+// across shards, each owned by one worker thread that keeps its accounts, index and
+// histories to itself and so takes no locks. Callers hand requests to the owning shard
+// through its lock-free inbox and wait for the reply.
+//
+// A transfer between shards runs in two phases: the source shard debits the payer and
+// sends a credit to the destination shard, which credits the payee (or finds it missing)
+// and reports back, and only then does the source post the payer's history, or refund
+// the debit, and reply. Until then the amount is held by neither account, so a sum of
+// balances only adds up while no cross-shard transfer is in flight. Credits to the payer
+// meanwhile leave room for the held amount, failing with InvalidAmount if they would
+// overflow once it is refunded, so a refund can never be lost. Because the payee is
+// only seen in the second phase, a transfer that is invalid for several reasons may
+// report a different one than BankingSystem::transfer.
+//
+// Requests to one shard are handled in the order they were queued, so one caller's
+// operations on an account apply in order. Journaling, owner search and interest are
+// only available on BankingSystem.
+class ShardedBank
+{
+public:
+    // num_shards of 0 starts one shard per hardware thread; capacity is per inbox
+    explicit ShardedBank(std::size_t num_shards = 0, std::size_t queue_capacity = 4096);
+    // Call only once every request has returned
+    ~ShardedBank();
+    ShardedBank(const ShardedBank &) = delete;
+    ShardedBank &operator=(const ShardedBank &) = delete;
+
+    Status createAccount(int account_number, const std::string &owner, Money initial_balance);
+    Status deposit(int account_number, Money amount);
+    Status withdraw(int account_number, Money amount);
+    Status transfer(int from_account_number, int to_account_number, Money amount);
+    Status deleteAccount(int account_number);
+    std::optional<Money> balance(int account_number);
+    // Number of history records on an account, or nullopt if it does not exist
+    std::optional<std::size_t> historySize(int account_number);
+    // Queues every operation before waiting for any, so the shards work through the batch
+    // in parallel; operations on one shard still apply in batch order
+    BatchResult applyBatch(std::span<const Operation> operations);
+
+    std::size_t numShards() const { return shards.size(); }
+    std::size_t shardOf(int account_number) const
+    {
+        // Fibonacci hash scaled onto [0, numShards()) with a multiply instead of a modulo
+        uint32_t hash = static_cast<uint32_t>(account_number) * 2654435769u;
+        return static_cast<std::size_t>((uint64_t(hash) * shards.size()) >> 32);
+    }
+
+private:
+    enum class RequestType : uint8_t
+    {
+        CreateAccount,
+        DeleteAccount,
+        Deposit,
+        Withdrawal,
+        Transfer,
+        Balance,
+        HistorySize,
+        Credit, // second phase of a cross-shard transfer, sent to the payee's shard
+        Settle, // outcome of a Credit, sent back to the payer's shard
+    };
+
+    // Filled in by the worker; the caller waits on done
+    struct Completion
+    {
+        std::atomic<bool> done{false};
+        Status status = Status::Ok;
+        Money balance;
+        std::size_t history_size = 0;
+    };
+
+    struct Request
+    {
+        RequestType type;
+        int32_t account_number;
+        int32_t to_account_number;
+        Money amount;
+        // Credit and Settle: the debited account's slot, so settling cannot touch an
+        // account that reused the number after the payer was deleted
+        int32_t source_handle;
+        uint32_t source_incarnation;
+        Status status; // Settle only
+        Completion *completion;
+        std::string owner;
+    };
+
+    struct ShardAccount
+    {
+        int account_number;
+        uint32_t incarnation;
+        std::string owner;
+        Money balance;
+        // Debited by cross-shard transfers still waiting for their Settle. Credits keep
+        // balance + held from overflowing, so a refund always fits.
+        Money held;
+        TransactionLog transactions;
+    };
+
+    struct Shard
+    {
+        explicit Shard(std::size_t queue_capacity) : inbox(queue_capacity) {}
+
+        MpscQueue<Request> inbox;
+        std::thread worker;
+        // Everything below is only touched by the worker
+        AccountIndex index; // account number -> handle in accounts
+        SlabStore<ShardAccount> accounts;
+        TransactionArena transaction_arena;
+        uint32_t next_incarnation = 0;
+        std::deque<std::pair<Shard *, Request>> outbox; // messages another shard's full inbox turned away
+        // Set while the worker sleeps waiting for requests; bumping wake_signal wakes it
+        alignas(64) std::atomic<bool> sleeping{false};
+        std::atomic<uint32_t> wake_signal{0};
+    };
+
+    // Queues a request on its account's shard, waiting while that inbox is full
+    void submit(Request &request);
+    Status call(RequestType type, int account_number, Money amount, Completion &completion);
+    bool trySend(Shard &target, Request &request);
+    // Worker to worker; parks the message in the outbox rather than block on a full inbox
+    void forward(Shard &from, Shard &target, Request &request);
+    void run(Shard &shard);
+    void process(Shard &shard, Request &request);
+    void processTransfer(Shard &shard, Request &request);
+    static void complete(Completion *completion, Status status);
+    // Balance after crediting amount, or nullopt if that or the balance with every held
+    // amount refunded would overflow
+    static std::optional<Money> credited(const ShardAccount &account, Money amount);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> stopping{false};
+};
+
+#endif /* SHARDED_BANK_H */
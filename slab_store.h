@@ -0,0 +1,157 @@
+#ifndef SLAB_STORE_H
+#define SLAB_STORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Chunked object store addressed by stable integer handles.
+// Storage grows one fixed-size chunk at a time and chunks never move, so handles and
+// pointers stay valid until the object is released. Released slots go on a free list
+// and are reused by later allocations, making both allocate and release O(1).
+//
+// allocate and release may be called from several threads, and operator[] may run
+// concurrently with them. forEach and isLive must not race with allocate or release.
+template <typename T, std::size_t ChunkSize = 1024>
+class SlabStore
+{
+public:
+    static_assert((ChunkSize & (ChunkSize - 1)) == 0, "ChunkSize must be a power of two");
+
+    static constexpr int32_t FULL = -1;
+    static constexpr std::size_t MAX_CHUNKS = std::size_t(1) << 16;
+
+    SlabStore() : chunks(new std::atomic<Chunk *>[MAX_CHUNKS]()), num_chunks(0), num_live(0), num_slots(0) {}
+    SlabStore(const SlabStore &) = delete;
+    SlabStore &operator=(const SlabStore &) = delete;
+
+    ~SlabStore()
+    {
+        clear();
+    }
+
+    // Constructs a T in a free slot and returns its handle, or FULL when every chunk is in use
+    template <typename... Args>
+    int32_t allocate(Args &&...args)
+    {
+        std::lock_guard<std::mutex> lock(allocation_mutex);
+        int32_t handle;
+        if (!free_slots.empty())
+        {
+            handle = free_slots.back();
+            free_slots.pop_back();
+        }
+        else
+        {
+            if (num_slots == num_chunks * ChunkSize)
+            {
+                if (num_chunks == MAX_CHUNKS)
+                {
+                    return FULL;
+                }
+                chunks[num_chunks].store(new Chunk, std::memory_order_release);
+                num_chunks++;
+            }
+            handle = static_cast<int32_t>(num_slots++);
+        }
+
+        Chunk &chunk = chunkOf(handle);
+        new (chunk.slot(handle)) T(std::forward<Args>(args)...);
+        chunk.live[handle & (ChunkSize - 1)] = true;
+        num_live.fetch_add(1, std::memory_order_relaxed);
+        return handle;
+    }
+
+    // Destroys the object at handle and makes the slot available for reuse
+    void release(int32_t handle)
+    {
+        std::lock_guard<std::mutex> lock(allocation_mutex);
+        Chunk &chunk = chunkOf(handle);
+        chunk.slot(handle)->~T();
+        chunk.live[handle & (ChunkSize - 1)] = false;
+        free_slots.push_back(handle);
+        num_live.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(allocation_mutex);
+        for (std::size_t handle = 0; handle < num_slots; ++handle)
+        {
+            Chunk &chunk = chunkOf(static_cast<int32_t>(handle));
+            if (chunk.live[handle & (ChunkSize - 1)])
+            {
+                chunk.slot(static_cast<int32_t>(handle))->~T();
+            }
+        }
+        for (std::size_t i = 0; i < num_chunks; ++i)
+        {
+            delete chunks[i].exchange(nullptr, std::memory_order_relaxed);
+        }
+        free_slots.clear();
+        num_chunks = 0;
+        num_live.store(0, std::memory_order_relaxed);
+        num_slots = 0;
+    }
+
+    T &operator[](int32_t handle) { return *chunkOf(handle).slot(handle); }
+    const T &operator[](int32_t handle) const { return *chunkOf(handle).slot(handle); }
+
+    bool isLive(int32_t handle) const
+    {
+        return handle >= 0 && static_cast<std::size_t>(handle) < num_slots &&
+               chunkOf(handle).live[handle & (ChunkSize - 1)];
+    }
+
+    // Calls f(handle, object) for every live object in handle order
+    template <typename F>
+    void forEach(F &&f)
+    {
+        for (std::size_t handle = 0; handle < num_slots; ++handle)
+        {
+            if (isLive(static_cast<int32_t>(handle)))
+            {
+                f(static_cast<int32_t>(handle), (*this)[static_cast<int32_t>(handle)]);
+            }
+        }
+    }
+
+    std::size_t size() const { return num_live.load(std::memory_order_relaxed); }
+    std::size_t capacity() const { return num_chunks * ChunkSize; }
+
+private:
+    struct Chunk
+    {
+        alignas(T) unsigned char storage[ChunkSize][sizeof(T)];
+        bool live[ChunkSize] = {};
+
+        T *slot(int32_t handle)
+        {
+            return std::launder(reinterpret_cast<T *>(storage[handle & (ChunkSize - 1)]));
+        }
+        const T *slot(int32_t handle) const
+        {
+            return std::launder(reinterpret_cast<const T *>(storage[handle & (ChunkSize - 1)]));
+        }
+    };
+
+    Chunk &chunkOf(int32_t handle) const
+    {
+        return *chunks[static_cast<std::size_t>(handle) / ChunkSize].load(std::memory_order_acquire);
+    }
+
+    // Fixed directory of chunk pointers, so readers never see it reallocated under them
+    std::unique_ptr<std::atomic<Chunk *>[]> chunks;
+    std::size_t num_chunks;
+    std::mutex allocation_mutex; // guards the free list, chunk growth and live flags
+    std::vector<int32_t> free_slots;
+    std::atomic<std::size_t> num_live;
+    std::size_t num_slots; // slots handed out at least once
+};
+
+#endif /* SLAB_STORE_H */
@@ -0,0 +1,328 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "checksum.h"
+
+using namespace std;
+
+namespace
+{
+constexpr char MAGIC[8] = {'B', 'A', 'N', 'K', 'S', 'N', 'A', 'P'};
+constexpr size_t WRITE_BUFFER_SIZE = size_t(1) << 20;
+constexpr uint64_t MIN_INDEX_CAPACITY = 16;
+
+// Same Fibonacci hashing as AccountIndex, on a table of 2^bits entries
+size_t homeSlot(int account_number, unsigned bits)
+{
+    uint64_t key = static_cast<uint32_t>(account_number);
+    return static_cast<size_t>((key * 11400714819323198485ull) >> (64 - bits));
+}
+
+unsigned log2Of(uint64_t capacity)
+{
+    unsigned bits = 0;
+    while ((uint64_t(1) << bits) < capacity)
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+// Makes a rename in the directory holding path durable
+bool syncParentDirectory(const string &path)
+{
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+}
+
+uint32_t headerCrc(SnapshotHeader header)
+{
+    header.header_crc = 0;
+    return crc32c(&header, sizeof(header));
+}
+
+// Sequential file writer that keeps a running checksum of the current section
+class SectionWriter
+{
+public:
+    explicit SectionWriter(int fd) : fd(fd), offset(0), crc(0), ok(true)
+    {
+        buffer.reserve(WRITE_BUFFER_SIZE);
+    }
+
+    // Starts a new checksum and returns the section's offset
+    uint64_t beginSection()
+    {
+        crc = 0;
+        return offset;
+    }
+    uint32_t sectionCrc() const { return crc; }
+
+    void append(const void *data, size_t length)
+    {
+        crc = crc32c(data, length, crc);
+        offset += length;
+        const char *bytes = static_cast<const char *>(data);
+        while (length > 0)
+        {
+            size_t n = min(length, WRITE_BUFFER_SIZE - buffer.size());
+            buffer.insert(buffer.end(), bytes, bytes + n);
+            bytes += n;
+            length -= n;
+            if (buffer.size() == WRITE_BUFFER_SIZE)
+            {
+                flush();
+            }
+        }
+    }
+
+    bool finish()
+    {
+        flush();
+        return ok;
+    }
+
+private:
+    void flush()
+    {
+        const char *data = buffer.data();
+        size_t length = buffer.size();
+        while (ok && length > 0)
+        {
+            ssize_t written = ::write(fd, data, length);
+            if (written < 0 && errno != EINTR)
+            {
+                ok = false;
+            }
+            else if (written > 0)
+            {
+                data += written;
+                length -= static_cast<size_t>(written);
+            }
+        }
+        buffer.clear();
+    }
+
+    int fd;
+    vector<char> buffer;
+    uint64_t offset;
+    uint32_t crc;
+    bool ok;
+};
+} // namespace
+
+bool writeSnapshotFile(const string &path, span<const SnapshotEntry> accounts, uint64_t journal_position)
+{
+    string temporary_path = path + ".tmp";
+    int fd = ::open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.journal_position = journal_position;
+    header.num_accounts = accounts.size();
+    header.index_capacity = uint64_t(1) << log2Of(max<uint64_t>(MIN_INDEX_CAPACITY, (accounts.size() * 4 + 2) / 3));
+
+    // The header goes in last, once the section checksums are known
+    SectionWriter writer(fd);
+    writer.append(&header, sizeof(header));
+    header.accounts_offset = writer.beginSection();
+    uint64_t owner_offset = 0;
+    uint64_t first_transaction = 0;
+    for (const SnapshotEntry &entry : accounts)
+    {
+        SnapshotAccount account = {entry.account_number, static_cast<uint32_t>(entry.owner.size()), owner_offset,
+                                   entry.balance.minorUnits(), first_transaction, entry.num_transactions};
+        writer.append(&account, sizeof(account));
+        owner_offset += entry.owner.size();
+        first_transaction += entry.num_transactions;
+    }
+    header.accounts_crc = writer.sectionCrc();
+    header.num_transactions = first_transaction;
+    header.owners_size = owner_offset;
+
+    // Built at 3/4 load at most, so every probe sequence ends at an empty entry
+    vector<SnapshotIndexEntry> index(header.index_capacity, SnapshotIndexEntry{0, -1});
+    unsigned bits = log2Of(header.index_capacity);
+    size_t mask = header.index_capacity - 1;
+    for (size_t slot = 0; slot < accounts.size(); ++slot)
+    {
+        size_t i = homeSlot(accounts[slot].account_number, bits);
+        while (index[i].slot != -1)
+        {
+            i = (i + 1) & mask;
+        }
+        index[i] = SnapshotIndexEntry{accounts[slot].account_number, static_cast<int32_t>(slot)};
+    }
+    header.index_offset = writer.beginSection();
+    writer.append(index.data(), index.size() * sizeof(SnapshotIndexEntry));
+    header.index_crc = writer.sectionCrc();
+    index = vector<SnapshotIndexEntry>();
+
+    header.transactions_offset = writer.beginSection();
+    for (const SnapshotEntry &entry : accounts)
+    {
+        entry.transactions->forEachRun(entry.num_transactions, [&writer](const Transaction *records, size_t n) {
+            writer.append(records, n * sizeof(Transaction));
+        });
+    }
+    header.transactions_crc = writer.sectionCrc();
+
+    header.owners_offset = writer.beginSection();
+    for (const SnapshotEntry &entry : accounts)
+    {
+        writer.append(entry.owner.data(), entry.owner.size());
+    }
+    header.owners_crc = writer.sectionCrc();
+    header.header_crc = headerCrc(header);
+
+    bool ok = writer.finish() && pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+              fdatasync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        unlink(temporary_path.c_str());
+        return false;
+    }
+    // Until the directory is synced a crash can still bring back the old file
+    return syncParentDirectory(path);
+}
+
+unique_ptr<SnapshotView> SnapshotView::open(const string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(SnapshotHeader))
+    {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t length = static_cast<size_t>(status.st_size);
+    void *base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    const SnapshotHeader &header = *static_cast<const SnapshotHeader *>(base);
+    auto fits = [length](uint64_t offset, uint64_t count, uint64_t size) {
+        return offset <= length && count <= (length - offset) / size;
+    };
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.header_crc != headerCrc(header) || (header.index_capacity & (header.index_capacity - 1)) != 0 ||
+        header.index_capacity < MIN_INDEX_CAPACITY || header.num_accounts > header.index_capacity ||
+        !fits(header.accounts_offset, header.num_accounts, sizeof(SnapshotAccount)) ||
+        !fits(header.index_offset, header.index_capacity, sizeof(SnapshotIndexEntry)) ||
+        !fits(header.transactions_offset, header.num_transactions, sizeof(Transaction)) ||
+        !fits(header.owners_offset, header.owners_size, 1) ||
+        // Checked once the sizes are known to fit in the file, so this cannot overflow
+        header.index_capacity * 3 < header.num_accounts * 4)
+    {
+        munmap(base, length);
+        return nullptr;
+    }
+    // Lookups hop around the index and account table
+    madvise(base, length, MADV_RANDOM);
+    return unique_ptr<SnapshotView>(new SnapshotView(static_cast<const char *>(base), length));
+}
+
+SnapshotView::SnapshotView(const char *base, size_t length)
+    : base(base), length(length), header(reinterpret_cast<const SnapshotHeader *>(base)),
+      account_table(reinterpret_cast<const SnapshotAccount *>(base + header->accounts_offset)),
+      index(reinterpret_cast<const SnapshotIndexEntry *>(base + header->index_offset)),
+      transaction_table(reinterpret_cast<const Transaction *>(base + header->transactions_offset)),
+      owners(base + header->owners_offset)
+{
+}
+
+SnapshotView::~SnapshotView()
+{
+    munmap(const_cast<char *>(base), length);
+}
+
+bool SnapshotView::verify() const
+{
+    if (crc32c(account_table, header->num_accounts * sizeof(SnapshotAccount)) != header->accounts_crc ||
+        crc32c(index, header->index_capacity * sizeof(SnapshotIndexEntry)) != header->index_crc ||
+        crc32c(transaction_table, header->num_transactions * sizeof(Transaction)) != header->transactions_crc ||
+        crc32c(owners, header->owners_size) != header->owners_crc)
+    {
+        return false;
+    }
+    // Checksums catch corruption; these catch a well-formed file whose tables disagree
+    for (const SnapshotAccount &account : accounts())
+    {
+        if (account.owner_offset > header->owners_size ||
+            account.owner_length > header->owners_size - account.owner_offset ||
+            account.first_transaction > header->num_transactions ||
+            account.num_transactions > header->num_transactions - account.first_transaction)
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < header->index_capacity; ++i)
+    {
+        if (index[i].slot < -1 || (index[i].slot >= 0 && static_cast<uint64_t>(index[i].slot) >= header->num_accounts))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const SnapshotAccount *SnapshotView::find(int account_number) const
+{
+    // open checks only the header, so a corrupt index must not send the probe past the
+    // account table or around the table forever
+    unsigned bits = log2Of(header->index_capacity);
+    size_t mask = header->index_capacity - 1;
+    size_t i = homeSlot(account_number, bits);
+    for (size_t probes = 0; probes < header->index_capacity; ++probes, i = (i + 1) & mask)
+    {
+        const SnapshotIndexEntry &entry = index[i];
+        if (entry.slot == -1)
+        {
+            return nullptr;
+        }
+        if (entry.account_number == account_number)
+        {
+            bool in_table = entry.slot >= 0 && static_cast<uint64_t>(entry.slot) < header->num_accounts;
+            return in_table ? &account_table[entry.slot] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+string_view SnapshotView::owner(const SnapshotAccount &account) const
+{
+    return string_view(owners + account.owner_offset, account.owner_length);
+}
+
+span<const Transaction> SnapshotView::transactions(const SnapshotAccount &account) const
+{
+    return span<const Transaction>(transaction_table + account.first_transaction, account.num_transactions);
+}
@@ -0,0 +1,118 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "money.h"
+#include "transaction.h"
+#include "transaction_log.h"
+
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+// On-disk layout of a snapshot file (native little-endian). The header is followed by
+// four back-to-back sections, each covered by its own CRC-32C:
+//   accounts      SnapshotAccount[num_accounts]
+//   index         SnapshotIndexEntry[index_capacity], open addressing on account number
+//   transactions  Transaction[num_transactions], each account's history contiguous
+//   owners        owner names, concatenated without terminators
+// Everything is fixed-size and position-independent, so a mapped file is usable as is.
+// Every record size is a multiple of 8, so each section stays 8-byte aligned without
+// padding and every byte of the file is checked.
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_crc;       // CRC-32C of the header with this field set to zero
+    uint64_t journal_position; // journal records up to here are already reflected
+    uint64_t num_accounts;
+    uint64_t num_transactions;
+    uint64_t index_capacity;   // power of two
+    uint64_t accounts_offset;
+    uint64_t index_offset;
+    uint64_t transactions_offset;
+    uint64_t owners_offset;
+    uint64_t owners_size;
+    uint32_t accounts_crc;
+    uint32_t index_crc;
+    uint32_t transactions_crc;
+    uint32_t owners_crc;
+};
+
+struct SnapshotAccount
+{
+    int32_t account_number;
+    uint32_t owner_length;
+    uint64_t owner_offset; // into the owners section
+    int64_t balance;       // minor units
+    uint64_t first_transaction;
+    uint64_t num_transactions;
+};
+
+struct SnapshotIndexEntry
+{
+    int32_t account_number;
+    int32_t slot; // position in the accounts section, or -1 for an empty entry
+};
+
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "SnapshotHeader must keep the sections aligned");
+static_assert(sizeof(SnapshotAccount) == 40, "SnapshotAccount must match the on-disk layout");
+static_assert(sizeof(SnapshotIndexEntry) == 8, "SnapshotIndexEntry must match the on-disk layout");
+
+// One account as captured for writing; the history is read from the live log
+struct SnapshotEntry
+{
+    int32_t account_number;
+    std::string_view owner;
+    Money balance;
+    const TransactionLog *transactions;
+    std::size_t num_transactions; // records of transactions to include
+};
+
+// Writes a snapshot of accounts to path. The file is written beside path, synced and then
+// renamed over it, so readers only ever see a complete snapshot. Returns false on I/O errors.
+bool writeSnapshotFile(const std::string &path, std::span<const SnapshotEntry> accounts, uint64_t journal_position);
+
+// Read-only view of a snapshot file mapped into memory. Opening only checks the header,
+// so it takes the same time for any size of bank; pages are read from disk as lookups
+// touch them.
+class SnapshotView
+{
+public:
+    // Returns null if the file cannot be mapped or its header is not a valid snapshot
+    static std::unique_ptr<SnapshotView> open(const std::string &path);
+
+    ~SnapshotView();
+    SnapshotView(const SnapshotView &) = delete;
+    SnapshotView &operator=(const SnapshotView &) = delete;
+
+    // Checks every section against its checksum; reads the whole file
+    bool verify() const;
+
+    std::size_t size() const { return header->num_accounts; }
+    uint64_t journalPosition() const { return header->journal_position; }
+
+    // Returns the account, or null if the snapshot does not contain it
+    const SnapshotAccount *find(int account_number) const;
+    std::span<const SnapshotAccount> accounts() const { return {account_table, header->num_accounts}; }
+    std::string_view owner(const SnapshotAccount &account) const;
+    Money balance(const SnapshotAccount &account) const { return Money::fromMinorUnits(account.balance); }
+    std::span<const Transaction> transactions(const SnapshotAccount &account) const;
+
+private:
+    SnapshotView(const char *base, std::size_t length);
+
+    const char *base;
+    std::size_t length;
+    const SnapshotHeader *header;
+    const SnapshotAccount *account_table;
+    const SnapshotIndexEntry *index;
+    const Transaction *transaction_table;
+    const char *owners;
+};
+
+#endif /* SNAPSHOT_H */
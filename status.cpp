@@ -0,0 +1,63 @@
+#include "status.h"
+
+using namespace std;
+
+const char *statusMessage(Status status)
+{
+    switch (status)
+    {
+    case Status::Ok:
+        return "OK.";
+    case Status::AccountNotFound:
+        return "Error: Account not found.";
+    case Status::AccountExists:
+        return "Error: Account already exists.";
+    case Status::TooManyAccounts:
+        return "Error: Maximum number of accounts reached.";
+    case Status::InvalidAmount:
+        return "Error: Invalid amount.";
+    case Status::InsufficientFunds:
+        return "Error: Insufficient funds.";
+    case Status::JournalFailed:
+        return "Error: Could not write the journal.";
+    case Status::Conflict:
+        return "Error: An account changed during the transaction.";
+    case Status::TooManyLegs:
+        return "Error: Too many legs in one transaction.";
+    case Status::OwnerTooLong:
+        return "Error: Owner name is too long.";
+    case Status::InvalidAccount:
+        return "Error: Invalid account number.";
+    }
+    return "Error: Unknown status.";
+}
+
+const char *statusName(Status status)
+{
+    switch (status)
+    {
+    case Status::Ok:
+        return "ok";
+    case Status::AccountNotFound:
+        return "account_not_found";
+    case Status::AccountExists:
+        return "account_exists";
+    case Status::TooManyAccounts:
+        return "too_many_accounts";
+    case Status::InvalidAmount:
+        return "invalid_amount";
+    case Status::InsufficientFunds:
+        return "insufficient_funds";
+    case Status::JournalFailed:
+        return "journal_failed";
+    case Status::Conflict:
+        return "conflict";
+    case Status::TooManyLegs:
+        return "too_many_legs";
+    case Status::OwnerTooLong:
+        return "owner_too_long";
+    case Status::InvalidAccount:
+        return "invalid_account";
+    }
+    return "unknown";
+}
@@ -0,0 +1,30 @@
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Outcome of a single operation
+enum class Status : uint8_t
+{
+    Ok,
+    AccountNotFound,
+    AccountExists,
+    TooManyAccounts,
+    InvalidAmount,
+    InsufficientFunds,
+    JournalFailed, // the change was applied in memory but could not be made durable
+    Conflict,      // an account a transaction read has changed since; retry it
+    TooManyLegs,
+    OwnerTooLong,   // longer than MAX_OWNER_LENGTH
+    InvalidAccount, // NO_COUNTERPARTY, reserved for postings without a counterparty
+};
+
+constexpr std::size_t NUM_STATUSES = static_cast<std::size_t>(Status::InvalidAccount) + 1;
+
+// Human-readable error message for a failed status, e.g. "Error: Account not found."
+const char *statusMessage(Status status);
+// Short snake_case name, e.g. "account_not_found", for machine-readable output
+const char *statusName(Status status);
+
+#endif /* STATUS_H */
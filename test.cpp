@@ -1,14 +1,53 @@
 #include <deepstate/DeepState.hpp>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_bank.h"
+#include "bank_client.h"
+#include "bank_server.h"
 #include "banking_system.h"
+#include "bulk_io.h"
+#include "checksum.h"
+#include "sharded_bank.h"
+#include "worker_pool.h"
+#include "workload.h"
 
 using namespace deepstate;
 
+// Account numbers drawn by the tests fall in [1, MAX_ACCOUNTS]
+constexpr int MAX_ACCOUNTS = 100;
+
+// Fresh file path under the system temporary directory, removed if it already exists
+static std::string temporaryPath(const std::string &name)
+{
+    std::filesystem::path path =
+        std::filesystem::temp_directory_path() / (name + "." + std::to_string(getpid()));
+    std::filesystem::remove(path);
+    return path.string();
+}
+
 TEST(BankingSystemPropertyTest, AccountCreation)
 {
     BankingSystem bankingSystem;
     int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
     std::string owner_name = DeepState_CStrUpToLen(MAX_NAME_LENGTH);
-    double initial_balance = DeepState_DoubleInRange(1.0, 1000.0);
+    Money initial_balance = Money::fromDouble(DeepState_DoubleInRange(1.0, 1000.0));
     bankingSystem.createAccount(account_number, owner_name, initial_balance);
 
     Account *account = bankingSystem.findAccount(account_number);
@@ -21,28 +60,28 @@ TEST(BankingSystemPropertyTest, Deposit)
 {
     BankingSystem bankingSystem;
     int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
-    double initial_balance = DeepState_DoubleInRange(1.0, 1000.0);
-    double deposit_amount = DeepState_DoubleInRange(1.0, 100.0);
+    Money initial_balance = Money::fromDouble(DeepState_DoubleInRange(1.0, 1000.0));
+    Money deposit_amount = Money::fromDouble(DeepState_DoubleInRange(1.0, 100.0));
     bankingSystem.createAccount(account_number, "TestOwner", initial_balance);
     bankingSystem.deposit(account_number, deposit_amount);
 
     Account *account = bankingSystem.findAccount(account_number);
     ASSERT(account != nullptr);
-    ASSERT_EQ(account->balance, initial_balance + deposit_amount);
+    ASSERT_EQ(account->balance, *initial_balance.checkedAdd(deposit_amount));
 }
 
 TEST(BankingSystemPropertyTest, Withdrawal)
 {
     BankingSystem bankingSystem;
     int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
-    double initial_balance = DeepState_DoubleInRange(100.0, 1000.0);
-    double withdraw_amount = DeepState_DoubleInRange(1.0, initial_balance);
+    Money initial_balance = Money::fromDouble(DeepState_DoubleInRange(100.0, 1000.0));
+    Money withdraw_amount = Money::fromDouble(DeepState_DoubleInRange(1.0, initial_balance.toDouble()));
     bankingSystem.createAccount(account_number, "TestOwner", initial_balance);
     bankingSystem.withdraw(account_number, withdraw_amount);
 
     Account *account = bankingSystem.findAccount(account_number);
     ASSERT(account != nullptr);
-    ASSERT_EQ(account->balance, initial_balance - withdraw_amount);
+    ASSERT_EQ(account->balance, *initial_balance.checkedSubtract(withdraw_amount));
 }
 
 TEST(BankingSystemPropertyTest, Transfer)
@@ -50,8 +89,8 @@ TEST(BankingSystemPropertyTest, Transfer)
     BankingSystem bankingSystem;
     int source_account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
     int dest_account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
-    double initial_balance = DeepState_DoubleInRange(100.0, 1000.0);
-    double transfer_amount = DeepState_DoubleInRange(1.0, initial_balance);
+    Money initial_balance = Money::fromDouble(DeepState_DoubleInRange(100.0, 1000.0));
+    Money transfer_amount = Money::fromDouble(DeepState_DoubleInRange(1.0, initial_balance.toDouble()));
     bankingSystem.createAccount(source_account_number, "SourceOwner", initial_balance);
     bankingSystem.createAccount(dest_account_number, "DestOwner", initial_balance);
     bankingSystem.transfer(source_account_number, dest_account_number, transfer_amount);
@@ -60,16 +99,16 @@ TEST(BankingSystemPropertyTest, Transfer)
     Account *dest_account = bankingSystem.findAccount(dest_account_number);
     ASSERT(source_account != nullptr);
     ASSERT(dest_account != nullptr);
-    ASSERT_EQ(source_account->balance, initial_balance - transfer_amount);
-    ASSERT_EQ(dest_account->balance, initial_balance + transfer_amount);
+    ASSERT_EQ(source_account->balance, *initial_balance.checkedSubtract(transfer_amount));
+    ASSERT_EQ(dest_account->balance, *initial_balance.checkedAdd(transfer_amount));
 }
 
 TEST(BankingSystemPropertyTest, InvalidWithdrawal)
 {
     BankingSystem bankingSystem;
     int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
-    double initial_balance = DeepState_DoubleInRange(1.0, 100.0);
-    double withdraw_amount = DeepState_DoubleInRange(initial_balance + 1.0, 1000.0);
+    Money initial_balance = Money::fromDouble(DeepState_DoubleInRange(1.0, 100.0));
+    Money withdraw_amount = Money::fromDouble(DeepState_DoubleInRange(initial_balance.toDouble() + 1.0, 1000.0));
     bankingSystem.createAccount(account_number, "TestOwner", initial_balance);
     bankingSystem.withdraw(account_number, withdraw_amount);
 
@@ -82,8 +121,8 @@ TEST(BankingSystemPropertyTest, InvalidTransfer)
     BankingSystem bankingSystem;
     int source_account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
     int dest_account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
-    double initial_balance = DeepState_DoubleInRange(1.0, 100.0);
-    double transfer_amount = DeepState_DoubleInRange(initial_balance + 1.0, 1000.0);
+    Money initial_balance = Money::fromDouble(DeepState_DoubleInRange(1.0, 100.0));
+    Money transfer_amount = Money::fromDouble(DeepState_DoubleInRange(initial_balance.toDouble() + 1.0, 1000.0));
     bankingSystem.createAccount(source_account_number, "SourceOwner", initial_balance);
     bankingSystem.createAccount(dest_account_number, "DestOwner", initial_balance);
     bankingSystem.transfer(source_account_number, dest_account_number, transfer_amount);
@@ -96,10 +135,2117 @@ TEST(BankingSystemPropertyTest, AccountDeletion)
 {
     BankingSystem bankingSystem;
     int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
-    double initial_balance = DeepState_DoubleInRange(1.0, 100.0);
+    Money initial_balance = Money::fromDouble(DeepState_DoubleInRange(1.0, 100.0));
     bankingSystem.createAccount(account_number, "TestOwner", initial_balance);
     bankingSystem.deleteAccount(account_number);
 
     Account *account = bankingSystem.findAccount(account_number);
     ASSERT(account == nullptr); // Account should not exist after deletion
 }
+
+TEST(BankingSystemPropertyTest, DuplicateAccountRejected)
+{
+    BankingSystem bankingSystem;
+    int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
+    Money first_balance = Money::fromDouble(DeepState_DoubleInRange(1.0, 100.0));
+    Money second_balance = Money::fromDouble(DeepState_DoubleInRange(200.0, 300.0));
+    bankingSystem.createAccount(account_number, "FirstOwner", first_balance);
+    bankingSystem.createAccount(account_number, "SecondOwner", second_balance);
+
+    Account *account = bankingSystem.findAccount(account_number);
+    ASSERT(account != nullptr);
+    ASSERT_EQ(account->owner, "FirstOwner");
+    ASSERT_EQ(account->balance, first_balance);
+}
+
+TEST(BankingSystemPropertyTest, LookupAfterDeletion)
+{
+    BankingSystem bankingSystem;
+    int num_created = DeepState_IntInRange(2, MAX_ACCOUNTS);
+    for (int i = 1; i <= num_created; ++i)
+    {
+        bankingSystem.createAccount(i, "Owner", Money::fromUnits(i));
+    }
+    int deleted = DeepState_IntInRange(1, num_created);
+    bankingSystem.deleteAccount(deleted);
+
+    for (int i = 1; i <= num_created; ++i)
+    {
+        Account *account = bankingSystem.findAccount(i);
+        if (i == deleted)
+        {
+            ASSERT(account == nullptr);
+        }
+        else
+        {
+            ASSERT(account != nullptr);
+            ASSERT_EQ(account->account_number, i);
+            ASSERT_EQ(account->balance, Money::fromUnits(i));
+        }
+    }
+}
+
+TEST(AccountIndexPropertyTest, MatchesReferenceMap)
+{
+    AccountIndex index;
+    std::map<int, int32_t> reference;
+    int num_operations = DeepState_IntInRange(1, 2000);
+    for (int i = 0; i < num_operations; ++i)
+    {
+        int account_number = DeepState_IntInRange(-64, 256);
+        if (DeepState_Bool())
+        {
+            bool inserted = index.insert(account_number, i);
+            ASSERT_EQ(inserted, reference.emplace(account_number, i).second);
+        }
+        else
+        {
+            ASSERT_EQ(index.erase(account_number), reference.erase(account_number) == 1);
+        }
+    }
+
+    ASSERT_EQ(index.size(), reference.size());
+    for (int account_number = -64; account_number <= 256; ++account_number)
+    {
+        auto it = reference.find(account_number);
+        ASSERT_EQ(index.find(account_number), it == reference.end() ? AccountIndex::NOT_FOUND : it->second);
+    }
+}
+
+TEST(BankingSystemPropertyTest, OwnerSearchMatchesScan)
+{
+    const char *names[] = {"Alice", "alice", "ALICE", "Alicia", "Al", "Bob", "bobby", "Carol", ""};
+    const OwnerMatch matches[] = {OwnerMatch::Exact, OwnerMatch::IgnoreCase, OwnerMatch::Prefix,
+                                  OwnerMatch::PrefixIgnoreCase};
+    BankingSystem bank;
+    std::map<int, std::string> reference;
+    int num_operations = DeepState_IntInRange(1, 500);
+    for (int i = 0; i < num_operations; ++i)
+    {
+        int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
+        std::string owner = names[DeepState_IntInRange(0, 8)];
+        if (DeepState_Bool())
+        {
+            if (bank.createAccount(account_number, owner, Money()) == Status::Ok)
+            {
+                reference.emplace(account_number, owner);
+            }
+        }
+        else if (bank.deleteAccount(account_number) == Status::Ok)
+        {
+            reference.erase(account_number);
+        }
+    }
+
+    auto fold = [](std::string name) {
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        return name;
+    };
+    for (const char *query : names)
+    {
+        for (OwnerMatch match : matches)
+        {
+            std::vector<int32_t> expected;
+            for (const auto &[account_number, owner] : reference)
+            {
+                bool ignore_case = match == OwnerMatch::IgnoreCase || match == OwnerMatch::PrefixIgnoreCase;
+                bool prefix = match == OwnerMatch::Prefix || match == OwnerMatch::PrefixIgnoreCase;
+                std::string name = ignore_case ? fold(owner) : owner;
+                std::string wanted = ignore_case ? fold(query) : std::string(query);
+                if (prefix ? name.starts_with(wanted) : name == wanted)
+                {
+                    expected.push_back(account_number);
+                }
+            }
+            ASSERT(bank.findAccountsByOwner(query, match) == expected);
+        }
+    }
+}
+
+TEST(BankingSystemPropertyTest, GrowsPastOneHundredAccounts)
+{
+    BankingSystem bankingSystem;
+    int num_created = DeepState_IntInRange(101, 5000);
+    for (int i = 1; i <= num_created; ++i)
+    {
+        bankingSystem.createAccount(i, "Owner", Money::fromUnits(i));
+    }
+    ASSERT_EQ(bankingSystem.accounts.size(), static_cast<size_t>(num_created));
+
+    int probe = DeepState_IntInRange(1, num_created);
+    Account *account = bankingSystem.findAccount(probe);
+    ASSERT(account != nullptr);
+    ASSERT_EQ(account->balance, Money::fromUnits(probe));
+}
+
+TEST(SlabStorePropertyTest, HandlesStayStableAndSlotsAreReused)
+{
+    SlabStore<std::string, 16> store;
+    std::map<int32_t, std::string> reference;
+    size_t peak = 0;
+    int num_operations = DeepState_IntInRange(1, 500);
+    for (int i = 0; i < num_operations; ++i)
+    {
+        if (reference.empty() || DeepState_Bool())
+        {
+            std::string value = std::to_string(i);
+            int32_t handle = store.allocate(value);
+            ASSERT(reference.find(handle) == reference.end());
+            reference[handle] = value;
+        }
+        else
+        {
+            auto it = reference.begin();
+            std::advance(it, DeepState_IntInRange(0, static_cast<int>(reference.size()) - 1));
+            store.release(it->first);
+            reference.erase(it);
+        }
+        // A free slot is always reused before the store grows
+        peak = std::max(peak, reference.size());
+        ASSERT_LE(store.capacity(), ((peak + 15) / 16) * 16);
+    }
+
+    ASSERT_EQ(store.size(), reference.size());
+    for (const auto &entry : reference)
+    {
+        ASSERT(store.isLive(entry.first));
+        ASSERT_EQ(store[entry.first], entry.second);
+    }
+}
+
+TEST(BankingSystemPropertyTest, HistoryIsUnbounded)
+{
+    BankingSystem bankingSystem;
+    int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
+    int num_deposits = DeepState_IntInRange(1, 1000);
+    bankingSystem.createAccount(account_number, "TestOwner", Money());
+    for (int i = 1; i <= num_deposits; ++i)
+    {
+        bankingSystem.deposit(account_number, Money::fromUnits(i));
+    }
+
+    Account *account = bankingSystem.findAccount(account_number);
+    ASSERT(account != nullptr);
+    ASSERT_EQ(account->transactions.size(), static_cast<size_t>(num_deposits));
+    int expected = 1;
+    account->transactions.forEach([&expected](const Transaction &transaction) {
+        ASSERT_EQ(transaction.amount, Money::fromUnits(expected));
+        ASSERT_EQ(transaction.sequence, static_cast<uint32_t>(expected - 1));
+        ASSERT(transaction.type == TransactionType::Deposit);
+        expected++;
+    });
+    ASSERT_EQ(expected, num_deposits + 1);
+}
+
+TEST(BankingSystemPropertyTest, DeletedHistorySegmentsAreRecycled)
+{
+    BankingSystem bankingSystem;
+    int num_deposits = DeepState_IntInRange(1, 200);
+    bankingSystem.createAccount(1, "First", Money());
+    for (int i = 0; i < num_deposits; ++i)
+    {
+        bankingSystem.deposit(1, Money::fromUnits(1));
+    }
+    size_t segments = bankingSystem.transaction_arena.segmentsInUse();
+    size_t reserved = bankingSystem.transaction_arena.bytesReserved();
+    bankingSystem.deleteAccount(1);
+    ASSERT_EQ(bankingSystem.transaction_arena.segmentsInUse(), 0u);
+
+    bankingSystem.createAccount(2, "Second", Money());
+    for (int i = 0; i < num_deposits; ++i)
+    {
+        bankingSystem.deposit(2, Money::fromUnits(1));
+    }
+    ASSERT_EQ(bankingSystem.transaction_arena.segmentsInUse(), segments);
+    ASSERT_EQ(bankingSystem.transaction_arena.bytesReserved(), reserved);
+}
+
+TEST(BankingSystemPropertyTest, TransferRecordsCounterparties)
+{
+    BankingSystem bankingSystem;
+    int source_account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
+    int dest_account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
+    ASSUME_NE(source_account_number, dest_account_number);
+    Money transfer_amount = Money::fromUnits(DeepState_IntInRange(1, 100));
+    bankingSystem.createAccount(source_account_number, "SourceOwner", Money::fromUnits(100));
+    bankingSystem.createAccount(dest_account_number, "DestOwner", Money::fromUnits(100));
+    bankingSystem.transfer(source_account_number, dest_account_number, transfer_amount);
+
+    Transaction sent{};
+    Transaction received{};
+    bankingSystem.findAccount(source_account_number)->transactions.forEach([&sent](const Transaction &t) { sent = t; });
+    bankingSystem.findAccount(dest_account_number)->transactions.forEach([&received](const Transaction &t) { received = t; });
+    ASSERT(sent.type == TransactionType::TransferOut);
+    ASSERT(received.type == TransactionType::TransferIn);
+    ASSERT_EQ(sent.counterparty, dest_account_number);
+    ASSERT_EQ(received.counterparty, source_account_number);
+    ASSERT_EQ(sent.amount, transfer_amount);
+    ASSERT_EQ(received.amount, sent.amount);
+    ASSERT_EQ(sent.timestamp, received.timestamp);
+    ASSERT_EQ(std::string(transactionTypeName(sent.type)), "Transfer (to)");
+    ASSERT_EQ(std::string(transactionTypeName(received.type)), "Transfer (from)");
+
+    // Account 0 is an account like any other, told apart from postings without a counterparty
+    bankingSystem.createAccount(0, "ZeroOwner", Money::fromUnits(100));
+    bankingSystem.transfer(0, source_account_number, transfer_amount);
+    bankingSystem.deposit(source_account_number, transfer_amount);
+    std::vector<Transaction> history;
+    bankingSystem.findAccount(source_account_number)->transactions.forEach(
+        [&history](const Transaction &t) { history.push_back(t); });
+    ASSERT(history[history.size() - 2].type == TransactionType::TransferIn);
+    ASSERT_EQ(history[history.size() - 2].counterparty, 0);
+    ASSERT_EQ(history.back().counterparty, NO_COUNTERPARTY);
+    ASSERT(bankingSystem.createAccount(NO_COUNTERPARTY, "Nobody", Money()) == Status::InvalidAccount);
+    ASSERT(bankingSystem.findAccount(NO_COUNTERPARTY) == nullptr);
+}
+
+TEST(BankingSystemPropertyTest, HistoryPagesMatchFilteredScan)
+{
+    BankingSystem bankingSystem;
+    bankingSystem.createAccount(1, "Owner", Money());
+    Account *account = bankingSystem.findAccount(1);
+    // Posted straight to the history so timestamps and types can be anything
+    auto appendRandom = [&bankingSystem, account](int count) {
+        for (int i = 0; i < count; ++i)
+        {
+            account->transactions.append(bankingSystem.transaction_arena,
+                                         static_cast<TransactionType>(DeepState_IntInRange(0, 6)),
+                                         Money::fromUnits(DeepState_IntInRange(-50, 50)), NO_COUNTERPARTY,
+                                         static_cast<uint32_t>(DeepState_IntInRange(0, 100)));
+        }
+    };
+    appendRandom(DeepState_IntInRange(0, 200));
+    std::size_t initial_size = account->transactions.size();
+
+    HistoryQuery query;
+    query.newest_first = DeepState_Bool();
+    query.from_timestamp = static_cast<uint32_t>(DeepState_IntInRange(0, 100));
+    query.to_timestamp = static_cast<uint32_t>(DeepState_IntInRange(0, 100));
+    query.types = static_cast<uint32_t>(DeepState_IntInRange(0, 127));
+    if (DeepState_Bool())
+    {
+        query.min_amount = Money::fromUnits(DeepState_IntInRange(-50, 50));
+    }
+    if (DeepState_Bool())
+    {
+        query.max_amount = Money::fromUnits(DeepState_IntInRange(-50, 50));
+    }
+    query.limit = DeepState_IntInRange(1, 40);
+
+    // Page through the history; oldest first, new records keep arriving between pages
+    std::vector<uint32_t> paged;
+    HistoryPage page;
+    do
+    {
+        page = bankingSystem.queryHistory(1, query, [&paged, &query](std::span<const Transaction> run) {
+            for (std::size_t i = 0; i < run.size(); ++i)
+            {
+                paged.push_back(run[query.newest_first ? run.size() - 1 - i : i].sequence);
+            }
+        });
+        ASSERT(page.status == Status::Ok);
+        ASSERT(page.count <= query.limit);
+        query.cursor = page.cursor;
+        if (!page.at_end && DeepState_Bool())
+        {
+            appendRandom(DeepState_IntInRange(1, 20));
+        }
+    } while (!page.at_end);
+
+    std::vector<uint32_t> expected;
+    std::size_t scanned = 0;
+    account->transactions.forEach([&](const Transaction &transaction) {
+        bool in_view = query.newest_first ? scanned < initial_size : true;
+        scanned++;
+        if (in_view && transaction.timestamp >= query.from_timestamp && transaction.timestamp <= query.to_timestamp &&
+            (query.types & transactionTypeBit(transaction.type)) != 0 &&
+            (!query.min_amount || transaction.amount >= *query.min_amount) &&
+            (!query.max_amount || transaction.amount <= *query.max_amount))
+        {
+            expected.push_back(transaction.sequence);
+        }
+    });
+    if (query.newest_first)
+    {
+        std::reverse(expected.begin(), expected.end());
+    }
+    ASSERT(paged == expected);
+    ASSERT(bankingSystem.queryHistory(2, query, [](std::span<const Transaction>) {}).status == Status::AccountNotFound);
+}
+
+TEST(MoneyPropertyTest, CheckedArithmeticDetectsOverflow)
+{
+    int64_t a = DeepState_Int64InRange(INT64_MIN / 2, INT64_MAX / 2);
+    int64_t b = DeepState_Int64InRange(INT64_MIN / 2, INT64_MAX / 2);
+    ASSERT_EQ(Money::fromMinorUnits(a).checkedAdd(Money::fromMinorUnits(b))->minorUnits(), a + b);
+    ASSERT_EQ(Money::fromMinorUnits(a).checkedSubtract(Money::fromMinorUnits(b))->minorUnits(), a - b);
+
+    Money largest = Money::fromMinorUnits(INT64_MAX);
+    ASSERT(!largest.checkedAdd(Money::fromMinorUnits(1)));
+    ASSERT(!Money::fromMinorUnits(INT64_MIN).checkedSubtract(Money::fromMinorUnits(1)));
+    ASSERT(!largest.checkedScale(2, 1));
+}
+
+TEST(MoneyPropertyTest, RoundingModes)
+{
+    // 2.5, 3.5 and -2.5 minor units, scaled by 1/10 from 25, 35 and -25
+    ASSERT_EQ(Money::fromMinorUnits(25).checkedScale(1, 10, RoundingMode::HalfEven)->minorUnits(), 2);
+    ASSERT_EQ(Money::fromMinorUnits(35).checkedScale(1, 10, RoundingMode::HalfEven)->minorUnits(), 4);
+    ASSERT_EQ(Money::fromMinorUnits(-25).checkedScale(1, 10, RoundingMode::HalfEven)->minorUnits(), -2);
+    ASSERT_EQ(Money::fromMinorUnits(25).checkedScale(1, 10, RoundingMode::HalfUp)->minorUnits(), 3);
+    ASSERT_EQ(Money::fromMinorUnits(-25).checkedScale(1, 10, RoundingMode::HalfUp)->minorUnits(), -3);
+    ASSERT_EQ(Money::fromMinorUnits(-29).checkedScale(1, 10, RoundingMode::Down)->minorUnits(), -2);
+    ASSERT_EQ(Money::fromMinorUnits(-21).checkedScale(1, 10, RoundingMode::Floor)->minorUnits(), -3);
+    ASSERT_EQ(Money::fromMinorUnits(21).checkedScale(1, 10, RoundingMode::Ceiling)->minorUnits(), 3);
+    ASSERT_EQ(Money::fromDouble(0.125, RoundingMode::HalfEven).minorUnits(), 12);
+    ASSERT_EQ(Money::fromDouble(0.125, RoundingMode::HalfUp).minorUnits(), 13);
+}
+
+TEST(BankingSystemPropertyTest, InterestIsExact)
+{
+    BankingSystem bankingSystem;
+    int64_t initial_minor = DeepState_Int64InRange(0, 100000000000LL);
+    int rate_basis_points = DeepState_IntInRange(0, 2000);
+    bankingSystem.createAccount(1, "TestOwner", Money::fromMinorUnits(initial_minor));
+    bankingSystem.calculateInterest(rate_basis_points / 10000.0);
+
+    // balance * (1 + rate), rounded half to even, computed independently in integers
+    Money expected = *Money::fromMinorUnits(initial_minor).checkedScale(10000 + rate_basis_points, 10000);
+    ASSERT_EQ(bankingSystem.findAccount(1)->balance, expected);
+
+    // Rates that are not finite or are out of range change nothing; one below -1 would
+    // otherwise turn the balance negative
+    double bad_rates[] = {std::nan(""), INFINITY, -INFINITY, 2 * MAX_INTEREST_RATE, MIN_INTEREST_RATE - 0.5, -2.0};
+    for (double rate : bad_rates)
+    {
+        ASSERT(bankingSystem.calculateInterest(rate) == Status::InvalidAmount);
+        double tier_rates[] = {0.01, rate};
+        ASSERT(bankingSystem.calculateInterest(tier_rates) == Status::InvalidAmount);
+    }
+    ASSERT_EQ(bankingSystem.findAccount(1)->balance, expected);
+    ASSERT(bankingSystem.calculateInterest(MIN_INTEREST_RATE) == Status::Ok);
+    ASSERT_EQ(bankingSystem.findAccount(1)->balance, Money());
+}
+
+TEST(InterestKernelTest, KernelsMatchCheckedScale)
+{
+    RateTable rates;
+    for (int64_t &rate : rates.rates)
+    {
+        rate = DeepState_Int64InRange(-2 * RATE_SCALE, RATE_SCALE);
+    }
+    // Balances of every magnitude, so both the exact vector path and the fallback are hit
+    size_t count = DeepState_IntInRange(0, 200);
+    std::vector<int64_t> balances(count);
+    std::vector<uint8_t> tiers(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        int bits = DeepState_IntInRange(0, 62);
+        balances[i] = DeepState_Int64InRange(-(int64_t(1) << bits), int64_t(1) << bits);
+        tiers[i] = static_cast<uint8_t>(DeepState_IntInRange(0, 255));
+    }
+
+    for (InterestKernel kernel : {InterestKernel::Scalar, InterestKernel::Avx2, InterestKernel::Avx512})
+    {
+        if (!interestKernelSupported(kernel))
+        {
+            continue;
+        }
+        std::vector<int64_t> scaled = balances;
+        std::vector<int64_t> credited(count);
+        accrueInterest(scaled.data(), tiers.data(), count, rates, credited.data(), kernel);
+        for (size_t i = 0; i < count; ++i)
+        {
+            // Rates below -RATE_SCALE, which would flip the sign, leave the balance alone
+            int64_t factor = RATE_SCALE + rates.rates[tiers[i]];
+            std::optional<Money> expected =
+                factor < 0 ? std::nullopt
+                           : Money::fromMinorUnits(balances[i]).checkedScale(factor, RATE_SCALE, RoundingMode::HalfEven);
+            ASSERT_EQ(scaled[i], expected ? expected->minorUnits() : balances[i]);
+            ASSERT_EQ(credited[i], scaled[i] - balances[i]);
+        }
+    }
+}
+
+TEST(BankingSystemPropertyTest, RateTiersPostInterest)
+{
+    BankingSystem bank;
+    std::vector<double> tier_rates = {0.01, 0.025, -0.005};
+    int num_accounts = DeepState_IntInRange(1, MAX_ACCOUNTS);
+    std::vector<int64_t> initial(num_accounts + 1);
+    std::vector<int> tiers(num_accounts + 1);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        initial[i] = DeepState_Int64InRange(0, 100000000);
+        tiers[i] = DeepState_IntInRange(0, 3); // tier 3 has no rate
+        bank.createAccount(i, "Owner", Money::fromMinorUnits(initial[i]));
+        ASSERT(bank.setRateTier(i, static_cast<uint8_t>(tiers[i])) == Status::Ok);
+    }
+    ASSERT(bank.setRateTier(num_accounts + 1, 0) == Status::AccountNotFound);
+    ASSERT(bank.calculateInterest(tier_rates) == Status::Ok);
+
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        int64_t rate = tiers[i] < 3 ? std::llround(tier_rates[tiers[i]] * RATE_SCALE) : 0;
+        Money expected = *Money::fromMinorUnits(initial[i]).checkedScale(RATE_SCALE + rate, RATE_SCALE);
+        Account *account = bank.findAccount(i);
+        ASSERT_EQ(account->balance.load(), expected);
+        if (expected.minorUnits() == initial[i])
+        {
+            ASSERT_EQ(account->transactions.size(), 0u);
+            continue;
+        }
+        ASSERT_EQ(account->transactions.size(), 1u);
+        Transaction posting;
+        account->transactions.forEach([&posting](const Transaction &transaction) { posting = transaction; });
+        ASSERT(posting.type == TransactionType::Interest);
+        ASSERT_EQ(posting.amount.minorUnits(), expected.minorUnits() - initial[i]);
+    }
+}
+
+TEST(WorkerPoolTest, EveryWorkerRunsOncePerRun)
+{
+    WorkerPool pool;
+    for (int run = DeepState_IntInRange(1, 20); run > 0; --run)
+    {
+        std::size_t num_workers = static_cast<std::size_t>(DeepState_IntInRange(0, 8));
+        std::vector<std::atomic<int>> calls(num_workers);
+        pool.run(num_workers, [&calls](std::size_t worker) { calls[worker].fetch_add(1); });
+        for (std::atomic<int> &count : calls)
+        {
+            ASSERT_EQ(count.load(), 1);
+        }
+    }
+}
+
+TEST(BankingSystemPropertyTest, ParallelInterestSweepsEveryChunk)
+{
+    // Enough accounts for the sweep to run on the worker pool, swept more than once so the
+    // pool's threads are reused
+    BankingSystem bank;
+    int num_accounts = static_cast<int>(PARALLEL_INTEREST_CHUNKS * BalanceColumn::CHUNK_SIZE);
+    std::vector<AccountRecord> records(num_accounts);
+    for (int i = 0; i < num_accounts; ++i)
+    {
+        records[i] = {i, "Owner", Money::fromUnits(100 + i % 7)};
+    }
+    ASSERT_EQ(bank.loadAccounts(records), static_cast<size_t>(num_accounts));
+    int num_sweeps = DeepState_IntInRange(1, 3);
+    for (int sweep = 0; sweep < num_sweeps; ++sweep)
+    {
+        ASSERT(bank.calculateInterest(0.01) == Status::Ok);
+    }
+    for (int i = 0; i < num_accounts; ++i)
+    {
+        Money expected = Money::fromUnits(100 + i % 7);
+        for (int sweep = 0; sweep < num_sweeps; ++sweep)
+        {
+            expected = *expected.checkedScale(RATE_SCALE + RATE_SCALE / 100, RATE_SCALE);
+        }
+        Account *account = bank.findAccount(i);
+        ASSERT_EQ(account->balance.load(), expected);
+        ASSERT_EQ(account->transactions.size(), static_cast<size_t>(num_sweeps));
+    }
+}
+
+TEST(BankingSystemConcurrencyTest, ConcurrentOperationsConserveMoney)
+{
+    BankingSystem bankingSystem;
+    int num_accounts = DeepState_IntInRange(2, 32);
+    int num_threads = DeepState_IntInRange(2, 8);
+    Money initial_balance = Money::fromUnits(1000);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        bankingSystem.createAccount(i, "Owner", initial_balance);
+    }
+
+    // Every thread transfers between random accounts and deposits into them
+    std::atomic<int64_t> deposited(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&bankingSystem, &deposited, num_accounts, t] {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> pick_account(1, num_accounts);
+            std::uniform_int_distribution<int> pick_amount(1, 300);
+            for (int i = 0; i < 2000; ++i)
+            {
+                Money amount = Money::fromUnits(pick_amount(rng));
+                if (i % 10 == 0)
+                {
+                    bankingSystem.deposit(pick_account(rng), amount);
+                    deposited += amount.minorUnits();
+                }
+                else
+                {
+                    bankingSystem.transfer(pick_account(rng), pick_account(rng), amount);
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    Money total;
+    Money sent;
+    Money received;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *account = bankingSystem.findAccount(i);
+        ASSERT(!account->balance.load().isNegative());
+        total = *total.checkedAdd(account->balance);
+        account->transactions.forEach([&sent, &received](const Transaction &transaction) {
+            if (transaction.type == TransactionType::TransferOut)
+            {
+                sent = *sent.checkedAdd(transaction.amount);
+            }
+            else if (transaction.type == TransactionType::TransferIn)
+            {
+                received = *received.checkedAdd(transaction.amount);
+            }
+        });
+    }
+    Money expected = *initial_balance.checkedScale(num_accounts, 1);
+    ASSERT_EQ(total, *expected.checkedAdd(Money::fromMinorUnits(deposited.load())));
+    ASSERT_EQ(sent, received);
+}
+
+TEST(BankingSystemConcurrencyTest, LockFreeAccountNeverOverdraws)
+{
+    BankingSystem bankingSystem;
+    int num_threads = DeepState_IntInRange(2, 8);
+    Money initial_balance = Money::fromUnits(DeepState_IntInRange(0, 1000));
+    bankingSystem.createAccount(1, "Merchant", initial_balance);
+    bankingSystem.createAccount(2, "Customer", Money::fromUnits(1000000));
+    bankingSystem.setLockFreeFastPath(1, true);
+
+    // Lock-free deposits and withdrawals race with locked-path transfers into the same account
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&bankingSystem, t] {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> pick_amount(1, 50);
+            for (int i = 0; i < 3000; ++i)
+            {
+                Money amount = Money::fromUnits(pick_amount(rng));
+                switch (i % 3)
+                {
+                case 0:
+                    bankingSystem.deposit(1, amount);
+                    break;
+                case 1:
+                    bankingSystem.withdraw(1, amount);
+                    break;
+                default:
+                    bankingSystem.transfer(2, 1, amount);
+                    break;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    // Replaying the history from the opening balance must give the final balance, and the
+    // sequence numbers must be dense
+    Account *account = bankingSystem.findAccount(1);
+    Money replayed = initial_balance;
+    uint32_t expected_sequence = 0;
+    account->transactions.forEach([&replayed, &expected_sequence](const Transaction &transaction) {
+        ASSERT_EQ(transaction.sequence, expected_sequence++);
+        if (transaction.type == TransactionType::Withdrawal)
+        {
+            replayed = *replayed.checkedSubtract(transaction.amount);
+        }
+        else
+        {
+            replayed = *replayed.checkedAdd(transaction.amount);
+        }
+    });
+    ASSERT_EQ(static_cast<size_t>(expected_sequence), account->transactions.size());
+    ASSERT_EQ(account->balance.load(), replayed);
+    ASSERT(!account->balance.load().isNegative());
+}
+
+TEST(BankingSystemConcurrencyTest, TransactionsConserveMoney)
+{
+    BankingSystem bankingSystem;
+    int num_accounts = DeepState_IntInRange(10, 64);
+    int num_threads = DeepState_IntInRange(2, 8);
+    Money initial_balance = Money::fromUnits(1000);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        bankingSystem.createAccount(i, "Owner", initial_balance);
+    }
+    bankingSystem.setLockFreeFastPath(1, true);
+
+    // Each transaction pays from one account to 2-9 others, but only after reading that
+    // the payer can cover it; plain transfers and lock-free withdrawals race with them
+    std::atomic<int64_t> withdrawn(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&bankingSystem, &withdrawn, num_accounts, t] {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> pick_account(1, num_accounts);
+            std::uniform_int_distribution<int> pick_payees(2, 9);
+            std::uniform_int_distribution<int> pick_amount(1, 100);
+            for (int i = 0; i < 1000; ++i)
+            {
+                Money amount = Money::fromUnits(pick_amount(rng));
+                if (i % 4 == 0)
+                {
+                    bankingSystem.transfer(pick_account(rng), pick_account(rng), amount);
+                    if (bankingSystem.withdraw(1, amount) == Status::Ok)
+                    {
+                        withdrawn += amount.minorUnits();
+                    }
+                    continue;
+                }
+                int payer = pick_account(rng);
+                std::vector<int> payees(pick_payees(rng));
+                for (int &payee : payees)
+                {
+                    payee = pick_account(rng);
+                }
+                Status status = bankingSystem.runTransaction([&](BankTransaction &transaction) {
+                    Money total = *amount.checkedScale(static_cast<int64_t>(payees.size()), 1);
+                    if (*transaction.balance(payer) < total)
+                    {
+                        return Status::InsufficientFunds;
+                    }
+                    transaction.debit(payer, total);
+                    for (int payee : payees)
+                    {
+                        transaction.credit(payee, amount);
+                    }
+                    return Status::Ok;
+                });
+                ASSERT(status == Status::Ok || status == Status::InsufficientFunds || status == Status::Conflict);
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    Money total;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *account = bankingSystem.findAccount(i);
+        ASSERT(!account->balance.load().isNegative());
+        total = *total.checkedAdd(account->balance);
+        // Every leg is in the history, so replaying it gives the balance
+        Money replayed = initial_balance;
+        account->transactions.forEach([&replayed](const Transaction &transaction) {
+            bool outgoing = transaction.type == TransactionType::Debit ||
+                            transaction.type == TransactionType::TransferOut ||
+                            transaction.type == TransactionType::Withdrawal;
+            replayed = *(outgoing ? replayed.checkedSubtract(transaction.amount)
+                                  : replayed.checkedAdd(transaction.amount));
+        });
+        ASSERT_EQ(account->balance.load(), replayed);
+    }
+    Money expected = *initial_balance.checkedScale(num_accounts, 1);
+    ASSERT_EQ(total, *expected.checkedSubtract(Money::fromMinorUnits(withdrawn.load())));
+}
+
+TEST(ShardedBankTest, MatchesBankingSystem)
+{
+    BankingSystem bank;
+    ShardedBank sharded(DeepState_IntInRange(1, 8), DeepState_IntInRange(1, 64));
+    int num_accounts = DeepState_IntInRange(1, 20);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Money initial_balance = Money::fromUnits(DeepState_IntInRange(0, 100));
+        bank.createAccount(i, "Owner", initial_balance);
+        ASSERT(sharded.createAccount(i, "Owner", initial_balance) == Status::Ok);
+    }
+
+    // A failed transfer may name a different reason, but the same operations succeed.
+    // Account numbers go one past the last account so some operations are rejected.
+    int num_operations = DeepState_IntInRange(0, 300);
+    for (int i = 0; i < num_operations; ++i)
+    {
+        int account_number = DeepState_IntInRange(1, num_accounts + 1);
+        Money amount = Money::fromUnits(DeepState_IntInRange(-1, 60));
+        switch (DeepState_IntInRange(0, 3))
+        {
+        case 0:
+            ASSERT(sharded.deposit(account_number, amount) == bank.deposit(account_number, amount));
+            break;
+        case 1:
+            ASSERT(sharded.withdraw(account_number, amount) == bank.withdraw(account_number, amount));
+            break;
+        case 2:
+        {
+            int to_account_number = DeepState_IntInRange(1, num_accounts + 1);
+            ASSERT_EQ(sharded.transfer(account_number, to_account_number, amount) == Status::Ok,
+                      bank.transfer(account_number, to_account_number, amount) == Status::Ok);
+            break;
+        }
+        default:
+            ASSERT(sharded.deleteAccount(account_number) == bank.deleteAccount(account_number));
+            break;
+        }
+    }
+
+    for (int i = 1; i <= num_accounts + 1; ++i)
+    {
+        Account *account = bank.findAccount(i);
+        std::optional<Money> balance = sharded.balance(i);
+        ASSERT_EQ(account == nullptr, !balance.has_value());
+        if (account != nullptr)
+        {
+            ASSERT_EQ(*balance, account->balance.load());
+            ASSERT_EQ(*sharded.historySize(i), account->transactions.size());
+        }
+    }
+}
+
+TEST(ShardedBankTest, ConcurrentTransfersConserveMoney)
+{
+    int num_accounts = DeepState_IntInRange(2, 64);
+    int num_threads = DeepState_IntInRange(2, 8);
+    ShardedBank sharded(DeepState_IntInRange(2, 8), 16);
+    Money initial_balance = Money::fromUnits(1000);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        sharded.createAccount(i, "Owner", initial_balance);
+    }
+
+    // Small inboxes make the shards park cross-shard messages in their outboxes
+    std::atomic<int64_t> deposited(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&sharded, &deposited, num_accounts, t] {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> pick_account(1, num_accounts);
+            std::uniform_int_distribution<int> pick_amount(1, 300);
+            std::vector<Operation> batch;
+            for (int i = 0; i < 2000; ++i)
+            {
+                Money amount = Money::fromUnits(pick_amount(rng));
+                if (i % 10 == 0)
+                {
+                    sharded.deposit(pick_account(rng), amount);
+                    deposited += amount.minorUnits();
+                }
+                else if (i % 10 == 1)
+                {
+                    sharded.transfer(pick_account(rng), pick_account(rng), amount);
+                }
+                else
+                {
+                    batch.push_back({OperationType::Transfer, pick_account(rng), pick_account(rng), amount});
+                }
+            }
+            BatchResult result = sharded.applyBatch(batch);
+            ASSERT_EQ(result.succeeded + result.failed, batch.size());
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    // Every transfer has settled once its caller returned
+    Money total;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Money balance = *sharded.balance(i);
+        ASSERT(!balance.isNegative());
+        total = *total.checkedAdd(balance);
+    }
+    Money expected = *initial_balance.checkedScale(num_accounts, 1);
+    ASSERT_EQ(total, *expected.checkedAdd(Money::fromMinorUnits(deposited.load())));
+}
+
+TEST(ShardedBankTest, RefundAlwaysFits)
+{
+    ShardedBank sharded(DeepState_IntInRange(2, 8));
+    Money initial_balance = Money::fromUnits(DeepState_IntInRange(1, 1000));
+    Money amount = Money::fromMinorUnits(DeepState_Int64InRange(1, initial_balance.minorUnits()));
+    ASSERT(sharded.createAccount(1, "Owner", initial_balance) == Status::Ok);
+    // A payee that does not exist, on another shard, so the debit is held and then refunded
+    int missing = 2;
+    while (sharded.shardOf(missing) == sharded.shardOf(1))
+    {
+        missing++;
+    }
+
+    // The deposit would fill the payer's balance to the limit while the amount is held,
+    // leaving no room for the refund, so it must fail whether it runs before or after it
+    Money top_up = Money::fromMinorUnits(INT64_MAX - (initial_balance.minorUnits() - amount.minorUnits()));
+    std::vector<Operation> batch = {{OperationType::Transfer, 1, missing, amount},
+                                    {OperationType::Deposit, 1, 0, top_up}};
+    BatchResult result = sharded.applyBatch(batch);
+    ASSERT(result.statuses[0] == Status::AccountNotFound);
+    ASSERT(result.statuses[1] == Status::InvalidAmount);
+    ASSERT_EQ(*sharded.balance(1), initial_balance);
+}
+
+TEST(BankingSystemPropertyTest, BatchMatchesSingleOperations)
+{
+    BankingSystem batched;
+    BankingSystem single;
+    int num_accounts = DeepState_IntInRange(1, 10);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Money initial_balance = Money::fromUnits(DeepState_IntInRange(0, 100));
+        batched.createAccount(i, "Owner", initial_balance);
+        single.createAccount(i, "Owner", initial_balance);
+    }
+
+    // Account numbers go one past the last account so some operations are rejected
+    std::vector<Operation> operations(DeepState_IntInRange(1, 200));
+    for (Operation &operation : operations)
+    {
+        operation.type = static_cast<OperationType>(DeepState_IntInRange(0, 2));
+        operation.account_number = DeepState_IntInRange(1, num_accounts + 1);
+        operation.to_account_number = DeepState_IntInRange(1, num_accounts + 1);
+        operation.amount = Money::fromUnits(DeepState_IntInRange(-1, 50));
+    }
+
+    BatchResult result = batched.applyBatch(operations);
+    ASSERT_EQ(result.statuses.size(), operations.size());
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        const Operation &operation = operations[i];
+        Status status = Status::Ok;
+        switch (operation.type)
+        {
+        case OperationType::Deposit:
+            status = single.deposit(operation.account_number, operation.amount);
+            break;
+        case OperationType::Withdrawal:
+            status = single.withdraw(operation.account_number, operation.amount);
+            break;
+        case OperationType::Transfer:
+            status = single.transfer(operation.account_number, operation.to_account_number, operation.amount);
+            break;
+        }
+        ASSERT(result.statuses[i] == status);
+    }
+
+    ASSERT_EQ(result.succeeded + result.failed, operations.size());
+    size_t expected_records = 0;
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        if (result.statuses[i] == Status::Ok)
+        {
+            expected_records += operations[i].type == OperationType::Transfer ? 2 : 1;
+        }
+    }
+    size_t records = 0;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *batched_account = batched.findAccount(i);
+        Account *single_account = single.findAccount(i);
+        ASSERT_EQ(batched_account->balance.load(), single_account->balance.load());
+        ASSERT_EQ(batched_account->transactions.size(), single_account->transactions.size());
+        records += batched_account->transactions.size();
+    }
+    ASSERT_EQ(records, expected_records);
+}
+
+TEST(BankingSystemPropertyTest, OperationsReturnStatus)
+{
+    BankingSystem bankingSystem;
+    int account_number = DeepState_IntInRange(1, MAX_ACCOUNTS);
+    int other_account_number = account_number % MAX_ACCOUNTS + 1;
+    Money balance = Money::fromUnits(DeepState_IntInRange(1, 1000));
+    Money overdraft = *balance.checkedAdd(Money::fromMinorUnits(DeepState_IntInRange(1, 1000)));
+
+    ASSERT(bankingSystem.createAccount(account_number, "Owner", balance) == Status::Ok);
+    ASSERT(bankingSystem.createAccount(account_number, "Owner", balance) == Status::AccountExists);
+    ASSERT(bankingSystem.createAccount(other_account_number, "Owner", Money::fromMinorUnits(-1)) ==
+           Status::InvalidAmount);
+    ASSERT(bankingSystem.deposit(other_account_number, balance) == Status::AccountNotFound);
+    ASSERT(bankingSystem.deposit(account_number, Money()) == Status::InvalidAmount);
+    ASSERT(bankingSystem.withdraw(account_number, overdraft) == Status::InsufficientFunds);
+    ASSERT(bankingSystem.transfer(account_number, other_account_number, balance) == Status::AccountNotFound);
+    ASSERT(bankingSystem.withdraw(account_number, balance) == Status::Ok);
+    ASSERT_EQ(bankingSystem.findAccount(account_number)->balance.load(), Money());
+    ASSERT(bankingSystem.deleteAccount(account_number) == Status::Ok);
+    ASSERT(bankingSystem.deleteAccount(account_number) == Status::AccountNotFound);
+}
+
+TEST(BankingSystemPropertyTest, TransactionIsAllOrNothing)
+{
+    BankingSystem bankingSystem;
+    int num_accounts = DeepState_IntInRange(3, 10);
+    Money initial_balance = Money::fromUnits(DeepState_IntInRange(0, 100));
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        bankingSystem.createAccount(i, "Owner", initial_balance);
+    }
+
+    // Legs may name a missing account, overdraw, or post several times to one account
+    BankTransaction transaction = bankingSystem.begin();
+    std::map<int, int64_t> net;
+    int num_legs = DeepState_IntInRange(1, 10);
+    bool names_missing_account = false;
+    for (int i = 0; i < num_legs; ++i)
+    {
+        int account_number = DeepState_IntInRange(1, num_accounts + 1);
+        Money amount = Money::fromUnits(DeepState_IntInRange(1, 60));
+        names_missing_account |= account_number > num_accounts;
+        if (DeepState_Bool())
+        {
+            transaction.debit(account_number, amount);
+            net[account_number] -= amount.minorUnits();
+        }
+        else
+        {
+            transaction.credit(account_number, amount);
+            net[account_number] += amount.minorUnits();
+        }
+    }
+    bool overdraws = false;
+    for (const auto &[account_number, change] : net)
+    {
+        overdraws |= initial_balance.minorUnits() + change < 0;
+    }
+
+    Status status = transaction.commit();
+    if (names_missing_account)
+    {
+        ASSERT(status == Status::AccountNotFound);
+    }
+    else
+    {
+        ASSERT(status == (overdraws ? Status::InsufficientFunds : Status::Ok));
+    }
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *account = bankingSystem.findAccount(i);
+        int64_t expected = initial_balance.minorUnits() + (status == Status::Ok ? net[i] : 0);
+        ASSERT_EQ(account->balance.load().minorUnits(), expected);
+    }
+
+    // A balance that changes after being read makes the commit fail, and a retry succeeds
+    BankTransaction stale = bankingSystem.begin();
+    Money seen = *stale.balance(1);
+    bankingSystem.deposit(1, Money::fromUnits(1));
+    stale.debit(1, Money::fromUnits(1));
+    stale.credit(2, Money::fromUnits(1));
+    ASSERT(stale.commit() == Status::Conflict);
+    ASSERT_EQ(bankingSystem.findAccount(1)->balance.load(), *seen.checkedAdd(Money::fromUnits(1)));
+    ASSERT(bankingSystem.runTransaction([](BankTransaction &retried) {
+        retried.balance(1);
+        retried.debit(1, Money::fromUnits(1));
+        retried.credit(2, Money::fromUnits(1));
+        return Status::Ok;
+    }) == Status::Ok);
+    ASSERT_EQ(bankingSystem.findAccount(1)->balance.load(), seen);
+}
+
+TEST(WorkloadTest, ZipfSkewsTowardsLowRanks)
+{
+    uint64_t n = DeepState_IntInRange(1, 1000);
+    double skew = DeepState_IntInRange(0, 99) / 100.0;
+    ZipfDistribution zipf(n, skew);
+    std::mt19937_64 rng(DeepState_UInt64());
+    std::vector<int> counts(n);
+    for (int i = 0; i < 100000; ++i)
+    {
+        uint64_t rank = zipf(rng);
+        ASSERT_LT(rank, n);
+        counts[rank]++;
+    }
+    // The first rank should get about 1 / zeta(n, skew) of the draws
+    double zeta = 0;
+    for (uint64_t k = 1; k <= n; ++k)
+    {
+        zeta += 1.0 / std::pow(static_cast<double>(k), skew);
+    }
+    ASSERT_LT(std::abs(counts[0] / 100000.0 - 1.0 / zeta), 0.01);
+
+    // Workloads stay within their accounts and repeat for a seed
+    int first_account = DeepState_IntInRange(1, MAX_ACCOUNTS);
+    int num_accounts = DeepState_IntInRange(1, MAX_ACCOUNTS);
+    std::vector<Operation> operations = generateWorkload(1000, first_account, num_accounts, skew);
+    std::vector<Operation> again = generateWorkload(1000, first_account, num_accounts, skew);
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        ASSERT_GE(operations[i].account_number, first_account);
+        ASSERT_LT(operations[i].account_number, first_account + num_accounts);
+        ASSERT_GE(operations[i].to_account_number, first_account);
+        ASSERT_LT(operations[i].to_account_number, first_account + num_accounts);
+        ASSERT(operations[i].amount.isPositive());
+        ASSERT_EQ(operations[i].account_number, again[i].account_number);
+        ASSERT_EQ(operations[i].amount, again[i].amount);
+    }
+}
+
+TEST(LogSinkTest, AsyncSinkDeliversEveryMessage)
+{
+    std::ostringstream output;
+    int num_threads = DeepState_IntInRange(1, 8);
+    int deposits_per_thread = DeepState_IntInRange(1, 500);
+    {
+        BankingSystem bankingSystem;
+        AsyncLogSink sink(output, num_threads * deposits_per_thread);
+        bankingSystem.createAccount(1, "Owner", Money());
+        bankingSystem.setLogSink(&sink);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t)
+        {
+            threads.emplace_back([&bankingSystem, deposits_per_thread] {
+                for (int i = 0; i < deposits_per_thread; ++i)
+                {
+                    bankingSystem.deposit(1, Money::fromUnits(1));
+                }
+            });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        sink.flush();
+        ASSERT_EQ(sink.dropped(), 0u);
+    }
+
+    // Each message is one whole line, whatever order the threads wrote them in
+    std::istringstream lines(output.str());
+    std::string line;
+    int num_lines = 0;
+    while (std::getline(lines, line))
+    {
+        ASSERT_EQ(line.rfind("Deposit successful. New balance: ", 0), 0u);
+        num_lines++;
+    }
+    ASSERT_EQ(num_lines, num_threads * deposits_per_thread);
+}
+
+TEST(MetricsTest, CountsEveryOutcome)
+{
+    // Any value lands in a bucket that starts at most an eighth below it
+    for (int i = 0; i < 1000; ++i)
+    {
+        uint64_t value = DeepState_UInt64() >> DeepState_IntInRange(0, 63);
+        std::size_t bucket = LatencyHistogram::bucketFor(value);
+        ASSERT_LT(bucket, LatencyHistogram::NUM_BUCKETS);
+        ASSERT(LatencyHistogram::bucketStart(bucket) <= value);
+        ASSERT(value - LatencyHistogram::bucketStart(bucket) <= value / LatencyHistogram::SUB_BUCKETS);
+    }
+
+    int num_threads = DeepState_IntInRange(1, 4);
+    int operations_per_thread = DeepState_IntInRange(1, 500);
+    BankingSystem bankingSystem;
+    bankingSystem.createAccount(1, "Owner", Money::fromUnits(DeepState_IntInRange(0, 100)));
+    std::atomic<uint64_t> expected[NUM_STATUSES] = {};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&bankingSystem, &expected, operations_per_thread, seed = DeepState_UInt64()] {
+            std::mt19937_64 rng(seed);
+            for (int i = 0; i < operations_per_thread; ++i)
+            {
+                // Missing accounts, overdrafts and invalid amounts all happen along the way
+                int account_number = static_cast<int>(rng() % 2) + 1;
+                Money amount = Money::fromUnits(static_cast<int64_t>(rng() % 10));
+                Status status = rng() % 2 == 0 ? bankingSystem.deposit(account_number, amount)
+                                               : bankingSystem.withdraw(account_number, amount);
+                expected[static_cast<std::size_t>(status)]++;
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    MetricsSnapshot snapshot = bankingSystem.metricsSnapshot();
+    uint64_t total_calls = 0;
+    for (std::size_t status = 0; status < NUM_STATUSES; ++status)
+    {
+        uint64_t recorded = snapshot[MetricOperation::Deposit].outcomes[status] +
+                            snapshot[MetricOperation::Withdraw].outcomes[status];
+        ASSERT_EQ(recorded, snapshot.enabled ? expected[status].load() : 0u);
+        total_calls += recorded;
+    }
+    ASSERT_EQ(snapshot[MetricOperation::Deposit].latency.count() + snapshot[MetricOperation::Withdraw].latency.count(),
+              total_calls);
+    ASSERT_EQ(snapshot[MetricOperation::Transfer].calls(), 0u);
+
+    std::ostringstream json;
+    writeMetricsJson(json, snapshot);
+    ASSERT_EQ(json.str().rfind(snapshot.enabled ? "{\"enabled\":true" : "{\"enabled\":false", 0), 0u);
+    ASSERT(json.str().find("\"insufficient_funds\":") != std::string::npos);
+}
+
+// Runs random operations against bank, returning how many succeeded
+static int runRandomOperations(BankingSystem &bank, int num_accounts, int num_operations)
+{
+    int succeeded = 0;
+    for (int i = 0; i < num_operations; ++i)
+    {
+        int account_number = DeepState_IntInRange(1, num_accounts);
+        Money amount = Money::fromUnits(DeepState_IntInRange(1, 50));
+        Status status = Status::Ok;
+        switch (DeepState_IntInRange(0, 5))
+        {
+        case 0:
+            status = bank.deposit(account_number, amount);
+            break;
+        case 1:
+            status = bank.withdraw(account_number, amount);
+            break;
+        case 2:
+            status = bank.transfer(account_number, DeepState_IntInRange(1, num_accounts), amount);
+            break;
+        case 3:
+            status = bank.calculateInterest(0.01);
+            break;
+        case 4:
+        {
+            // Splits amount from one account across two others in one transaction
+            BankTransaction transaction = bank.begin();
+            transaction.debit(account_number, *amount.checkedAdd(amount));
+            transaction.credit(DeepState_IntInRange(1, num_accounts), amount);
+            transaction.credit(DeepState_IntInRange(1, num_accounts), amount);
+            status = transaction.commit();
+            break;
+        }
+        default:
+            status = bank.deleteAccount(account_number) == Status::Ok
+                         ? bank.createAccount(account_number, "Reopened", amount)
+                         : Status::AccountNotFound;
+            break;
+        }
+        succeeded += status == Status::Ok;
+    }
+    return succeeded;
+}
+
+// Checks that accounts 1..num_accounts have the same owner, balance and history length
+static void assertSameAccounts(BankingSystem &expected_bank, BankingSystem &actual_bank, int num_accounts)
+{
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *expected = expected_bank.findAccount(i);
+        Account *actual = actual_bank.findAccount(i);
+        ASSERT_EQ(expected == nullptr, actual == nullptr);
+        if (expected == nullptr)
+        {
+            continue;
+        }
+        ASSERT_EQ(actual->owner, expected->owner);
+        ASSERT_EQ(actual->balance.load(), expected->balance.load());
+        ASSERT_EQ(actual->transactions.size(), expected->transactions.size());
+    }
+}
+
+TEST(JournalTest, ReplayRestoresState)
+{
+    std::string path = temporaryPath("banking_journal_replay");
+    int num_accounts = DeepState_IntInRange(1, 20);
+    BankingSystem original;
+    {
+        std::unique_ptr<Journal> journal =
+            Journal::open(path, DeepState_Bool() ? CommitMode::Synchronous : CommitMode::Background);
+        ASSERT(journal != nullptr);
+        original.attachJournal(journal.get());
+        for (int i = 1; i <= num_accounts; ++i)
+        {
+            original.createAccount(i, "Owner" + std::to_string(i), Money::fromUnits(DeepState_IntInRange(0, 500)));
+        }
+        runRandomOperations(original, num_accounts, DeepState_IntInRange(0, 300));
+        original.attachJournal(nullptr);
+    }
+
+    BankingSystem recovered;
+    recovered.recover(path);
+    assertSameAccounts(original, recovered, num_accounts);
+    std::filesystem::remove(path);
+}
+
+TEST(JournalTest, TornTailIsDropped)
+{
+    std::string path = temporaryPath("banking_journal_torn");
+    Money initial_balance = Money::fromUnits(DeepState_IntInRange(1, 500));
+    Money deposit_amount = Money::fromUnits(DeepState_IntInRange(1, 500));
+    uintmax_t intact_size;
+    {
+        std::unique_ptr<Journal> journal = Journal::open(path);
+        BankingSystem bank;
+        bank.attachJournal(journal.get());
+        bank.createAccount(1, "Owner", initial_balance);
+        bank.deposit(1, deposit_amount);
+        intact_size = std::filesystem::file_size(path);
+        bank.deposit(1, deposit_amount);
+    }
+
+    // Cut the last record short, as if the process died partway through writing it
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - DeepState_IntInRange(1, 12));
+    BankingSystem recovered;
+    ASSERT_EQ(*recovered.recover(path), 2u);
+    ASSERT_EQ(recovered.findAccount(1)->balance.load(), *initial_balance.checkedAdd(deposit_amount));
+    ASSERT_EQ(std::filesystem::file_size(path), intact_size);
+
+    // New records follow the last intact one
+    {
+        std::unique_ptr<Journal> journal = Journal::open(path);
+        recovered.attachJournal(journal.get());
+        ASSERT(recovered.withdraw(1, initial_balance) == Status::Ok);
+        recovered.attachJournal(nullptr);
+    }
+    BankingSystem reopened;
+    ASSERT_EQ(*reopened.recover(path), 3u);
+    ASSERT_EQ(reopened.findAccount(1)->balance.load(), deposit_amount);
+    std::filesystem::remove(path);
+}
+
+TEST(JournalTest, UnreadableRecordIsKept)
+{
+    std::string path = temporaryPath("banking_journal_unreadable");
+    uintmax_t journal_size;
+    {
+        std::unique_ptr<Journal> journal = Journal::open(path);
+        BankingSystem bank;
+        bank.attachJournal(journal.get());
+        bank.createAccount(1, "Owner", Money::fromUnits(10));
+        // An owner the journal could not hold is refused before anything is written
+        std::string long_owner(MAX_OWNER_LENGTH + DeepState_IntInRange(1, 100), 'x');
+        ASSERT(bank.createAccount(2, long_owner, Money::fromUnits(10)) == Status::OwnerTooLong);
+        ASSERT(bank.findAccount(2) == nullptr);
+        bank.attachJournal(nullptr);
+    }
+    // A whole record of a type this version does not know, followed by a good one
+    {
+        char record[16] = {};
+        uint16_t length = 4;
+        record[6] = static_cast<char>(DeepState_IntInRange(static_cast<int>(JournalRecordType::MultiLeg) + 1, 255));
+        memcpy(record + 4, &length, sizeof(length));
+        uint32_t crc = crc32c(record + 4, sizeof(record) - 4);
+        memcpy(record, &crc, sizeof(crc));
+        std::ofstream(path, std::ios::binary | std::ios::app).write(record, sizeof(record));
+        std::unique_ptr<Journal> journal = Journal::open(path);
+        BankingSystem bank;
+        bank.attachJournal(journal.get());
+        bank.createAccount(3, "Owner", Money::fromUnits(10));
+        bank.attachJournal(nullptr);
+    }
+    journal_size = std::filesystem::file_size(path);
+
+    // Recovery fails rather than cutting the journal at the unknown record
+    BankingSystem recovered;
+    ASSERT(!recovered.recover(path).has_value());
+    ASSERT_EQ(std::filesystem::file_size(path), journal_size);
+    std::filesystem::remove(path);
+}
+
+TEST(SnapshotTest, ViewAndLoadMatchBank)
+{
+    std::string path = temporaryPath("banking_snapshot_view");
+    int num_accounts = DeepState_IntInRange(0, 50);
+    BankingSystem original;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        original.createAccount(i, "Owner" + std::to_string(i), Money::fromUnits(DeepState_IntInRange(0, 500)));
+    }
+    runRandomOperations(original, std::max(num_accounts, 1), DeepState_IntInRange(0, 300));
+    ASSERT(original.writeSnapshot(path));
+
+    std::unique_ptr<SnapshotView> snapshot = SnapshotView::open(path);
+    ASSERT(snapshot != nullptr);
+    ASSERT(snapshot->verify());
+    ASSERT_EQ(snapshot->size(), original.accounts.size());
+    ASSERT(snapshot->find(MAX_ACCOUNTS + 1) == nullptr);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *expected = original.findAccount(i);
+        const SnapshotAccount *saved = snapshot->find(i);
+        ASSERT_EQ(expected == nullptr, saved == nullptr);
+        if (expected == nullptr)
+        {
+            continue;
+        }
+        ASSERT_EQ(snapshot->owner(*saved), expected->owner);
+        ASSERT_EQ(snapshot->balance(*saved), expected->balance.load());
+        std::vector<Transaction> history;
+        expected->transactions.forEach([&history](const Transaction &transaction) { history.push_back(transaction); });
+        std::span<const Transaction> saved_history = snapshot->transactions(*saved);
+        ASSERT_EQ(saved_history.size(), history.size());
+        for (size_t j = 0; j < history.size(); ++j)
+        {
+            ASSERT_EQ(saved_history[j].sequence, history[j].sequence);
+            ASSERT(saved_history[j].type == history[j].type);
+            ASSERT_EQ(saved_history[j].amount, history[j].amount);
+            ASSERT_EQ(saved_history[j].counterparty, history[j].counterparty);
+            ASSERT_EQ(saved_history[j].timestamp, history[j].timestamp);
+        }
+    }
+
+    BankingSystem loaded;
+    ASSERT_EQ(loaded.loadSnapshot(*snapshot), snapshot->size());
+    assertSameAccounts(original, loaded, num_accounts);
+    std::filesystem::remove(path);
+}
+
+TEST(SnapshotTest, SnapshotPlusJournalRecovers)
+{
+    std::string snapshot_path = temporaryPath("banking_snapshot_recover");
+    std::string journal_path = temporaryPath("banking_snapshot_recover_journal");
+    int num_accounts = DeepState_IntInRange(1, 20);
+    BankingSystem original;
+    {
+        std::unique_ptr<Journal> journal = Journal::open(journal_path, CommitMode::Background);
+        ASSERT(journal != nullptr);
+        original.attachJournal(journal.get());
+        for (int i = 1; i <= num_accounts; ++i)
+        {
+            original.createAccount(i, "Owner" + std::to_string(i), Money::fromUnits(DeepState_IntInRange(0, 500)));
+        }
+        runRandomOperations(original, num_accounts, DeepState_IntInRange(0, 100));
+
+        // Operations keep running while the snapshot is taken; the journal position it
+        // records must split them exactly
+        bool written = false;
+        std::thread writer([&original, &snapshot_path, &written] { written = original.writeSnapshot(snapshot_path); });
+        runRandomOperations(original, num_accounts, DeepState_IntInRange(0, 200));
+        writer.join();
+        ASSERT(written);
+        runRandomOperations(original, num_accounts, DeepState_IntInRange(0, 100));
+        original.attachJournal(nullptr);
+    }
+
+    BankingSystem recovered;
+    recovered.recover(snapshot_path, journal_path);
+    assertSameAccounts(original, recovered, num_accounts);
+    std::filesystem::remove(snapshot_path);
+    std::filesystem::remove(journal_path);
+}
+
+TEST(SnapshotTest, CorruptionIsDetected)
+{
+    std::string snapshot_path = temporaryPath("banking_snapshot_corrupt");
+    std::string journal_path = temporaryPath("banking_snapshot_corrupt_journal");
+    int num_accounts = DeepState_IntInRange(1, 20);
+    BankingSystem original;
+    {
+        std::unique_ptr<Journal> journal = Journal::open(journal_path);
+        original.attachJournal(journal.get());
+        for (int i = 1; i <= num_accounts; ++i)
+        {
+            original.createAccount(i, "Owner" + std::to_string(i), Money::fromUnits(DeepState_IntInRange(1, 500)));
+        }
+        original.deposit(1, Money::fromUnits(1));
+        ASSERT(original.writeSnapshot(snapshot_path));
+        original.attachJournal(nullptr);
+    }
+
+    // Flip one bit anywhere past the magic number
+    uintmax_t size = std::filesystem::file_size(snapshot_path);
+    uintmax_t offset = static_cast<uintmax_t>(DeepState_UInt64InRange(8, size - 1));
+    std::fstream file(snapshot_path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    char byte = static_cast<char>(file.get());
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.put(static_cast<char>(byte ^ (1 << DeepState_IntInRange(0, 7))));
+    file.close();
+
+    std::unique_ptr<SnapshotView> snapshot = SnapshotView::open(snapshot_path);
+    ASSERT(snapshot == nullptr || !snapshot->verify());
+
+    // Recovery falls back to the full journal
+    BankingSystem recovered;
+    ASSERT_EQ(*recovered.recover(snapshot_path, journal_path), static_cast<size_t>(num_accounts) + 1);
+    assertSameAccounts(original, recovered, num_accounts);
+
+    // A header that checks out but describes an index the writer never makes is refused
+    ASSERT(original.writeSnapshot(snapshot_path));
+    SnapshotHeader header;
+    file.open(snapshot_path, std::ios::in | std::ios::out | std::ios::binary);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    header.index_capacity = DeepState_Bool() ? 0 : 8;
+    header.num_accounts = std::min<uint64_t>(header.num_accounts, header.index_capacity);
+    header.header_crc = 0;
+    header.header_crc = crc32c(&header, sizeof(header));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.close();
+    ASSERT(SnapshotView::open(snapshot_path) == nullptr);
+
+    // So is an index, unverified, with no empty entry and slots past the account table:
+    // lookups end, and find nothing
+    ASSERT(original.writeSnapshot(snapshot_path));
+    file.open(snapshot_path, std::ios::in | std::ios::out | std::ios::binary);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    int32_t bad_slot = DeepState_Bool() ? static_cast<int32_t>(header.num_accounts) : -2;
+    std::vector<SnapshotIndexEntry> bad_index(header.index_capacity, SnapshotIndexEntry{1, bad_slot});
+    file.seekp(static_cast<std::streamoff>(header.index_offset));
+    file.write(reinterpret_cast<const char *>(bad_index.data()),
+               static_cast<std::streamsize>(bad_index.size() * sizeof(SnapshotIndexEntry)));
+    file.close();
+    snapshot = SnapshotView::open(snapshot_path);
+    ASSERT(snapshot != nullptr && !snapshot->verify());
+    ASSERT(snapshot->find(1) == nullptr);
+    ASSERT(snapshot->find(num_accounts + 1) == nullptr);
+    snapshot.reset();
+    std::filesystem::remove(snapshot_path);
+    std::filesystem::remove(journal_path);
+}
+
+TEST(BulkIoTest, CsvRoundTripMatchesBank)
+{
+    std::string accounts_path = temporaryPath("banking_bulk_accounts.csv");
+    std::string transactions_path = temporaryPath("banking_bulk_transactions.csv");
+    int num_accounts = DeepState_IntInRange(0, 200);
+    BankingSystem original;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        // Owners that need quoting come out and go back in unchanged
+        std::string owner = DeepState_Bool() ? "Owner" + std::to_string(i) : "Smith, \"J\" " + std::to_string(i);
+        original.createAccount(i, owner, Money::fromMinorUnits(DeepState_IntInRange(0, 500000)));
+    }
+    runRandomOperations(original, std::max(num_accounts, 1), DeepState_IntInRange(0, 300));
+    ASSERT(exportCsv(original, accounts_path, transactions_path));
+
+    BankingSystem imported;
+    unsigned num_threads = static_cast<unsigned>(DeepState_IntInRange(1, 8));
+    CsvImportResult accounts = importAccountsCsv(imported, accounts_path, num_threads);
+    ASSERT(accounts.ok);
+    ASSERT_EQ(accounts.rows, original.accounts.size());
+    ASSERT_EQ(accounts.loaded, original.accounts.size());
+    ASSERT_EQ(accounts.malformed, 0u);
+    CsvImportResult transactions = importTransactionsCsv(imported, transactions_path, num_threads);
+    ASSERT(transactions.ok);
+    ASSERT_EQ(transactions.malformed, 0u);
+    ASSERT_EQ(transactions.skipped, 0u);
+    assertSameAccounts(original, imported, num_accounts);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *expected = original.findAccount(i);
+        if (expected == nullptr)
+        {
+            continue;
+        }
+        std::vector<Transaction> history;
+        expected->transactions.forEach([&history](const Transaction &transaction) { history.push_back(transaction); });
+        size_t j = 0;
+        imported.findAccount(i)->transactions.forEach([&](const Transaction &transaction) {
+            ASSERT(transaction.type == history[j].type);
+            ASSERT_EQ(transaction.amount, history[j].amount);
+            ASSERT_EQ(transaction.counterparty, history[j].counterparty);
+            ASSERT_EQ(transaction.timestamp, history[j].timestamp);
+            j++;
+        });
+    }
+    std::filesystem::remove(accounts_path);
+    std::filesystem::remove(transactions_path);
+}
+
+TEST(BulkIoTest, MalformedRowsAreCounted)
+{
+    std::string path = temporaryPath("banking_bulk_malformed.csv");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "account_number,owner,balance\r\n"  // header, skipped
+             << "1,Alice,10.5\r\n"                  // CRLF line endings
+             << "2,\"Bob, \"\"Jr\"\"\",0.07\n"      // quoted owner with escaped quotes
+             << "\n"                                // blank, skipped
+             << "3,Carol\n"                         // too few fields
+             << "4,Dave,1.234\n"                    // too many decimals
+             << "1,Alice again,5\n"                 // duplicate account
+             << "5,\"Eve\"x,1\n"                    // text after the closing quote
+             << "6,Frank,-1\n"                      // negative balance
+             << "7,\"Grace\",\"2\"";                // quoted fields, no final line feed
+    }
+    BankingSystem bankingSystem;
+    CsvImportResult result = importAccountsCsv(bankingSystem, path, static_cast<unsigned>(DeepState_IntInRange(1, 4)));
+    ASSERT(result.ok);
+    ASSERT_EQ(result.rows, 8u);
+    ASSERT_EQ(result.loaded, 3u);
+    ASSERT_EQ(result.malformed, 3u);
+    ASSERT_EQ(result.skipped, 2u);
+    ASSERT_EQ(result.first_malformed_line, 5u);
+    ASSERT_EQ(bankingSystem.findAccount(1)->balance.load(), Money::fromMinorUnits(1050));
+    ASSERT_EQ(bankingSystem.findAccount(2)->owner, "Bob, \"Jr\"");
+    ASSERT_EQ(bankingSystem.findAccount(2)->balance.load(), Money::fromMinorUnits(7));
+    ASSERT_EQ(bankingSystem.findAccount(7)->owner, "Grace");
+    ASSERT(bankingSystem.findAccount(6) == nullptr);
+
+    ASSERT(parseCsvAmount("-0.5") == Money::fromMinorUnits(-50));
+    ASSERT(parseCsvAmount(".25") == Money::fromMinorUnits(25));
+    ASSERT(!parseCsvAmount("92233720368547758.08"));
+    ASSERT(!parseCsvAmount("-"));
+    ASSERT(!importAccountsCsv(bankingSystem, path + ".missing").ok);
+    std::filesystem::remove(path);
+}
+
+TEST(BankServerTest, PipelinedRequestsMatchDirectCalls)
+{
+    // Every request is applied to a second bank directly, in the same order, and each
+    // response must match what the direct call returned
+    BankingSystem served;
+    BankingSystem expected;
+    std::string address = "unix:" + temporaryPath("banking_server.sock");
+    std::unique_ptr<BankServer> server = BankServer::start(served, address, DeepState_IntInRange(1, 3));
+    ASSERT(server != nullptr);
+    std::unique_ptr<BankClient> client = BankClient::connect(address);
+    ASSERT(client != nullptr);
+
+    int num_requests = DeepState_IntInRange(1, 500);
+    int depth = DeepState_IntInRange(1, 64);
+    std::vector<Response> expected_responses;
+    for (int i = 0; i < num_requests; ++i)
+    {
+        Request request;
+        request.opcode = static_cast<RequestOpcode>(DeepState_IntInRange(1, 7));
+        request.account_number = DeepState_IntInRange(1, 10);
+        request.to_account_number = DeepState_IntInRange(1, 10);
+        request.amount = Money::fromMinorUnits(DeepState_IntInRange(-100, 100000));
+        request.owner = "Owner";
+        Response response;
+        switch (request.opcode)
+        {
+        case RequestOpcode::CreateAccount:
+            response.status = expected.createAccount(request.account_number, "Owner", request.amount);
+            break;
+        case RequestOpcode::DeleteAccount:
+            response.status = expected.deleteAccount(request.account_number);
+            break;
+        case RequestOpcode::Deposit:
+            response.status = expected.deposit(request.account_number, request.amount);
+            break;
+        case RequestOpcode::Withdraw:
+            response.status = expected.withdraw(request.account_number, request.amount);
+            break;
+        case RequestOpcode::Transfer:
+            response.status = expected.transfer(request.account_number, request.to_account_number, request.amount);
+            break;
+        case RequestOpcode::Balance:
+        {
+            std::optional<Money> balance = expected.begin().balance(request.account_number);
+            response.status = balance ? Status::Ok : Status::AccountNotFound;
+            response.balance = balance.value_or(Money());
+            break;
+        }
+        case RequestOpcode::Interest:
+            request.rate = 0.01;
+            response.status = expected.calculateInterest(request.rate);
+            break;
+        }
+        client->send(request);
+        expected_responses.push_back(response);
+        if (client->inFlight() == static_cast<size_t>(depth) || i + 1 == num_requests)
+        {
+            ASSERT(client->flush());
+            while (client->inFlight() > 0)
+            {
+                std::optional<Response> received = client->receive();
+                ASSERT(received.has_value());
+                const Response &wanted = expected_responses[expected_responses.size() - client->inFlight() - 1];
+                ASSERT(received->status == wanted.status);
+                ASSERT(received->balance == wanted.balance);
+            }
+        }
+    }
+    assertSameAccounts(expected, served, 10);
+
+    // A malformed message ends the connection, but not the server
+    std::unique_ptr<BankClient> bad_client = BankClient::connect(address);
+    Request bad_request;
+    bad_request.opcode = static_cast<RequestOpcode>(0);
+    bad_client->send(bad_request);
+    ASSERT(!bad_client->receive().has_value());
+    // So does an interest rate that is not a number or is below -1, without touching any balance
+    for (double rate : {std::nan(""), -2.0})
+    {
+        std::unique_ptr<BankClient> rate_client = BankClient::connect(address);
+        Request rate_request;
+        rate_request.opcode = RequestOpcode::Interest;
+        rate_request.rate = rate;
+        rate_client->send(rate_request);
+        ASSERT(!rate_client->receive().has_value());
+    }
+    assertSameAccounts(expected, served, 10);
+    Request balance_request;
+    balance_request.opcode = RequestOpcode::Balance;
+    ASSERT(client->call(balance_request).has_value());
+    ASSERT_EQ(server->requestCount(), static_cast<size_t>(num_requests + 1));
+}
+
+// Coroutine that starts at once and cleans up after itself
+struct DetachedCoroutine
+{
+    struct promise_type
+    {
+        DetachedCoroutine get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static DetachedCoroutine randomPostings(AsyncBank &async_bank, int num_accounts, int num_operations, uint64_t seed,
+                                        int64_t &net_change, int &num_finished)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> account(1, num_accounts);
+    std::uniform_int_distribution<int64_t> amount(1, 50000);
+    for (int i = 0; i < num_operations; ++i)
+    {
+        Money posting = Money::fromMinorUnits(amount(rng));
+        switch (rng() % 3)
+        {
+        case 0:
+            if (co_await async_bank.deposit(account(rng), posting) == Status::Ok)
+            {
+                net_change += posting.minorUnits();
+            }
+            break;
+        case 1:
+            if (co_await async_bank.withdraw(account(rng), posting) == Status::Ok)
+            {
+                net_change -= posting.minorUnits();
+            }
+            break;
+        default:
+            co_await async_bank.transfer(account(rng), account(rng), posting);
+            break;
+        }
+    }
+    num_finished++;
+}
+
+TEST(AsyncBankTest, CoroutinesMatchJournalAndTotals)
+{
+    // Coroutines are resumed on this thread, as an event loop would
+    std::string path = temporaryPath("banking_async_journal");
+    BankingSystem bank;
+    std::unique_ptr<Journal> journal = Journal::open(path);
+    bank.attachJournal(journal.get());
+    int num_accounts = DeepState_IntInRange(1, 20);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        bank.createAccount(i, "Owner" + std::to_string(i), Money::fromUnits(1000));
+    }
+
+    std::mutex ready_mutex;
+    std::vector<std::coroutine_handle<>> ready;
+    AsyncBank async_bank(bank, DeepState_IntInRange(1, 4), [&](std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> lock(ready_mutex);
+        ready.push_back(handle);
+    });
+    int num_coroutines = DeepState_IntInRange(1, 200);
+    int num_operations = DeepState_IntInRange(0, 20);
+    int64_t net_change = 0;
+    int num_finished = 0;
+    for (int i = 0; i < num_coroutines; ++i)
+    {
+        randomPostings(async_bank, num_accounts, num_operations, i, net_change, num_finished);
+    }
+    std::vector<std::coroutine_handle<>> resuming;
+    while (num_finished < num_coroutines)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ready_mutex);
+            resuming.swap(ready);
+        }
+        for (std::coroutine_handle<> handle : resuming)
+        {
+            handle.resume();
+        }
+        resuming.clear();
+        std::this_thread::yield();
+    }
+
+    int64_t total = 0;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        total += bank.findAccount(i)->balance.load().minorUnits();
+    }
+    ASSERT_EQ(total, num_accounts * Money::fromUnits(1000).minorUnits() + net_change);
+
+    // A page read through the front end matches the history
+    std::optional<AsyncHistoryPage> page;
+    HistoryQuery query;
+    query.newest_first = true;
+    [](AsyncBank &async_bank, HistoryQuery query, std::optional<AsyncHistoryPage> &page) -> DetachedCoroutine {
+        page = co_await async_bank.queryHistory(1, query);
+    }(async_bank, query, page);
+    while (!page)
+    {
+        std::lock_guard<std::mutex> lock(ready_mutex);
+        for (std::coroutine_handle<> handle : ready)
+        {
+            handle.resume();
+        }
+        ready.clear();
+    }
+    ASSERT_EQ(page->records.size(), bank.findAccount(1)->transactions.size());
+    ASSERT(page->page.at_end);
+
+    // Everything acknowledged is in the journal
+    bank.attachJournal(nullptr);
+    journal.reset();
+    BankingSystem recovered;
+    recovered.recover(path);
+    assertSameAccounts(bank, recovered, num_accounts);
+    std::filesystem::remove(path);
+}
+
+// Checks totalBalance, ownerBalance and transactionTotals against a scan of accounts 1..num_accounts
+static void assertTotalsMatchScan(BankingSystem &bank, int num_accounts)
+{
+    int64_t total_balance = 0;
+    std::map<std::string, int64_t> owner_balances;
+    TypeTotals type_totals[NUM_TRANSACTION_TYPES];
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *account = bank.findAccount(i);
+        if (account == nullptr)
+        {
+            continue;
+        }
+        total_balance += account->balance.load().minorUnits();
+        owner_balances[account->owner] += account->balance.load().minorUnits();
+        account->transactions.forEach([&type_totals](const Transaction &transaction) {
+            TypeTotals &totals = type_totals[static_cast<std::size_t>(transaction.type)];
+            totals.count++;
+            totals.volume = *totals.volume.checkedAdd(transaction.amount);
+        });
+    }
+    ASSERT_EQ(bank.totalBalance().minorUnits(), total_balance);
+    for (const auto &[owner, balance] : owner_balances)
+    {
+        ASSERT_EQ(bank.ownerBalance(owner).minorUnits(), balance);
+    }
+    for (std::size_t t = 0; t < NUM_TRANSACTION_TYPES; ++t)
+    {
+        TypeTotals totals = bank.transactionTotals(static_cast<TransactionType>(t));
+        ASSERT_EQ(totals.count, type_totals[t].count);
+        ASSERT_EQ(totals.volume, type_totals[t].volume);
+    }
+}
+
+TEST(BankTotalsTest, TotalsMatchFullRecompute)
+{
+    std::string path = temporaryPath("banking_totals");
+    int num_accounts = DeepState_IntInRange(1, 20);
+    BankingSystem original;
+    {
+        std::unique_ptr<Journal> journal = Journal::open(path, CommitMode::Background);
+        ASSERT(journal != nullptr);
+        original.attachJournal(journal.get());
+        for (int i = 1; i <= num_accounts; ++i)
+        {
+            // A few owners hold several accounts each
+            original.createAccount(i, "Owner" + std::to_string(i % 4), Money::fromUnits(DeepState_IntInRange(0, 500)));
+        }
+        runRandomOperations(original, num_accounts, DeepState_IntInRange(0, 300));
+        std::vector<Operation> operations(DeepState_IntInRange(0, 50));
+        for (Operation &operation : operations)
+        {
+            operation = Operation{static_cast<OperationType>(DeepState_IntInRange(0, 2)),
+                                  DeepState_IntInRange(1, num_accounts + 1), DeepState_IntInRange(1, num_accounts),
+                                  Money::fromUnits(DeepState_IntInRange(1, 50))};
+        }
+        original.applyBatch(operations);
+        original.attachJournal(nullptr);
+    }
+    assertTotalsMatchScan(original, num_accounts);
+    ASSERT_EQ(original.ownerBalance("Nobody"), Money());
+
+    // Replay rebuilds the same totals
+    BankingSystem recovered;
+    recovered.recover(path);
+    assertTotalsMatchScan(recovered, num_accounts);
+    ASSERT_EQ(recovered.totalBalance(), original.totalBalance());
+    std::filesystem::remove(path);
+}
+
+TEST(BankViewTest, ViewsStayConsistentWhileWritersRun)
+{
+    BankingSystem bank;
+    int num_accounts = DeepState_IntInRange(2, 32);
+    Money initial_balance = Money::fromUnits(1000);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        bank.createAccount(i, "Owner" + std::to_string(i % 3), initial_balance);
+    }
+    bank.setLockFreeFastPath(1, true);
+
+    // Transfers, batches of them and split transactions keep the sum of balances fixed, so
+    // any view that catches one half-applied is torn
+    std::atomic<bool> stop(false);
+    std::thread writer([&bank, &stop, num_accounts] {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> pick_account(1, num_accounts);
+        std::uniform_int_distribution<int> pick_amount(1, 300);
+        while (!stop.load())
+        {
+            Money amount = Money::fromUnits(pick_amount(rng));
+            bank.transfer(pick_account(rng), pick_account(rng), amount);
+            std::vector<Operation> operations(2);
+            for (Operation &operation : operations)
+            {
+                operation = Operation{OperationType::Transfer, pick_account(rng), pick_account(rng), amount};
+            }
+            bank.applyBatch(operations);
+            BankTransaction transaction = bank.begin();
+            transaction.debit(pick_account(rng), *amount.checkedAdd(amount));
+            transaction.credit(pick_account(rng), amount);
+            transaction.credit(pick_account(rng), amount);
+            transaction.commit();
+        }
+    });
+    int64_t expected_total = initial_balance.minorUnits() * num_accounts;
+    for (int round = 0; round < 50; ++round)
+    {
+        std::unique_ptr<BankView> view = bank.openView();
+        ASSERT_EQ(view->accounts().size(), static_cast<size_t>(num_accounts));
+        int64_t total = 0;
+        for (const SnapshotEntry &entry : view->accounts())
+        {
+            total += entry.balance.minorUnits();
+            std::size_t num_read = 0;
+            view->forEachTransaction(entry, [&num_read](const Transaction &) { num_read++; });
+            ASSERT_EQ(num_read, entry.num_transactions);
+            ASSERT_EQ(view->find(entry.account_number), &entry);
+        }
+        ASSERT_EQ(total, expected_total);
+    }
+    stop.store(true);
+    writer.join();
+
+    // A deleted account stays readable through views opened before the deletion, even once
+    // its number is reused; without the view holding it back the slot would be reused too
+    int account_number = DeepState_IntInRange(1, num_accounts);
+    std::string owner = "Owner" + std::to_string(account_number % 3);
+    std::unique_ptr<BankView> all = bank.openView();
+    std::unique_ptr<BankView> owned = bank.openView(owner);
+    std::unique_ptr<BankView> single = bank.openView(account_number);
+    ASSERT(bank.openView(num_accounts + 1)->accounts().empty());
+    ASSERT_EQ(single->accounts().size(), size_t(1));
+    ASSERT(std::is_sorted(owned->accounts().begin(), owned->accounts().end(),
+                          [](const SnapshotEntry &a, const SnapshotEntry &b) {
+                              return a.account_number < b.account_number;
+                          }));
+    ASSERT_EQ(owned->accounts().size(), bank.findAccountsByOwner(owner).size());
+    SnapshotEntry before = *all->find(account_number);
+    std::vector<Transaction> history;
+    all->forEachTransaction(before, [&history](const Transaction &transaction) { history.push_back(transaction); });
+
+    ASSERT(bank.deleteAccount(account_number) == Status::Ok);
+    ASSERT(bank.createAccount(account_number, "Reopened", Money::fromUnits(1)) == Status::Ok);
+    bank.deposit(account_number, Money::fromUnits(1));
+    ASSERT_EQ(bank.accounts.size(), static_cast<size_t>(num_accounts + 1));
+    for (BankView *view : {all.get(), owned.get(), single.get()})
+    {
+        const SnapshotEntry *entry = view->find(account_number);
+        ASSERT(entry != nullptr);
+        ASSERT_EQ(entry->owner, owner);
+        ASSERT_EQ(entry->balance, before.balance);
+        std::size_t i = 0;
+        view->forEachTransaction(*entry, [&history, &i](const Transaction &transaction) {
+            ASSERT_EQ(transaction.sequence, history[i].sequence);
+            ASSERT_EQ(transaction.amount, history[i].amount);
+            i++;
+        });
+        ASSERT_EQ(i, history.size());
+    }
+
+    // The retired slot is released once the last view that could read it is gone
+    all.reset();
+    owned.reset();
+    ASSERT_EQ(bank.accounts.size(), static_cast<size_t>(num_accounts + 1));
+    single.reset();
+    ASSERT_EQ(bank.accounts.size(), static_cast<size_t>(num_accounts));
+    ASSERT(bank.openView(account_number)->accounts().front().owner == "Reopened");
+}
+
+// Whether every field of each record in a matches the one in b
+static bool sameHistory(std::span<const Transaction> a, std::span<const Transaction> b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Transaction &x, const Transaction &y) {
+        return x.sequence == y.sequence && x.type == y.type && x.amount == y.amount &&
+               x.counterparty == y.counterparty && x.timestamp == y.timestamp;
+    });
+}
+
+// Histories indexed by account number
+using Histories = std::vector<std::vector<Transaction>>;
+
+static bool sameHistories(const Histories &a, const Histories &b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const std::vector<Transaction> &x, const std::vector<Transaction> &y) {
+                          return sameHistory(x, y);
+                      });
+}
+
+TEST(ColdHistoryTest, CompactedHistoryReadsTheSame)
+{
+    int num_accounts = DeepState_IntInRange(1, 20);
+    BankingSystem bank;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        bank.createAccount(i, "Owner" + std::to_string(i), Money::fromUnits(1000));
+    }
+    // Loaded records cover what live operations rarely produce: old and out-of-order
+    // timestamps, amounts with and without minor units, and far-apart counterparties
+    std::vector<HistoryRecord> loaded;
+    uint32_t timestamp = static_cast<uint32_t>(DeepState_IntInRange(0, 1 << 30));
+    for (int n = DeepState_IntInRange(0, 400); n > 0; --n)
+    {
+        timestamp += static_cast<uint32_t>(DeepState_IntInRange(-100, 100000));
+        HistoryRecord record;
+        record.account_number = DeepState_IntInRange(1, num_accounts);
+        record.type = static_cast<TransactionType>(DeepState_IntInRange(0, 6));
+        record.amount = Money::fromMinorUnits(DeepState_IntInRange(-1000000, 1000000));
+        record.counterparty = DeepState_Bool() ? NO_COUNTERPARTY : DeepState_IntInRange(-MAX_ACCOUNTS, MAX_ACCOUNTS);
+        record.timestamp = timestamp;
+        loaded.push_back(record);
+    }
+    bank.loadHistory(loaded);
+    runRandomOperations(bank, num_accounts, DeepState_IntInRange(0, 300));
+
+    auto readHistories = [&bank, num_accounts] {
+        Histories histories(num_accounts + 1);
+        for (int i = 1; i <= num_accounts; ++i)
+        {
+            if (Account *account = bank.findAccount(i))
+            {
+                account->transactions.forEach(
+                    [&histories, i](const Transaction &transaction) { histories[i].push_back(transaction); });
+            }
+        }
+        return histories;
+    };
+    Histories histories = readHistories();
+
+    // A view opened before compaction keeps reading the same records, during it and after
+    std::unique_ptr<BankView> view = bank.openView();
+    auto readView = [&view, num_accounts] {
+        Histories seen(num_accounts + 1);
+        for (const SnapshotEntry &entry : view->accounts())
+        {
+            std::vector<Transaction> &history = seen[entry.account_number];
+            view->forEachTransaction(entry,
+                                     [&history](const Transaction &transaction) { history.push_back(transaction); });
+        }
+        return seen;
+    };
+    Histories before = readView();
+    std::atomic<bool> compacting(true);
+    std::thread reader([&] {
+        do
+        {
+            ASSERT(sameHistories(readView(), before));
+        } while (compacting.load());
+    });
+    std::size_t hot_records = static_cast<std::size_t>(DeepState_IntInRange(0, 40));
+    std::size_t moved = bank.compactHistory(hot_records);
+    compacting.store(false);
+    reader.join();
+
+    std::size_t cold_records = 0;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        Account *account = bank.findAccount(i);
+        if (account == nullptr)
+        {
+            continue;
+        }
+        const TransactionLog &transactions = account->transactions;
+        cold_records += transactions.coldSize();
+        ASSERT(transactions.size() - transactions.coldSize() <= hot_records + 2 * TRANSACTION_SEGMENT_SIZE);
+        if (transactions.coldSize() > 0)
+        {
+            ASSERT(transactions.coldBytes() < transactions.coldSize() * sizeof(Transaction));
+        }
+    }
+    ASSERT_EQ(moved, cold_records);
+    ASSERT(sameHistories(readHistories(), histories));
+    ASSERT(sameHistories(readView(), before));
+
+    // Pages that cross from the hot records into the cold ones match the plain scan
+    int account_number = DeepState_IntInRange(1, num_accounts);
+    if (bank.findAccount(account_number) != nullptr)
+    {
+        const std::vector<Transaction> &history = histories[account_number];
+        HistoryQuery query;
+        query.newest_first = DeepState_Bool();
+        query.limit = DeepState_IntInRange(1, 60);
+        query.cursor = DeepState_IntInRange(0, static_cast<int>(history.size()));
+        std::vector<Transaction> paged;
+        HistoryPage page = bank.queryHistory(account_number, query, [&paged](std::span<const Transaction> run) {
+            paged.insert(paged.end(), run.begin(), run.end());
+        });
+        ASSERT(page.status == Status::Ok);
+        std::size_t cursor = static_cast<std::size_t>(*query.cursor);
+        std::size_t first = query.newest_first ? cursor - std::min(cursor, query.limit) : cursor;
+        std::size_t last = query.newest_first ? cursor : std::min(history.size(), cursor + query.limit);
+        std::vector<Transaction> expected(history.begin() + first, history.begin() + last);
+        if (query.newest_first)
+        {
+            // Runs come newest first, each oldest first
+            std::sort(paged.begin(), paged.end(),
+                      [](const Transaction &a, const Transaction &b) { return a.sequence < b.sequence; });
+        }
+        ASSERT(sameHistory(expected, paged));
+    }
+
+    // Once the view is gone the unlinked segments go back to the arena
+    view.reset();
+    std::size_t hot_segments = 0;
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        if (Account *account = bank.findAccount(i))
+        {
+            std::size_t num_hot = account->transactions.size() - account->transactions.coldSize();
+            hot_segments += (num_hot + TRANSACTION_SEGMENT_SIZE - 1) / TRANSACTION_SEGMENT_SIZE;
+        }
+    }
+    ASSERT_EQ(bank.transaction_arena.segmentsInUse(), hot_segments);
+
+    // Appends after compaction and later compactions, which add to the cold part in place
+    // while a view reads the version before, totals and snapshots all see one history
+    for (int round = DeepState_IntInRange(1, 4); round > 0; --round)
+    {
+        runRandomOperations(bank, num_accounts, DeepState_IntInRange(0, 300));
+        histories = readHistories();
+        view = bank.openView();
+        before = readView();
+        compacting.store(true);
+        std::thread round_reader([&] {
+            do
+            {
+                ASSERT(sameHistories(readView(), before));
+            } while (compacting.load());
+        });
+        bank.compactHistory(static_cast<std::size_t>(DeepState_IntInRange(0, 40)));
+        compacting.store(false);
+        round_reader.join();
+        ASSERT(sameHistories(readHistories(), histories));
+        view.reset();
+    }
+    assertTotalsMatchScan(bank, num_accounts);
+    std::string path = temporaryPath("banking_cold_history");
+    ASSERT(bank.writeSnapshot(path));
+    std::unique_ptr<SnapshotView> snapshot = SnapshotView::open(path);
+    ASSERT(snapshot != nullptr);
+    for (int i = 1; i <= num_accounts; ++i)
+    {
+        if (const SnapshotAccount *saved = snapshot->find(i))
+        {
+            std::span<const Transaction> saved_history = snapshot->transactions(*saved);
+            ASSERT(sameHistory(histories[i], saved_history));
+        }
+    }
+    std::filesystem::remove(path);
+}
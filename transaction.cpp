@@ -0,0 +1,23 @@
+#include "transaction.h"
+
+const char *transactionTypeName(TransactionType type)
+{
+    switch (type)
+    {
+    case TransactionType::Deposit:
+        return "Deposit";
+    case TransactionType::Withdrawal:
+        return "Withdrawal";
+    case TransactionType::TransferOut:
+        return "Transfer (to)";
+    case TransactionType::TransferIn:
+        return "Transfer (from)";
+    case TransactionType::Interest:
+        return "Interest";
+    case TransactionType::Debit:
+        return "Debit";
+    case TransactionType::Credit:
+        return "Credit";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,59 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <type_traits>
+
+#include "money.h"
+
+// Kind of posting recorded in an account's history
+enum class TransactionType : uint8_t
+{
+    Deposit,
+    Withdrawal,
+    TransferOut, // money sent to the counterparty
+    TransferIn,  // money received from the counterparty
+    Interest,    // interest credited, negative for a negative rate
+    Debit,       // one leg of a multi-account transaction taking money out
+    Credit,      // one leg of a multi-account transaction paying money in
+};
+
+// Display text for a transaction type, e.g. "Transfer (to)"
+const char *transactionTypeName(TransactionType type);
+
+// Bit for a type in a set of types, such as HistoryQuery::types
+constexpr uint32_t transactionTypeBit(TransactionType type)
+{
+    return uint32_t(1) << static_cast<unsigned>(type);
+}
+
+constexpr uint32_t ALL_TRANSACTION_TYPES = ~uint32_t(0);
+
+// Counterparty of postings that have none. Never an account number: account 0 and
+// negative accounts are valid, so createAccount refuses this one instead
+constexpr int32_t NO_COUNTERPARTY = std::numeric_limits<int32_t>::min();
+
+// Structure to represent a transaction.
+// Fixed-size and trivially copyable, so a history can be copied or mapped as raw bytes
+// and posting a transaction never allocates.
+struct Transaction
+{
+    Money amount;
+    uint32_t sequence;    // position in the account's history, starting at 0
+    int32_t counterparty; // other account of a transfer, NO_COUNTERPARTY otherwise
+    uint32_t timestamp;   // seconds since the Unix epoch
+    TransactionType type;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(Transaction) == 24, "Transaction should pack into 24 bytes");
+static_assert(std::is_trivially_copyable<Transaction>::value, "Transaction must be trivially copyable");
+
+inline uint32_t currentTimestamp()
+{
+    return static_cast<uint32_t>(std::time(nullptr));
+}
+
+#endif /* TRANSACTION_H */
@@ -0,0 +1,628 @@
+#include "transaction_log.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+// First byte of a cold block's layout; the low bits hold the width of the type field
+constexpr uint8_t COLD_TYPE_BITS = 0x03;
+constexpr uint8_t COLD_ANY_NEGATIVE = 0x04;       // records carry a negative flag
+constexpr uint8_t COLD_MIXED_WHOLE = 0x08;        // records carry a whole-units flag
+constexpr uint8_t COLD_ALL_WHOLE = 0x10;          // otherwise, every amount is in whole units
+constexpr uint8_t COLD_MIXED_COUNTERPARTY = 0x20; // records carry a has-counterparty flag
+constexpr uint8_t COLD_ALL_COUNTERPARTY = 0x40;   // otherwise, every record has one
+// Zero bytes after the last block of each append, so BitReader's word loads stay inside
+// the bytes published with it
+constexpr size_t COLD_PADDING = sizeof(uint64_t);
+
+uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void putVarint(vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t getVarint(const uint8_t *&in)
+{
+    uint64_t value = *in++;
+    if (value < 0x80)
+    {
+        return value;
+    }
+    value &= 0x7f;
+    for (unsigned shift = 7;; shift += 7)
+    {
+        uint64_t byte = *in++;
+        value |= (byte & 0x7f) << shift;
+        if (byte < 0x80)
+        {
+            return value;
+        }
+    }
+}
+
+// Packs fields of up to 64 bits into bytes, least significant bit first
+class BitWriter
+{
+public:
+    explicit BitWriter(vector<uint8_t> &out) : out(out) {}
+
+    // value must fit in bits
+    void write(uint64_t value, unsigned bits)
+    {
+        if (bits > 32)
+        {
+            write(value & 0xffffffff, 32);
+            value >>= 32;
+            bits -= 32;
+        }
+        pending |= value << filled;
+        filled += bits;
+        for (; filled >= 8; filled -= 8)
+        {
+            out.push_back(static_cast<uint8_t>(pending));
+            pending >>= 8;
+        }
+    }
+    void finish()
+    {
+        if (filled > 0)
+        {
+            out.push_back(static_cast<uint8_t>(pending));
+        }
+    }
+
+private:
+    vector<uint8_t> &out;
+    uint64_t pending = 0;
+    unsigned filled = 0; // bits in pending, always below 8 between writes
+};
+
+// Reads what BitWriter packed with one unaligned little-endian word load a field; may
+// load up to 7 bytes past the last field
+class BitReader
+{
+public:
+    explicit BitReader(const uint8_t *in) : in(in) {}
+
+    uint64_t read(unsigned bits)
+    {
+        if (bits > 56)
+        {
+            uint64_t low = read(32);
+            return low | read(bits - 32) << 32;
+        }
+        uint64_t word;
+        memcpy(&word, in + position / 8, sizeof(word));
+        uint64_t value = (word >> (position % 8)) & ((uint64_t(1) << bits) - 1);
+        position += bits;
+        return value;
+    }
+
+private:
+    const uint8_t *in;
+    size_t position = 0; // in bits
+};
+
+// Size of an amount, in whole units when it has no minor part
+uint64_t amountSize(Money amount, bool &whole)
+{
+    uint64_t size = static_cast<uint64_t>(amount.minorUnits());
+    if (amount.isNegative())
+    {
+        size = 0 - size; // in unsigned arithmetic, so the most negative amount works too
+    }
+    whole = size % Money::MINOR_UNITS_PER_UNIT == 0;
+    return whole ? size / Money::MINOR_UNITS_PER_UNIT : size;
+}
+
+// Encodes records into blocks for appending to a cold part whose bytes so far end at
+// base_offset
+class ColdEncoder
+{
+public:
+    explicit ColdEncoder(size_t base_offset) : base_offset(base_offset) {}
+
+    // sequence is the record's position in the log; Transaction::sequence only holds its
+    // low 32 bits
+    void add(const Transaction &transaction, uint64_t sequence)
+    {
+        if (count == 0)
+        {
+            first_sequence = sequence;
+        }
+        pending[count++] = transaction;
+        if (count == COLD_BLOCK_SIZE)
+        {
+            flush();
+        }
+    }
+    // Writes the last, partial block and the padding
+    void finish()
+    {
+        flush();
+        bytes.insert(bytes.end(), COLD_PADDING, 0);
+    }
+
+    vector<ColdHistory::Block> blocks;
+    vector<uint8_t> bytes;
+
+private:
+    void flush()
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        blocks.push_back({first_sequence, static_cast<uint32_t>(base_offset + bytes.size()),
+                          static_cast<uint32_t>(count)});
+
+        // Choose the layout from the ranges of the fields
+        unsigned max_type = 0;
+        size_t num_negative = 0, num_whole = 0, num_counterparty = 0;
+        int64_t min_change = INT64_MAX, max_change = INT64_MIN;
+        int64_t min_counterparty = INT64_MAX, max_counterparty = INT64_MIN;
+        uint64_t max_whole = 0, max_minor = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Transaction &transaction = pending[i];
+            max_type = max(max_type, static_cast<unsigned>(transaction.type));
+            num_negative += transaction.amount.isNegative();
+            bool whole;
+            uint64_t size = amountSize(transaction.amount, whole);
+            num_whole += whole;
+            uint64_t &max_size = whole ? max_whole : max_minor;
+            max_size = max(max_size, size);
+            if (transaction.counterparty != NO_COUNTERPARTY)
+            {
+                num_counterparty++;
+                min_counterparty = min<int64_t>(min_counterparty, transaction.counterparty);
+                max_counterparty = max<int64_t>(max_counterparty, transaction.counterparty);
+            }
+            if (i > 0)
+            {
+                int64_t change = int64_t(transaction.timestamp) - int64_t(pending[i - 1].timestamp);
+                min_change = min(min_change, change);
+                max_change = max(max_change, change);
+            }
+        }
+        unsigned type_bits = bit_width(max_type);
+        unsigned change_bits = count > 1 ? bit_width(static_cast<uint64_t>(max_change - min_change)) : 0;
+        unsigned counterparty_bits =
+            num_counterparty > 0 ? bit_width(static_cast<uint64_t>(max_counterparty - min_counterparty)) : 0;
+        unsigned whole_bits = bit_width(max_whole);
+        unsigned minor_bits = bit_width(max_minor);
+        uint8_t layout = static_cast<uint8_t>(type_bits);
+        layout |= num_negative > 0 ? COLD_ANY_NEGATIVE : 0;
+        layout |= num_whole == count ? COLD_ALL_WHOLE : num_whole > 0 ? COLD_MIXED_WHOLE : 0;
+        layout |= num_counterparty == count ? COLD_ALL_COUNTERPARTY
+                  : num_counterparty > 0    ? COLD_MIXED_COUNTERPARTY
+                                            : 0;
+        bytes.push_back(layout);
+        for (unsigned bits : {change_bits, counterparty_bits, whole_bits, minor_bits})
+        {
+            bytes.push_back(static_cast<uint8_t>(bits));
+        }
+        putVarint(bytes, pending[0].timestamp);
+        if (count > 1)
+        {
+            putVarint(bytes, zigzag(min_change));
+        }
+        if (num_counterparty > 0)
+        {
+            putVarint(bytes, zigzag(min_counterparty));
+        }
+
+        BitWriter writer(bytes);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Transaction &transaction = pending[i];
+            bool whole;
+            uint64_t size = amountSize(transaction.amount, whole);
+            bool has_counterparty = transaction.counterparty != NO_COUNTERPARTY;
+            writer.write(static_cast<uint64_t>(transaction.type), type_bits);
+            if (layout & COLD_ANY_NEGATIVE)
+            {
+                writer.write(transaction.amount.isNegative(), 1);
+            }
+            if (layout & COLD_MIXED_WHOLE)
+            {
+                writer.write(whole, 1);
+            }
+            if (layout & COLD_MIXED_COUNTERPARTY)
+            {
+                writer.write(has_counterparty, 1);
+            }
+            if (i > 0)
+            {
+                int64_t change = int64_t(transaction.timestamp) - int64_t(pending[i - 1].timestamp);
+                writer.write(static_cast<uint64_t>(change - min_change), change_bits);
+            }
+            if (has_counterparty)
+            {
+                writer.write(static_cast<uint64_t>(transaction.counterparty - min_counterparty), counterparty_bits);
+            }
+            writer.write(size, whole ? whole_bits : minor_bits);
+        }
+        writer.finish();
+        count = 0;
+    }
+
+    size_t base_offset;
+    Transaction pending[COLD_BLOCK_SIZE];
+    size_t count = 0;
+    uint64_t first_sequence = 0;
+};
+} // namespace
+
+size_t ColdHistory::decode(size_t b, Transaction *out) const
+{
+    const Block &block = storage->blocks[b];
+    const uint8_t *in = storage->bytes.get() + block.offset;
+    uint8_t layout = *in++;
+    unsigned type_bits = layout & COLD_TYPE_BITS;
+    unsigned change_bits = *in++;
+    unsigned counterparty_bits = *in++;
+    unsigned whole_bits = *in++;
+    unsigned minor_bits = *in++;
+    uint32_t timestamp = static_cast<uint32_t>(getVarint(in));
+    int64_t min_change = block.count > 1 ? unzigzag(getVarint(in)) : 0;
+    bool any_counterparty = layout & (COLD_ALL_COUNTERPARTY | COLD_MIXED_COUNTERPARTY);
+    int64_t min_counterparty = any_counterparty ? unzigzag(getVarint(in)) : 0;
+
+    BitReader reader(in);
+    for (uint32_t i = 0; i < block.count; ++i)
+    {
+        TransactionType type = static_cast<TransactionType>(reader.read(type_bits));
+        bool negative = (layout & COLD_ANY_NEGATIVE) && reader.read(1);
+        bool whole = layout & COLD_MIXED_WHOLE ? reader.read(1) : (layout & COLD_ALL_WHOLE) != 0;
+        bool has_counterparty =
+            layout & COLD_MIXED_COUNTERPARTY ? reader.read(1) : (layout & COLD_ALL_COUNTERPARTY) != 0;
+        if (i > 0)
+        {
+            timestamp = static_cast<uint32_t>(timestamp + min_change + static_cast<int64_t>(reader.read(change_bits)));
+        }
+        int32_t counterparty = NO_COUNTERPARTY;
+        if (has_counterparty)
+        {
+            uint64_t offset = reader.read(counterparty_bits);
+            counterparty = static_cast<int32_t>(min_counterparty + static_cast<int64_t>(offset));
+        }
+        uint64_t amount = reader.read(whole ? whole_bits : minor_bits);
+        if (whole)
+        {
+            amount *= Money::MINOR_UNITS_PER_UNIT;
+        }
+        if (negative)
+        {
+            amount = 0 - amount;
+        }
+        Transaction &transaction = out[i];
+        transaction = Transaction{};
+        transaction.amount = Money::fromMinorUnits(static_cast<int64_t>(amount));
+        transaction.sequence = static_cast<uint32_t>(block.first_sequence + i);
+        transaction.counterparty = counterparty;
+        transaction.timestamp = timestamp;
+        transaction.type = type;
+    }
+    return block.count;
+}
+
+size_t ColdHistory::blockAfter(uint64_t sequence) const
+{
+    const Block *blocks = storage->blocks.get();
+    auto it = upper_bound(blocks, blocks + num_blocks, sequence,
+                          [](uint64_t s, const Block &block) { return s < block.first_sequence; });
+    return static_cast<size_t>(it - blocks);
+}
+
+ColdHistory::Storage *ColdHistory::append(span<const Block> new_blocks, span<const uint8_t> new_bytes)
+{
+    size_t blocks_needed = num_blocks + new_blocks.size();
+    size_t bytes_needed = num_bytes + new_bytes.size();
+    Storage *moved_from = nullptr;
+    if (storage == nullptr || blocks_needed > storage->block_capacity || bytes_needed > storage->byte_capacity)
+    {
+        // Doubling keeps the copying amortised constant per record; a first append is
+        // sized exactly, since most histories are compacted once
+        auto grow = [](size_t needed, size_t capacity) {
+            return needed > capacity ? max(needed, 2 * capacity) : capacity;
+        };
+        Storage *grown = new Storage;
+        grown->block_capacity = grow(blocks_needed, storage == nullptr ? 0 : storage->block_capacity);
+        grown->byte_capacity = grow(bytes_needed, storage == nullptr ? 0 : storage->byte_capacity);
+        grown->blocks.reset(new Block[grown->block_capacity]);
+        grown->bytes.reset(new uint8_t[grown->byte_capacity]);
+        if (storage != nullptr)
+        {
+            copy_n(storage->blocks.get(), num_blocks, grown->blocks.get());
+            copy_n(storage->bytes.get(), num_bytes, grown->bytes.get());
+        }
+        moved_from = storage;
+        storage = grown;
+    }
+    // Past the end of every published version, so no reader is looking here
+    copy(new_blocks.begin(), new_blocks.end(), storage->blocks.get() + num_blocks);
+    copy(new_bytes.begin(), new_bytes.end(), storage->bytes.get() + num_bytes);
+    num_blocks = blocks_needed;
+    num_bytes = bytes_needed;
+    return moved_from;
+}
+
+TransactionArena::TransactionArena() : free_list(nullptr), next_unused(SEGMENTS_PER_BLOCK), num_in_use(0) {}
+
+TransactionSegment *TransactionArena::allocate(uint64_t first_sequence, TransactionSegment *prev)
+{
+    TransactionSegment *segment;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (free_list != nullptr)
+        {
+            segment = free_list;
+            free_list = segment->next.load(memory_order_relaxed);
+        }
+        else
+        {
+            if (next_unused == SEGMENTS_PER_BLOCK)
+            {
+                blocks.emplace_back(new TransactionSegment[SEGMENTS_PER_BLOCK]);
+                next_unused = 0;
+            }
+            segment = &blocks.back()[next_unused++];
+        }
+        num_in_use++;
+    }
+
+    for (atomic<uint8_t> &ready : segment->ready)
+    {
+        ready.store(0, memory_order_relaxed);
+    }
+    segment->first_sequence = first_sequence;
+    segment->prev = prev;
+    segment->next.store(nullptr, memory_order_relaxed);
+    return segment;
+}
+
+void TransactionArena::release(TransactionSegment *head)
+{
+    lock_guard<std::mutex> lock(mutex);
+    while (head != nullptr)
+    {
+        TransactionSegment *next = head->next.load(memory_order_relaxed);
+        head->next.store(free_list, memory_order_relaxed);
+        free_list = head;
+        num_in_use--;
+        head = next;
+    }
+}
+
+TransactionSegment *TransactionLog::segmentFor(TransactionArena &arena, uint64_t sequence)
+{
+    TransactionSegment *segment = tail.load(memory_order_acquire);
+    if (segment == nullptr)
+    {
+        segment = head.load(memory_order_acquire);
+        if (segment == nullptr)
+        {
+            TransactionSegment *fresh = arena.allocate(0, nullptr);
+            if (head.compare_exchange_strong(segment, fresh, memory_order_acq_rel))
+            {
+                segment = fresh;
+            }
+            else
+            {
+                arena.release(fresh);
+            }
+        }
+        TransactionSegment *expected = nullptr;
+        tail.compare_exchange_strong(expected, segment, memory_order_acq_rel);
+    }
+
+    // The shared tail may already be past this sequence number if later appenders got ahead
+    while (sequence < segment->first_sequence)
+    {
+        segment = segment->prev;
+    }
+    while (sequence >= segment->first_sequence + TRANSACTION_SEGMENT_SIZE)
+    {
+        TransactionSegment *next = segment->next.load(memory_order_acquire);
+        if (next == nullptr)
+        {
+            TransactionSegment *fresh = arena.allocate(segment->first_sequence + TRANSACTION_SEGMENT_SIZE, segment);
+            if (segment->next.compare_exchange_strong(next, fresh, memory_order_acq_rel))
+            {
+                next = fresh;
+            }
+            else
+            {
+                arena.release(fresh);
+            }
+        }
+        TransactionSegment *expected = segment;
+        tail.compare_exchange_strong(expected, next, memory_order_acq_rel);
+        segment = next;
+    }
+    return segment;
+}
+
+const Transaction &TransactionLog::append(TransactionArena &arena, TransactionType type, Money amount,
+                                          int32_t counterparty, uint32_t timestamp)
+{
+    uint64_t sequence = reserved.fetch_add(1, memory_order_acq_rel);
+    TransactionSegment *segment = segmentFor(arena, sequence);
+    size_t slot = static_cast<size_t>(sequence - segment->first_sequence);
+
+    Transaction &transaction = segment->records[slot];
+    transaction = Transaction{};
+    transaction.amount = amount;
+    transaction.sequence = static_cast<uint32_t>(sequence);
+    transaction.counterparty = counterparty;
+    transaction.timestamp = timestamp;
+    transaction.type = type;
+    segment->ready[slot].store(1, memory_order_release);
+    return transaction;
+}
+
+void TransactionLog::clear(TransactionArena &arena)
+{
+    arena.release(head.load(memory_order_acquire));
+    deleteCold(cold.load(memory_order_acquire));
+    head.store(nullptr, memory_order_relaxed);
+    tail.store(nullptr, memory_order_relaxed);
+    reserved.store(0, memory_order_relaxed);
+    cold.store(nullptr, memory_order_relaxed);
+}
+
+CompactedHistory TransactionLog::compact(uint64_t end_sequence)
+{
+    CompactedHistory compacted;
+    TransactionSegment *first = head.load(memory_order_acquire);
+    TransactionSegment *new_head = first;
+    while (new_head != nullptr && new_head->first_sequence + TRANSACTION_SEGMENT_SIZE <= end_sequence)
+    {
+        TransactionSegment *next = new_head->next.load(memory_order_acquire);
+        if (next == nullptr)
+        {
+            break;
+        }
+        new_head = next;
+    }
+    if (new_head == first)
+    {
+        return compacted;
+    }
+
+    // The new records go in blocks of their own after those already in the cold part, which
+    // stay where they are, so nothing has to be decoded or copied again
+    const ColdHistory *old_cold = cold.load(memory_order_acquire);
+    uint64_t moved = new_head->first_sequence - first->first_sequence;
+    ColdEncoder encoder(old_cold == nullptr ? 0 : old_cold->num_bytes);
+    encoder.blocks.reserve((moved + COLD_BLOCK_SIZE - 1) / COLD_BLOCK_SIZE);
+    encoder.bytes.reserve(moved * 6);
+    TransactionSegment *last = first;
+    for (TransactionSegment *segment = first; segment != new_head; segment = segment->next.load(memory_order_relaxed))
+    {
+        for (size_t i = 0; i < TRANSACTION_SEGMENT_SIZE; ++i)
+        {
+            encoder.add(segment->records[i], segment->first_sequence + i);
+        }
+        last = segment;
+    }
+    encoder.finish();
+    ColdHistory *new_cold = old_cold == nullptr ? new ColdHistory() : new ColdHistory(*old_cold);
+    compacted.replaced_storage = new_cold->append(encoder.blocks, encoder.bytes);
+    new_cold->end_sequence = new_head->first_sequence;
+
+    cold.store(new_cold, memory_order_release);
+    head.store(new_head, memory_order_release);
+    // Nothing walks back past the head, and a tail left behind would point at freed segments
+    new_head->prev = nullptr;
+    TransactionSegment *current_tail = tail.load(memory_order_relaxed);
+    if (current_tail != nullptr && current_tail->first_sequence < new_head->first_sequence)
+    {
+        tail.store(new_head, memory_order_release);
+    }
+
+    compacted.first_segment = first;
+    compacted.last_segment = last;
+    compacted.replaced = old_cold;
+    compacted.num_records = static_cast<size_t>(moved);
+    return compacted;
+}
+
+void TransactionLog::release(TransactionArena &arena, const CompactedHistory &compacted)
+{
+    if (compacted.first_segment != nullptr)
+    {
+        // Readers that started before compact may have followed this link; none is left now
+        compacted.last_segment->next.store(nullptr, memory_order_relaxed);
+        arena.release(compacted.first_segment);
+    }
+    delete compacted.replaced;
+    delete compacted.replaced_storage;
+}
+
+void TransactionLog::deleteCold(const ColdHistory *cold_part)
+{
+    if (cold_part != nullptr)
+    {
+        delete cold_part->storage;
+        delete cold_part;
+    }
+}
+
+const TransactionSegment *TransactionLog::segmentAt(uint64_t sequence) const
+{
+    // The appender of sequence 0 publishes head and then tail
+    const TransactionSegment *segment = tail.load(memory_order_acquire);
+    while (segment == nullptr)
+    {
+        this_thread::yield();
+        segment = tail.load(memory_order_acquire);
+    }
+    // Recent records are the ones read most, so start from the tail unless sequence is
+    // nearer the head
+    if (sequence < segment->first_sequence / 2)
+    {
+        segment = head.load(memory_order_acquire);
+    }
+    while (sequence < segment->first_sequence)
+    {
+        segment = segment->prev;
+    }
+    while (sequence >= segment->first_sequence + TRANSACTION_SEGMENT_SIZE)
+    {
+        segment = nextSegment(*segment);
+    }
+    return segment;
+}
+
+const TransactionSegment *TransactionLog::nextSegment(const TransactionSegment &segment)
+{
+    const TransactionSegment *next = segment.next.load(memory_order_acquire);
+    while (next == nullptr)
+    {
+        this_thread::yield();
+        next = segment.next.load(memory_order_acquire);
+    }
+    return next;
+}
+
+size_t TransactionLog::readyRun(const TransactionSegment &segment, size_t first, size_t last)
+{
+    size_t slot = first;
+    while (slot < last && segment.ready[slot].load(memory_order_acquire))
+    {
+        slot++;
+    }
+    return slot - first;
+}
+
+void TransactionLog::waitUntilReady(const TransactionSegment &segment, size_t first, size_t last)
+{
+    for (size_t slot = first; slot < last; ++slot)
+    {
+        while (!segment.ready[slot].load(memory_order_acquire))
+        {
+            this_thread::yield();
+        }
+    }
+}
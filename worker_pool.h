@@ -0,0 +1,100 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads for jobs that split their work by worker index, such as the interest sweep.
+// Threads are started by the first run that needs them and then wait on a condition
+// variable between runs, so a run costs a wake-up rather than creating threads. One run
+// at a time; concurrent callers take turns.
+class WorkerPool
+{
+public:
+    WorkerPool() = default;
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Calls job(worker) for every worker in [0, num_workers), worker 0 on the calling
+    // thread, and returns once every call has
+    void run(std::size_t num_workers, const std::function<void(std::size_t)> &job)
+    {
+        std::lock_guard<std::mutex> run_lock(run_mutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (threads.size() + 1 < num_workers)
+            {
+                threads.emplace_back(&WorkerPool::loop, this, threads.size() + 1);
+            }
+            current_job = &job;
+            active_workers = num_workers;
+            remaining = num_workers > 0 ? num_workers - 1 : 0;
+            generation++;
+        }
+        wake.notify_all();
+        if (num_workers > 0)
+        {
+            job(0);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining == 0; });
+    }
+
+private:
+    void loop(std::size_t worker)
+    {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+            if (worker >= active_workers)
+            {
+                continue;
+            }
+            const std::function<void(std::size_t)> &job = *current_job;
+            lock.unlock();
+            job(worker);
+            lock.lock();
+            if (--remaining == 0)
+            {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::mutex run_mutex; // held for a whole run
+    std::mutex mutex;     // guards everything below
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<std::thread> threads; // worker i + 1 runs on threads[i]
+    const std::function<void(std::size_t)> *current_job = nullptr;
+    std::size_t active_workers = 0;
+    std::size_t remaining = 0; // workers past 0 still running the current job
+    uint64_t generation = 0;   // bumped by every run
+    bool stopping = false;
+};
+
+#endif /* WORKER_POOL_H */
@@ -0,0 +1,65 @@
+#include "workload.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+ZipfDistribution::ZipfDistribution(uint64_t n, double skew) : n(max<uint64_t>(n, 1)), zeta_n(0)
+{
+    for (uint64_t i = 1; i <= this->n; ++i)
+    {
+        zeta_n += 1.0 / pow(static_cast<double>(i), skew);
+    }
+    half_pow_skew = pow(0.5, skew);
+    alpha = 1.0 / (1.0 - skew);
+    // Only used once the first two ranks are ruled out, which needs n > 2
+    double zeta_2 = 1.0 + half_pow_skew;
+    eta = this->n > 2 ? (1.0 - pow(2.0 / static_cast<double>(this->n), 1.0 - skew)) / (1.0 - zeta_2 / zeta_n) : 0.0;
+}
+
+namespace
+{
+// Account number for each Zipf rank, shuffled so the hottest accounts are spread out
+vector<int32_t> scatteredAccounts(int first_account, int num_accounts, mt19937_64 &rng)
+{
+    vector<int32_t> accounts(static_cast<size_t>(num_accounts));
+    iota(accounts.begin(), accounts.end(), first_account);
+    shuffle(accounts.begin(), accounts.end(), rng);
+    return accounts;
+}
+} // namespace
+
+vector<Operation> generateWorkload(size_t num_operations, int first_account, int num_accounts, double skew,
+                                   const WorkloadMix &mix, uint64_t seed)
+{
+    mt19937_64 rng(seed);
+    vector<int32_t> accounts = scatteredAccounts(first_account, num_accounts, rng);
+    ZipfDistribution pick_rank(accounts.size(), skew);
+    discrete_distribution<int> pick_type({static_cast<double>(mix.deposits), static_cast<double>(mix.withdrawals),
+                                          static_cast<double>(mix.transfers)});
+    uniform_int_distribution<int64_t> pick_amount(1, 10000);
+
+    vector<Operation> operations(num_operations);
+    for (Operation &operation : operations)
+    {
+        operation.type = static_cast<OperationType>(pick_type(rng));
+        operation.account_number = accounts[pick_rank(rng)];
+        operation.to_account_number = accounts[pick_rank(rng)];
+        operation.amount = Money::fromMinorUnits(pick_amount(rng));
+    }
+    return operations;
+}
+
+vector<int32_t> generateAccountStream(size_t count, int first_account, int num_accounts, double skew, uint64_t seed)
+{
+    mt19937_64 rng(seed);
+    vector<int32_t> accounts = scatteredAccounts(first_account, num_accounts, rng);
+    ZipfDistribution pick_rank(accounts.size(), skew);
+    vector<int32_t> stream(count);
+    for (int32_t &account_number : stream)
+    {
+        account_number = accounts[pick_rank(rng)];
+    }
+    return stream;
+}
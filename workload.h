@@ -0,0 +1,66 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "banking_system.h"
+
+// Draws ranks in [0, n) with P(rank k) proportional to 1 / (k + 1)^skew, so a few hot
+// ranks take most draws; skew 0 is uniform. Uses the constant-time method of Gray et al.
+// ("Quickly Generating Billion-Record Synthetic Databases"), also used by YCSB, after an
+// O(n) set-up. Meant for skew in [0, 1); YCSB's default is 0.99.
+class ZipfDistribution
+{
+public:
+    ZipfDistribution(uint64_t n, double skew);
+
+    template <typename Rng>
+    uint64_t operator()(Rng &rng)
+    {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zeta_n;
+        if (uz < 1.0)
+        {
+            return 0;
+        }
+        if (uz < 1.0 + half_pow_skew)
+        {
+            return 1;
+        }
+        uint64_t rank = static_cast<uint64_t>(static_cast<double>(n) * std::pow(eta * u - eta + 1.0, alpha));
+        return rank < n ? rank : n - 1;
+    }
+
+private:
+    uint64_t n;
+    double zeta_n;
+    double half_pow_skew; // 0.5^skew, the second rank's share relative to the first
+    double alpha;
+    double eta;
+};
+
+// Operation mix for a synthetic workload, in parts of the total
+struct WorkloadMix
+{
+    int deposits = 40;
+    int withdrawals = 30;
+    int transfers = 30;
+};
+
+// Random postings over accounts first_account .. first_account + num_accounts - 1. Accounts
+// are picked with the given Zipf skew, and the hot ranks are scattered over the account
+// numbers so they do not share index stripes or cache lines. The same seed always gives
+// the same operations.
+std::vector<Operation> generateWorkload(std::size_t num_operations, int first_account, int num_accounts, double skew,
+                                        const WorkloadMix &mix = WorkloadMix(), uint64_t seed = 42);
+
+// Account numbers in the order generateWorkload would pick them, for benchmarks that only
+// need a stream of accounts
+std::vector<int32_t> generateAccountStream(std::size_t count, int first_account, int num_accounts, double skew,
+                                           uint64_t seed = 42);
+
+#endif /* WORKLOAD_H */